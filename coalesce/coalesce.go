@@ -0,0 +1,187 @@
+// Package coalesce shares collections between concurrent callers. Callers
+// asking a Group for the same key while a collection is in flight wait for
+// it and all receive its result, so a burst of readers costs one set of
+// system calls. With a TTL set, a successful result keeps being served
+// until it is older than the TTL.
+//
+// Results are shared, not copied: callers must treat them as read-only.
+package coalesce
+
+import (
+	"errors"
+	"sync"
+	"sync/atomic"
+	"time"
+)
+
+// ErrPanicked is returned to callers that were waiting on a collection
+// that panicked. The caller that ran it gets the panic re-raised.
+var ErrPanicked = errors.New("coalesce: collection panicked")
+
+// Stats are counters of a Group.
+type Stats struct {
+	// Calls is the number of collections run.
+	Calls uint64
+	// Shared is the number of callers that waited on another caller's
+	// collection.
+	Shared uint64
+	// Hits is the number of callers served from the TTL cache.
+	Hits uint64
+}
+
+type call[V any] struct {
+	done chan struct{}
+	val  V
+	err  error
+	// forgotten is set by Forget while the call is in flight, so its
+	// result, possibly read before whatever prompted the Forget, is not
+	// cached. Guarded by Group.mu.
+	forgotten bool
+}
+
+type entry[V any] struct {
+	val V
+	at  time.Time
+}
+
+// Group coalesces collections by key. The zero value is ready to use and
+// has no cache.
+type Group[K comparable, V any] struct {
+	// TTL is how long a successful result is served without collecting
+	// again. Zero disables the cache; only in-flight calls are shared.
+	TTL time.Duration
+
+	mu    sync.Mutex
+	calls map[K]*call[V]
+	cache map[K]entry[V]
+	// sweepAt is the cache size at which expired entries are next swept,
+	// so keys that are never asked for again do not pile up.
+	sweepAt int
+
+	nCalls  atomic.Uint64
+	nShared atomic.Uint64
+	nHits   atomic.Uint64
+}
+
+// Do returns the result of fn for key. A fresh cached result is returned
+// straight away; otherwise the caller joins the collection in flight for
+// key, or runs fn itself if there is none. Errors are shared with the
+// waiting callers but never cached.
+func (g *Group[K, V]) Do(key K, fn func() (V, error)) (V, error) {
+	g.mu.Lock()
+	if g.TTL > 0 {
+		if e, ok := g.cache[key]; ok {
+			if time.Since(e.at) < g.TTL {
+				g.mu.Unlock()
+				g.nHits.Add(1)
+				return e.val, nil
+			}
+			delete(g.cache, key)
+		}
+	}
+	if c, ok := g.calls[key]; ok {
+		g.mu.Unlock()
+		g.nShared.Add(1)
+		<-c.done
+		return c.val, c.err
+	}
+	if g.calls == nil {
+		g.calls = make(map[K]*call[V])
+	}
+	c := &call[V]{done: make(chan struct{})}
+	g.calls[key] = c
+	g.mu.Unlock()
+
+	g.nCalls.Add(1)
+	g.run(key, c, fn)
+	return c.val, c.err
+}
+
+func (g *Group[K, V]) run(key K, c *call[V], fn func() (V, error)) {
+	finished := false
+	defer func() {
+		if !finished {
+			c.err = ErrPanicked
+		}
+		g.mu.Lock()
+		delete(g.calls, key)
+		if finished && c.err == nil && g.TTL > 0 && !c.forgotten {
+			g.store(key, c.val)
+		}
+		g.mu.Unlock()
+		close(c.done)
+	}()
+	c.val, c.err = fn()
+	finished = true
+}
+
+// minSweep is the cache size below which expired entries are not swept.
+const minSweep = 64
+
+// store caches val for key, first sweeping expired entries whenever the
+// cache has doubled since the last sweep. g.mu is held.
+func (g *Group[K, V]) store(key K, val V) {
+	now := time.Now()
+	if g.cache == nil {
+		g.cache = make(map[K]entry[V])
+	}
+	if len(g.cache) >= g.sweepAt {
+		for k, e := range g.cache {
+			if now.Sub(e.at) >= g.TTL {
+				delete(g.cache, k)
+			}
+		}
+		g.sweepAt = max(2*len(g.cache), minSweep)
+	}
+	g.cache[key] = entry[V]{val: val, at: now}
+}
+
+// Forget drops the cached result for key, so the next Do collects again.
+// The result of a collection already in flight is still returned to its
+// callers but not cached.
+func (g *Group[K, V]) Forget(key K) {
+	g.mu.Lock()
+	delete(g.cache, key)
+	if c, ok := g.calls[key]; ok {
+		c.forgotten = true
+	}
+	g.mu.Unlock()
+}
+
+// Stats returns a snapshot of the counters.
+func (g *Group[K, V]) Stats() Stats {
+	return Stats{
+		Calls:  g.nCalls.Load(),
+		Shared: g.nShared.Load(),
+		Hits:   g.nHits.Load(),
+	}
+}
+
+// Func coalesces calls to a single collector function.
+type Func[V any] struct {
+	g  Group[struct{}, V]
+	fn func() (V, error)
+}
+
+// NewFunc returns a Func calling fn, serving results for up to ttl.
+func NewFunc[V any](fn func() (V, error), ttl time.Duration) *Func[V] {
+	f := &Func[V]{fn: fn}
+	f.g.TTL = ttl
+	return f
+}
+
+// Get returns the result of the wrapped function, sharing it with
+// concurrent callers and serving it from the cache while fresh.
+func (f *Func[V]) Get() (V, error) {
+	return f.g.Do(struct{}{}, f.fn)
+}
+
+// Forget drops the cached result.
+func (f *Func[V]) Forget() {
+	f.g.Forget(struct{}{})
+}
+
+// Stats returns a snapshot of the counters.
+func (f *Func[V]) Stats() Stats {
+	return f.g.Stats()
+}
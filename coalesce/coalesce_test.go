@@ -0,0 +1,176 @@
+package coalesce
+
+import (
+	"errors"
+	"strconv"
+	"sync"
+	"testing"
+	"time"
+)
+
+func TestConcurrentCallersShare(t *testing.T) {
+	var g Group[string, int]
+	const callers = 8
+	release := make(chan struct{})
+	var wg sync.WaitGroup
+	results := make([]int, callers)
+	for i := 0; i < callers; i++ {
+		wg.Add(1)
+		go func(i int) {
+			defer wg.Done()
+			results[i], _ = g.Do("k", func() (int, error) {
+				<-release
+				return 42, nil
+			})
+		}(i)
+	}
+	// Hold the collection until every other caller waits on it.
+	for g.Stats().Shared != callers-1 {
+		time.Sleep(time.Millisecond)
+	}
+	close(release)
+	wg.Wait()
+	for i, v := range results {
+		if v != 42 {
+			t.Fatalf("caller %d got %d", i, v)
+		}
+	}
+	if st := g.Stats(); st.Calls != 1 || st.Hits != 0 {
+		t.Fatalf("stats %+v", st)
+	}
+
+	// Without a TTL nothing is kept once the collection is over.
+	calls := 0
+	for i := 0; i < 2; i++ {
+		_, _ = g.Do("k", func() (int, error) { calls++; return 0, nil })
+	}
+	if calls != 2 {
+		t.Fatalf("%d collections after the burst", calls)
+	}
+}
+
+func TestTTL(t *testing.T) {
+	g := Group[string, int]{TTL: 50 * time.Millisecond}
+	n := 0
+	collect := func() (int, error) { n++; return n, nil }
+	if v, _ := g.Do("k", collect); v != 1 {
+		t.Fatalf("first Do = %d", v)
+	}
+	if v, _ := g.Do("k", collect); v != 1 {
+		t.Fatalf("cached Do = %d", v)
+	}
+	if v, _ := g.Do("other", collect); v != 2 {
+		t.Fatalf("other key = %d", v)
+	}
+	time.Sleep(60 * time.Millisecond)
+	if v, _ := g.Do("k", collect); v != 3 {
+		t.Fatalf("Do after the TTL = %d", v)
+	}
+	if st := g.Stats(); st.Calls != 3 || st.Hits != 1 {
+		t.Fatalf("stats %+v", st)
+	}
+
+	g.Forget("k")
+	if v, _ := g.Do("k", collect); v != 4 {
+		t.Fatalf("Do after Forget = %d", v)
+	}
+}
+
+func TestErrorsNotCached(t *testing.T) {
+	g := Group[string, int]{TTL: time.Hour}
+	errBusy := errors.New("busy")
+	if _, err := g.Do("k", func() (int, error) { return 1, errBusy }); !errors.Is(err, errBusy) {
+		t.Fatalf("err %v", err)
+	}
+	v, err := g.Do("k", func() (int, error) { return 2, nil })
+	if v != 2 || err != nil {
+		t.Fatalf("Do after an error = %d, %v", v, err)
+	}
+}
+
+func TestForgetInFlight(t *testing.T) {
+	g := Group[string, int]{TTL: time.Hour}
+	started, release := make(chan struct{}), make(chan struct{})
+	go func() {
+		<-started
+		g.Forget("k")
+		close(release)
+	}()
+	v, _ := g.Do("k", func() (int, error) {
+		close(started)
+		<-release
+		return 1, nil
+	})
+	if v != 1 {
+		t.Fatalf("in-flight result %d", v)
+	}
+	if v, _ = g.Do("k", func() (int, error) { return 2, nil }); v != 2 {
+		t.Fatalf("forgotten result %d served from the cache", v)
+	}
+}
+
+func TestPanicked(t *testing.T) {
+	var g Group[string, int]
+	started, release := make(chan struct{}), make(chan struct{})
+	waiter := make(chan error)
+	go func() {
+		<-started
+		go func() {
+			_, err := g.Do("k", func() (int, error) { return 0, nil })
+			waiter <- err
+		}()
+		for g.Stats().Shared != 1 {
+			time.Sleep(time.Millisecond)
+		}
+		close(release)
+	}()
+
+	func() {
+		defer func() {
+			if r := recover(); r != "boom" {
+				t.Errorf("recovered %v", r)
+			}
+		}()
+		_, _ = g.Do("k", func() (int, error) {
+			close(started)
+			<-release
+			panic("boom")
+		})
+	}()
+	if err := <-waiter; !errors.Is(err, ErrPanicked) {
+		t.Fatalf("waiter got %v", err)
+	}
+	if v, err := g.Do("k", func() (int, error) { return 3, nil }); v != 3 || err != nil {
+		t.Fatalf("Do after a panic = %d, %v", v, err)
+	}
+}
+
+func TestSweep(t *testing.T) {
+	g := Group[string, int]{TTL: time.Millisecond}
+	for i := 0; i < 1000; i++ {
+		_, _ = g.Do(strconv.Itoa(i), func() (int, error) { return i, nil })
+		if i%100 == 0 {
+			time.Sleep(2 * time.Millisecond)
+		}
+	}
+	if n := len(g.cache); n > 300 {
+		t.Fatalf("%d entries cached", n)
+	}
+}
+
+func TestFunc(t *testing.T) {
+	n := 0
+	f := NewFunc(func() (int, error) { n++; return n, nil }, time.Hour)
+	for i := 0; i < 3; i++ {
+		if v, _ := f.Get(); v != 1 {
+			t.Fatalf("Get = %d", v)
+		}
+	}
+	f.Forget()
+	if v, _ := f.Get(); v != 2 {
+		t.Fatalf("Get after Forget = %d", v)
+	}
+	if st := f.Stats(); st.Calls != 2 || st.Hits != 2 {
+		t.Fatalf("stats %+v", st)
+	}
+}
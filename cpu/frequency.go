@@ -0,0 +1,107 @@
+package cpu
+
+import (
+	"math"
+
+	"github.com/sm-moshi/dmetrics-go/instrument"
+)
+
+// residency is the cumulative time spent at one frequency in kHz, in
+// whatever unit the platform counts it.
+type residency struct {
+	khz, ticks uint64
+}
+
+// kiloHertz converts residency frequencies to hertz.
+const kiloHertz = 1000
+
+// FrequencySampler measures the average frequency of each cluster between
+// samples. It reads the kernel's cumulative DVFS residency counters, the
+// time spent at each frequency, once per frequency domain per sample and
+// weights each frequency by the time spent at it since the previous
+// sample, so short bursts count even when no single read catches them.
+// It is not safe for concurrent use.
+type FrequencySampler struct {
+	topo   *Topology
+	perCPU []float64
+	stats  *instrument.Stats
+	freqSource
+}
+
+// NewFrequencySampler returns a sampler over the host's frequency domains.
+func NewFrequencySampler() (*FrequencySampler, error) {
+	topo, err := GetTopology()
+	if err != nil {
+		return nil, err
+	}
+	s := &FrequencySampler{
+		topo:   topo,
+		perCPU: make([]float64, len(topo.ClusterOf)),
+		stats:  instrument.For(instrument.CPU),
+	}
+	// CPUs without a frequency domain, e.g. offline ones, stay NaN and are
+	// left out of the cluster figures rather than counted as 0 Hz.
+	for i := range s.perCPU {
+		s.perCPU[i] = math.NaN()
+	}
+	if err := s.open(topo); err != nil {
+		return nil, err
+	}
+	return s, nil
+}
+
+// Sample appends the average frequency in hertz of each cluster since the
+// previous Sample to dst, one ClusterStat per cluster in topology order.
+// The first call only records a baseline and returns dst unchanged.
+func (s *FrequencySampler) Sample(dst []ClusterStat) ([]ClusterStat, error) {
+	sp := s.stats.Start()
+	ok, calls, err := s.read(s.perCPU)
+	s.stats.AddCalls(instrument.IOKit, calls)
+	sp.End(err)
+	if err != nil || !ok {
+		return dst, err
+	}
+	return s.topo.Aggregate(s.perCPU, dst), nil
+}
+
+// averageHz weights each frequency by the time spent at it between two
+// readings, or returns NaN if none was accounted. Frequencies missing from
+// prev count from zero.
+func averageHz(prev, cur []residency) float64 {
+	var weighted, total float64
+	for i, r := range cur {
+		var before uint64
+		if i < len(prev) && prev[i].khz == r.khz {
+			before = prev[i].ticks
+		} else {
+			for _, q := range prev {
+				if q.khz == r.khz {
+					before = q.ticks
+					break
+				}
+			}
+		}
+		if r.ticks < before {
+			continue
+		}
+		d := float64(r.ticks - before)
+		weighted += d * float64(r.khz)
+		total += d
+	}
+	if total == 0 {
+		return math.NaN()
+	}
+	return weighted / total * kiloHertz
+}
+
+// addResidency adds ticks at khz to dst, merging with an entry of the same
+// frequency, such as one from another cluster sharing the DVFS table.
+func addResidency(dst []residency, khz, ticks uint64) []residency {
+	for i := range dst {
+		if dst[i].khz == khz {
+			dst[i].ticks += ticks
+			return dst
+		}
+	}
+	return append(dst, residency{khz: khz, ticks: ticks})
+}
@@ -0,0 +1,299 @@
+//go:build darwin && cgo
+
+package cpu
+
+/*
+#cgo LDFLAGS: -framework IOKit -framework CoreFoundation -lIOReport
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <CoreFoundation/CoreFoundation.h>
+#include <IOKit/IOKitLib.h>
+
+// IOReport is a private framework without headers; these are the
+// signatures powermetrics and its open source clones rely on.
+typedef struct IOReportSubscription *IOReportSubscriptionRef;
+extern CFDictionaryRef IOReportCopyChannelsInGroup(CFStringRef group, CFStringRef subgroup, uint64_t a, uint64_t b, uint64_t c);
+extern IOReportSubscriptionRef IOReportCreateSubscription(void *a, CFMutableDictionaryRef desired, CFMutableDictionaryRef *subbed, uint64_t id, CFTypeRef b);
+extern CFDictionaryRef IOReportCreateSamples(IOReportSubscriptionRef sub, CFMutableDictionaryRef subbed, CFTypeRef a);
+extern CFStringRef IOReportChannelGetChannelName(CFDictionaryRef ch);
+extern int32_t IOReportStateGetCount(CFDictionaryRef ch);
+extern CFStringRef IOReportStateGetNameForIndex(CFDictionaryRef ch, int32_t i);
+extern int64_t IOReportStateGetResidency(CFDictionaryRef ch, int32_t i);
+
+typedef struct {
+	IOReportSubscriptionRef sub;
+	CFMutableDictionaryRef  channels;
+} dm_freq;
+
+// dm_freq_state is the residency of one active state of a cluster channel.
+// kind is the first letter of the channel name, 'E' or 'P'.
+typedef struct {
+	char     kind;
+	int32_t  state;
+	uint64_t residency;
+} dm_freq_state;
+
+// dm_freq_open subscribes to the per-cluster DVFS state channels, or
+// returns NULL where there are none, as on Intel Macs.
+static dm_freq *dm_freq_open(void) {
+	CFDictionaryRef all = IOReportCopyChannelsInGroup(CFSTR("CPU Stats"), CFSTR("CPU Complex Performance States"), 0, 0, 0);
+	if (all == NULL) {
+		return NULL;
+	}
+	CFMutableDictionaryRef desired = CFDictionaryCreateMutableCopy(kCFAllocatorDefault, CFDictionaryGetCount(all), all);
+	CFRelease(all);
+	if (desired == NULL) {
+		return NULL;
+	}
+	CFMutableDictionaryRef subbed = NULL;
+	IOReportSubscriptionRef sub = IOReportCreateSubscription(NULL, desired, &subbed, 0, NULL);
+	CFRelease(desired);
+	if (sub == NULL || subbed == NULL) {
+		if (sub != NULL) {
+			CFRelease((CFTypeRef)sub);
+		}
+		return NULL;
+	}
+	dm_freq *f = malloc(sizeof *f);
+	if (f == NULL) {
+		CFRelease((CFTypeRef)sub);
+		CFRelease(subbed);
+		return NULL;
+	}
+	f->sub = sub;
+	f->channels = subbed;
+	return f;
+}
+
+static void dm_freq_close(dm_freq *f) {
+	CFRelease((CFTypeRef)f->sub);
+	CFRelease(f->channels);
+	free(f);
+}
+
+// dm_idle reports whether a state is one of the clock-gated or powered
+// down states that precede the DVFS states.
+static int dm_idle(CFStringRef name) {
+	char s[16];
+	if (name == NULL || !CFStringGetCString(name, s, sizeof s, kCFStringEncodingUTF8)) {
+		return 1;
+	}
+	return strcmp(s, "IDLE") == 0 || strcmp(s, "DOWN") == 0 || strcmp(s, "OFF") == 0;
+}
+
+// dm_freq_read takes one sample of all subscribed channels and stores up to
+// cap active states in out, numbering each channel's active states from 0.
+// It returns how many there are, which may exceed cap, or -1 if the sample
+// fails, and counts its IOReport calls.
+static int dm_freq_read(dm_freq *f, dm_freq_state *out, int cap, uint64_t *calls) {
+	CFDictionaryRef samples = IOReportCreateSamples(f->sub, f->channels, NULL);
+	(*calls)++;
+	if (samples == NULL) {
+		return -1;
+	}
+	int n = 0;
+	CFArrayRef chans = (CFArrayRef)CFDictionaryGetValue(samples, CFSTR("IOReportChannels"));
+	if (chans != NULL && CFGetTypeID(chans) == CFArrayGetTypeID()) {
+		for (CFIndex i = 0; i < CFArrayGetCount(chans); i++) {
+			CFDictionaryRef ch = (CFDictionaryRef)CFArrayGetValueAtIndex(chans, i);
+			CFStringRef cn = IOReportChannelGetChannelName(ch);
+			char name[32];
+			if (cn == NULL || !CFStringGetCString(cn, name, sizeof name, kCFStringEncodingUTF8)) {
+				continue;
+			}
+			if (name[0] != 'E' && name[0] != 'P') {
+				continue;
+			}
+			int32_t active = 0;
+			int32_t states = IOReportStateGetCount(ch);
+			for (int32_t s = 0; s < states; s++) {
+				if (dm_idle(IOReportStateGetNameForIndex(ch, s))) {
+					continue;
+				}
+				if (n < cap) {
+					out[n].kind = name[0];
+					out[n].state = active;
+					out[n].residency = (uint64_t)IOReportStateGetResidency(ch, s);
+				}
+				n++;
+				active++;
+			}
+		}
+	}
+	CFRelease(samples);
+	return n;
+}
+
+// dm_pmgr_table stores up to cap frequencies of the DVFS table of cluster
+// kind from the pmgr device in out. The table is an array of (frequency,
+// voltage) pairs of 32-bit words. It returns the number of entries, or -1
+// if there is no such table, and counts its IOKit calls.
+static int dm_pmgr_table(char kind, uint32_t *out, int cap, uint64_t *calls) {
+	CFStringRef key = kind == 'E' ? CFSTR("voltage-states1-sram") : CFSTR("voltage-states5-sram");
+	io_iterator_t it;
+	(*calls)++;
+	if (IOServiceGetMatchingServices(MACH_PORT_NULL, IOServiceMatching("AppleARMIODevice"), &it) != KERN_SUCCESS) {
+		return -1;
+	}
+	int n = -1;
+	for (;;) {
+		io_registry_entry_t e = IOIteratorNext(it);
+		(*calls)++;
+		if (e == IO_OBJECT_NULL) {
+			break;
+		}
+		io_name_t name;
+		(*calls)++;
+		if (IORegistryEntryGetName(e, name) == KERN_SUCCESS && strcmp(name, "pmgr") == 0) {
+			CFDataRef d = (CFDataRef)IORegistryEntryCreateCFProperty(e, key, kCFAllocatorDefault, 0);
+			(*calls)++;
+			if (d != NULL) {
+				if (CFGetTypeID(d) == CFDataGetTypeID()) {
+					const uint32_t *v = (const uint32_t *)CFDataGetBytePtr(d);
+					n = (int)(CFDataGetLength(d) / (2 * sizeof(uint32_t)));
+					for (int i = 0; i < n && i < cap; i++) {
+						out[i] = v[2 * i];
+					}
+				}
+				CFRelease(d);
+			}
+			IOObjectRelease(e);
+			break;
+		}
+		IOObjectRelease(e);
+	}
+	IOObjectRelease(it);
+	return n;
+}
+*/
+import "C"
+
+import "errors"
+
+const (
+	// maxFreqStates bounds a cluster's DVFS table; Apple Silicon has
+	// fewer than 20 states per cluster.
+	maxFreqStates = 64
+	// hertzFloor tells the units of a DVFS table apart: M1 to M3 list
+	// frequencies in hertz, M4 in kilohertz, and no core runs below
+	// 10 MHz.
+	hertzFloor = 10_000_000
+	// initialFreqStates sizes the sample buffer for two clusters.
+	initialFreqStates = 2 * maxFreqStates
+)
+
+var (
+	errIOReport  = errors.New("cpu: IOReport sample failed")
+	errFreqTable = errors.New("cpu: no DVFS table in pmgr")
+)
+
+// freqDomain is the set of clusters of one kind. Machines with two
+// performance clusters report a channel for each; both share a DVFS
+// table, so their residencies are summed.
+type freqDomain struct {
+	kind      C.char
+	cpus      []int
+	khz       []uint64
+	prev, cur []residency
+	hasPrev   bool
+}
+
+// freqSource samples the "CPU Complex Performance States" IOReport
+// channels, the time each cluster has spent in each DVFS state, and maps
+// states to frequencies with the pmgr device's DVFS tables. One
+// IOReportCreateSamples call reads every cluster.
+type freqSource struct {
+	h       *C.dm_freq
+	domains []freqDomain
+	buf     []C.dm_freq_state
+}
+
+// open subscribes to the residency channels and reads the DVFS tables of
+// the performance clusters, level 0, and the efficiency clusters, the last
+// level. The subscription lives as long as the process.
+func (s *freqSource) open(topo *Topology) error {
+	if len(topo.Clusters) == 0 {
+		return ErrUnsupported
+	}
+	s.h = C.dm_freq_open()
+	if s.h == nil {
+		return ErrUnsupported
+	}
+	kinds := []struct {
+		kind    C.char
+		cluster int
+	}{{'P', 0}, {'E', len(topo.Clusters) - 1}}
+	var table [maxFreqStates]C.uint32_t
+	var calls C.uint64_t
+	for _, k := range kinds {
+		n := int(C.dm_pmgr_table(k.kind, &table[0], maxFreqStates, &calls))
+		if n <= 0 {
+			C.dm_freq_close(s.h)
+			s.h, s.domains = nil, nil
+			return errFreqTable
+		}
+		d := freqDomain{kind: k.kind, cpus: topo.Clusters[k.cluster].CPUs, khz: make([]uint64, min(n, maxFreqStates))}
+		hertz := false
+		for i := range d.khz {
+			d.khz[i] = uint64(table[i])
+			hertz = hertz || d.khz[i] >= hertzFloor
+		}
+		if hertz {
+			for i := range d.khz {
+				d.khz[i] /= kiloHertz
+			}
+		}
+		s.domains = append(s.domains, d)
+	}
+	s.buf = make([]C.dm_freq_state, initialFreqStates)
+	return nil
+}
+
+// read sets perCPU to each CPU's average frequency in hertz while active
+// since the previous read. Time in the idle and powered down states is
+// left out, so a mostly idle cluster reports the clock it ran at, not a
+// blend with zero. It reports false on the first read, which only records
+// the baseline.
+func (s *freqSource) read(perCPU []float64) (bool, uint64, error) {
+	var calls C.uint64_t
+	var n int
+	for {
+		n = int(C.dm_freq_read(s.h, &s.buf[0], C.int(len(s.buf)), &calls))
+		if n < 0 {
+			return false, uint64(calls), errIOReport
+		}
+		if n <= len(s.buf) {
+			break
+		}
+		s.buf = make([]C.dm_freq_state, n)
+	}
+	for i := range s.domains {
+		s.domains[i].cur = s.domains[i].cur[:0]
+	}
+	for _, st := range s.buf[:n] {
+		for i := range s.domains {
+			d := &s.domains[i]
+			if d.kind == st.kind && int(st.state) < len(d.khz) {
+				d.cur = addResidency(d.cur, d.khz[st.state], uint64(st.residency))
+			}
+		}
+	}
+	ok := true
+	for i := range s.domains {
+		d := &s.domains[i]
+		if d.hasPrev {
+			hz := averageHz(d.prev, d.cur)
+			for _, cpu := range d.cpus {
+				if cpu < len(perCPU) {
+					perCPU[cpu] = hz
+				}
+			}
+		} else {
+			ok = false
+		}
+		d.prev, d.cur = d.cur, d.prev
+		d.hasPrev = true
+	}
+	return ok, uint64(calls), nil
+}
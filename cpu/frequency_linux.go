@@ -0,0 +1,107 @@
+//go:build linux
+
+package cpu
+
+import (
+	"bytes"
+	"errors"
+	"os"
+	"path/filepath"
+
+	"github.com/sm-moshi/dmetrics-go/internal/procfs"
+)
+
+const (
+	cpufreqPolicies = sysCPU + "cpufreq/policy*"
+	initialFreqBuf  = 1024
+)
+
+var errMalformedResidency = errors.New("cpu: malformed time_in_state")
+
+// freqPolicy is one cpufreq policy, a set of CPUs sharing a clock.
+type freqPolicy struct {
+	f         *os.File
+	cpus      []int
+	prev, cur []residency
+	hasPrev   bool
+}
+
+type freqSource struct {
+	policies []freqPolicy
+	buf      []byte
+}
+
+// open finds the cpufreq policies that keep residency statistics, which
+// needs CONFIG_CPU_FREQ_STAT. Their files stay open between samples.
+func (s *freqSource) open(*Topology) error {
+	dirs, _ := filepath.Glob(cpufreqPolicies)
+	for _, dir := range dirs {
+		cpus, err := readCPUList(filepath.Join(dir, "affected_cpus"))
+		if err != nil || len(cpus) == 0 {
+			continue
+		}
+		f, err := os.Open(filepath.Join(dir, "stats", "time_in_state"))
+		if err != nil {
+			continue
+		}
+		s.policies = append(s.policies, freqPolicy{f: f, cpus: cpus})
+	}
+	if len(s.policies) == 0 {
+		return ErrUnsupported
+	}
+	s.buf = make([]byte, initialFreqBuf)
+	return nil
+}
+
+// read sets perCPU to each CPU's average frequency in hertz since the
+// previous read, leaving CPUs no policy covers untouched. It reports false
+// on the first read, which only records the baseline.
+func (s *freqSource) read(perCPU []float64) (bool, uint64, error) {
+	ok := true
+	for i := range s.policies {
+		p := &s.policies[i]
+		data, err := procfs.Reread(p.f, &s.buf)
+		if err != nil {
+			return false, 0, err
+		}
+		if p.cur, err = parseResidency(data, p.cur[:0]); err != nil {
+			return false, 0, err
+		}
+		if p.hasPrev {
+			hz := averageHz(p.prev, p.cur)
+			for _, cpu := range p.cpus {
+				if cpu < len(perCPU) {
+					perCPU[cpu] = hz
+				}
+			}
+		} else {
+			ok = false
+		}
+		p.prev, p.cur = p.cur, p.prev
+		p.hasPrev = true
+	}
+	return ok, 0, nil
+}
+
+// parseResidency parses time_in_state, lines of a frequency in kHz and
+// the time spent at it in 10 ms units, straight from the read buffer.
+func parseResidency(data []byte, dst []residency) ([]residency, error) {
+	for len(data) > 0 {
+		var line []byte
+		line, data, _ = bytes.Cut(data, []byte{'\n'})
+		if len(line) == 0 {
+			continue
+		}
+		freq, ticks, ok := bytes.Cut(line, []byte{' '})
+		if !ok {
+			return dst, errMalformedResidency
+		}
+		khz, ok1 := procfs.ParseUint(freq)
+		t, ok2 := procfs.ParseUint(bytes.TrimSpace(ticks))
+		if !ok1 || !ok2 {
+			return dst, errMalformedResidency
+		}
+		dst = append(dst, residency{khz: khz, ticks: t})
+	}
+	return dst, nil
+}
@@ -0,0 +1,24 @@
+package cpu
+
+import (
+	"errors"
+	"testing"
+)
+
+func TestParseResidency(t *testing.T) {
+	got, err := parseResidency([]byte("600000 1234\n1200000 0\n\n2400000 56 \n"), nil)
+	want := []residency{{600_000, 1234}, {1_200_000, 0}, {2_400_000, 56}}
+	if err != nil || len(got) != len(want) {
+		t.Fatalf("%v, %v", got, err)
+	}
+	for i := range want {
+		if got[i] != want[i] {
+			t.Fatalf("%v, want %v", got, want)
+		}
+	}
+	for _, bad := range []string{"600000\n", "600000 x\n", "-1 5\n"} {
+		if _, err := parseResidency([]byte(bad), nil); !errors.Is(err, errMalformedResidency) {
+			t.Errorf("%q: %v", bad, err)
+		}
+	}
+}
@@ -0,0 +1,15 @@
+//go:build !linux && !(darwin && cgo)
+
+package cpu
+
+// freqSource fails elsewhere. On macOS the DVFS residency counters are
+// only reachable through the private IOReport framework, which needs cgo.
+type freqSource struct{}
+
+func (freqSource) open(*Topology) error {
+	return ErrUnsupported
+}
+
+func (freqSource) read([]float64) (bool, uint64, error) {
+	return false, 0, ErrUnsupported
+}
@@ -0,0 +1,60 @@
+package cpu
+
+import (
+	"errors"
+	"math"
+	"testing"
+)
+
+// BenchmarkFrequencySample reads the residency counters of every
+// frequency domain. Hosts without them, such as most VMs, skip it.
+func BenchmarkFrequencySample(b *testing.B) {
+	s, err := NewFrequencySampler()
+	if errors.Is(err, ErrUnsupported) {
+		b.Skip(err)
+	}
+	if err != nil {
+		b.Fatal(err)
+	}
+	dst, err := s.Sample(nil)
+	if err != nil {
+		b.Fatal(err)
+	}
+	b.ReportAllocs()
+	b.ResetTimer()
+	for i := 0; i < b.N; i++ {
+		if dst, err = s.Sample(dst[:0]); err != nil {
+			b.Fatal(err)
+		}
+	}
+}
+
+func TestAverageHz(t *testing.T) {
+	prev := []residency{{600_000, 100}, {1_200_000, 50}, {2_400_000, 10}}
+	for _, c := range []struct {
+		name string
+		cur  []residency
+		want float64
+	}{
+		{"weighted", []residency{{600_000, 130}, {1_200_000, 50}, {2_400_000, 20}}, (30*600e6 + 10*2400e6) / 40},
+		{"reordered", []residency{{2_400_000, 20}, {600_000, 130}}, (30*600e6 + 10*2400e6) / 40},
+		{"new frequency", []residency{{600_000, 100}, {3_000_000, 5}}, 3000e6},
+		{"reset dropped", []residency{{600_000, 1}, {1_200_000, 60}}, 1200e6},
+		{"idle", prev, math.NaN()},
+	} {
+		got := averageHz(prev, c.cur)
+		if got != c.want && !(math.IsNaN(got) && math.IsNaN(c.want)) {
+			t.Errorf("%s: %v, want %v", c.name, got, c.want)
+		}
+	}
+}
+
+func TestAddResidency(t *testing.T) {
+	var r []residency
+	r = addResidency(r, 600_000, 10)
+	r = addResidency(r, 1_200_000, 5)
+	r = addResidency(r, 600_000, 7)
+	if len(r) != 2 || r[0] != (residency{600_000, 17}) || r[1] != (residency{1_200_000, 5}) {
+		t.Fatalf("%v", r)
+	}
+}
@@ -0,0 +1,176 @@
+// Package cpu reports processor topology. On hybrid processors such as
+// Apple Silicon it tells performance cores from efficiency cores, so
+// per-core readings can be summarised per cluster.
+package cpu
+
+import (
+	"errors"
+	"math"
+	"slices"
+	"strconv"
+	"sync"
+)
+
+// ErrUnsupported is returned on platforms without a topology source.
+var ErrUnsupported = errors.New("cpu: not supported on this platform")
+
+// Names of the fastest and slowest levels where the platform does not name
+// them.
+const (
+	performance = "Performance"
+	efficiency  = "Efficiency"
+)
+
+// Cluster is a group of cores of one performance level.
+type Cluster struct {
+	// Level orders clusters by performance, 0 being the fastest.
+	Level int
+	// Name is the platform's name of the level, such as "Performance" or
+	// "Efficiency".
+	Name string
+	// CPUs are the logical CPU numbers in the cluster, in ascending order.
+	CPUs []int
+	// PhysicalCores is the number of physical cores, or zero if unknown.
+	PhysicalCores int
+}
+
+// Topology is the cluster layout of the processor. It is read once and
+// shared; treat it as read-only.
+type Topology struct {
+	// Clusters are ordered by Level.
+	Clusters []Cluster
+	// ClusterOf maps a logical CPU number to its index in Clusters, or -1
+	// for CPUs that are offline or unknown.
+	ClusterOf []int
+}
+
+// topology reads the layout on first use; it cannot change while the
+// host runs.
+var topology = sync.OnceValues(loadTopology)
+
+// GetTopology returns the processor's cluster layout. A processor with
+// one kind of core has a single cluster.
+func GetTopology() (*Topology, error) {
+	return topology()
+}
+
+// newTopology builds a Topology from clusters, filling ClusterOf.
+func newTopology(clusters []Cluster) *Topology {
+	n := 0
+	for _, c := range clusters {
+		for _, cpu := range c.CPUs {
+			n = max(n, cpu+1)
+		}
+	}
+	t := &Topology{Clusters: clusters, ClusterOf: make([]int, n)}
+	for i := range t.ClusterOf {
+		t.ClusterOf[i] = -1
+	}
+	for i, c := range clusters {
+		for _, cpu := range c.CPUs {
+			t.ClusterOf[cpu] = i
+		}
+	}
+	return t
+}
+
+// perflevel is one of darwin's hw.perflevel sysctl groups.
+type perflevel struct {
+	name              string
+	logical, physical int
+}
+
+// perflevelClusters lays out darwin's perflevels, level 0 being the
+// fastest. XNU numbers logical CPUs cluster by cluster starting with the
+// slowest, so the levels get contiguous CPU ranges from the last level up.
+func perflevelClusters(levels []perflevel) []Cluster {
+	clusters := make([]Cluster, len(levels))
+	next := 0
+	for l := len(levels) - 1; l >= 0; l-- {
+		p := levels[l]
+		clusters[l] = Cluster{Level: l, Name: p.name, CPUs: cpuRange(next, p.logical), PhysicalCores: p.physical}
+		next += p.logical
+	}
+	return clusters
+}
+
+func cpuRange(first, n int) []int {
+	cpus := make([]int, n)
+	for i := range cpus {
+		cpus[i] = first + i
+	}
+	return cpus
+}
+
+// capacityClusters groups cpus by their capacity, the relative performance
+// ARM kernels give each core in cpu_capacity: capacities[i] is that of
+// cpus[i]. The highest capacity is level 0. It returns nil unless there
+// are at least two capacities.
+func capacityClusters(cpus, capacities []int) []Cluster {
+	byCapacity := make(map[int][]int)
+	for i, cpu := range cpus {
+		byCapacity[capacities[i]] = append(byCapacity[capacities[i]], cpu)
+	}
+	if len(byCapacity) < 2 {
+		return nil
+	}
+	caps := make([]int, 0, len(byCapacity))
+	for c := range byCapacity {
+		caps = append(caps, c)
+	}
+	slices.Sort(caps)
+	slices.Reverse(caps)
+	clusters := make([]Cluster, len(caps))
+	for l, c := range caps {
+		name := "Level " + strconv.Itoa(l)
+		switch l {
+		case 0:
+			name = performance
+		case len(caps) - 1:
+			name = efficiency
+		}
+		clusters[l] = Cluster{Level: l, Name: name, CPUs: byCapacity[c]}
+	}
+	return clusters
+}
+
+// ClusterStat summarises a per-CPU reading over one cluster.
+type ClusterStat struct {
+	Min, Mean, Max float64
+	// CPUs is the number of readings that went into the summary.
+	CPUs int
+}
+
+// Aggregate summarises perCPU, a reading indexed by logical CPU number
+// such as usage or frequency, per cluster. It appends one ClusterStat per
+// cluster to dst in the order of Clusters. It is pure arithmetic over the
+// caller's sample, so per-cluster figures cost no system calls beyond the
+// per-core read. CPUs beyond the end of perCPU and NaN readings, which mark
+// CPUs without one, are left out; a cluster with none has CPUs 0.
+func (t *Topology) Aggregate(perCPU []float64, dst []ClusterStat) []ClusterStat {
+	start := len(dst)
+	for range t.Clusters {
+		dst = append(dst, ClusterStat{})
+	}
+	out := dst[start:]
+	for cpu, v := range perCPU {
+		if cpu >= len(t.ClusterOf) || t.ClusterOf[cpu] < 0 || math.IsNaN(v) {
+			continue
+		}
+		s := &out[t.ClusterOf[cpu]]
+		if s.CPUs == 0 || v < s.Min {
+			s.Min = v
+		}
+		if s.CPUs == 0 || v > s.Max {
+			s.Max = v
+		}
+		s.Mean += v
+		s.CPUs++
+	}
+	for i := range out {
+		if out[i].CPUs > 0 {
+			out[i].Mean /= float64(out[i].CPUs)
+		}
+	}
+	return dst
+}
@@ -0,0 +1,40 @@
+//go:build darwin
+
+package cpu
+
+import (
+	"strconv"
+	"syscall"
+
+	"github.com/sm-moshi/dmetrics-go/host"
+)
+
+// loadTopology reads the hw.perflevel sysctls. Intel Macs have no
+// perflevels and get a single cluster.
+func loadTopology() (*Topology, error) {
+	levels, err := syscall.SysctlUint32("hw.nperflevels")
+	if err != nil || levels == 0 {
+		n, err := host.LogicalCores()
+		if err != nil {
+			return nil, err
+		}
+		phys, _ := host.PhysicalCores()
+		return newTopology([]Cluster{{Name: "CPU", CPUs: cpuRange(0, n), PhysicalCores: phys}}), nil
+	}
+
+	perf := make([]perflevel, levels)
+	for l := range perf {
+		prefix := "hw.perflevel" + strconv.Itoa(l) + "."
+		logical, err := syscall.SysctlUint32(prefix + "logicalcpu")
+		if err != nil {
+			return nil, err
+		}
+		phys, _ := syscall.SysctlUint32(prefix + "physicalcpu")
+		name, err := syscall.Sysctl(prefix + "name")
+		if err != nil {
+			name = "Level " + strconv.Itoa(l)
+		}
+		perf[l] = perflevel{name: name, logical: int(logical), physical: int(phys)}
+	}
+	return newTopology(perflevelClusters(perf)), nil
+}
@@ -0,0 +1,90 @@
+//go:build linux
+
+package cpu
+
+import (
+	"errors"
+	"os"
+	"strconv"
+	"strings"
+)
+
+const (
+	sysCPU    = "/sys/devices/system/cpu/"
+	intelCore = "/sys/devices/cpu_core/cpus"
+	intelAtom = "/sys/devices/cpu_atom/cpus"
+)
+
+// loadTopology derives clusters from sysfs. Intel hybrid parts list their
+// P- and E-cores under the cpu_core and cpu_atom PMUs. On ARM big.LITTLE
+// systems cores are grouped by cpu_capacity, the highest capacity being
+// level 0. Anything else is a single cluster of the online CPUs.
+func loadTopology() (*Topology, error) {
+	online, err := readCPUList(sysCPU + "online")
+	if err != nil {
+		return nil, err
+	}
+	if p, err := readCPUList(intelCore); err == nil {
+		if e, err := readCPUList(intelAtom); err == nil {
+			return newTopology([]Cluster{
+				{Level: 0, Name: performance, CPUs: p},
+				{Level: 1, Name: efficiency, CPUs: e},
+			}), nil
+		}
+	}
+
+	caps := make([]int, len(online))
+	for i, cpu := range online {
+		b, err := os.ReadFile(sysCPU + "cpu" + strconv.Itoa(cpu) + "/cpu_capacity")
+		if err != nil {
+			caps = nil
+			break
+		}
+		if caps[i], err = strconv.Atoi(strings.TrimSpace(string(b))); err != nil {
+			caps = nil
+			break
+		}
+	}
+	if caps != nil {
+		if clusters := capacityClusters(online, caps); clusters != nil {
+			return newTopology(clusters), nil
+		}
+	}
+	return newTopology([]Cluster{{Name: "CPU", CPUs: online}}), nil
+}
+
+// readCPUList reads a kernel CPU list file.
+func readCPUList(path string) ([]int, error) {
+	b, err := os.ReadFile(path)
+	if err != nil {
+		return nil, err
+	}
+	return parseCPUList(string(b))
+}
+
+var errCPUList = errors.New("cpu: malformed CPU list")
+
+// parseCPUList parses a kernel CPU list such as "0-3,8,10-11".
+func parseCPUList(s string) ([]int, error) {
+	var cpus []int
+	for _, part := range strings.Split(strings.TrimSpace(s), ",") {
+		if part == "" {
+			continue
+		}
+		lo, hi, isRange := strings.Cut(part, "-")
+		first, err := strconv.Atoi(lo)
+		if err != nil || first < 0 {
+			return nil, errCPUList
+		}
+		last := first
+		if isRange {
+			if last, err = strconv.Atoi(hi); err != nil || last < first {
+				return nil, errCPUList
+			}
+		}
+		for c := first; c <= last; c++ {
+			cpus = append(cpus, c)
+		}
+	}
+	return cpus, nil
+}
@@ -0,0 +1,33 @@
+package cpu
+
+import (
+	"errors"
+	"slices"
+	"testing"
+)
+
+func TestParseCPUList(t *testing.T) {
+	for _, c := range []struct {
+		in   string
+		want []int
+		err  error
+	}{
+		{in: "0-3,8,10-11\n", want: []int{0, 1, 2, 3, 8, 10, 11}},
+		{in: "5", want: []int{5}},
+		{in: "0,0-1", want: []int{0, 0, 1}},
+		{in: ""},
+		{in: "\n"},
+		{in: "1,,2", want: []int{1, 2}},
+		{in: "a", err: errCPUList},
+		{in: "0-", err: errCPUList},
+		{in: "-1", err: errCPUList},
+		{in: "3-1", err: errCPUList},
+		{in: "0-3-5", err: errCPUList},
+		{in: "0 1", err: errCPUList},
+	} {
+		got, err := parseCPUList(c.in)
+		if !errors.Is(err, c.err) || !slices.Equal(got, c.want) {
+			t.Errorf("parseCPUList(%q) = %v, %v, want %v, %v", c.in, got, err, c.want, c.err)
+		}
+	}
+}
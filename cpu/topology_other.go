@@ -0,0 +1,7 @@
+//go:build !darwin && !linux
+
+package cpu
+
+func loadTopology() (*Topology, error) {
+	return nil, ErrUnsupported
+}
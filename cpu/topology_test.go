@@ -0,0 +1,58 @@
+package cpu
+
+import (
+	"math"
+	"reflect"
+	"testing"
+)
+
+func TestPerflevelClusters(t *testing.T) {
+	// An M1 Pro: eight P-cores at level 0, two E-cores numbered first.
+	got := perflevelClusters([]perflevel{
+		{name: "Performance", logical: 8, physical: 8},
+		{name: "Efficiency", logical: 2, physical: 2},
+	})
+	want := []Cluster{
+		{Level: 0, Name: "Performance", CPUs: []int{2, 3, 4, 5, 6, 7, 8, 9}, PhysicalCores: 8},
+		{Level: 1, Name: "Efficiency", CPUs: []int{0, 1}, PhysicalCores: 2},
+	}
+	if !reflect.DeepEqual(got, want) {
+		t.Fatalf("got %+v", got)
+	}
+	topo := newTopology(got)
+	if !reflect.DeepEqual(topo.ClusterOf, []int{1, 1, 0, 0, 0, 0, 0, 0, 0, 0}) {
+		t.Fatalf("ClusterOf %v", topo.ClusterOf)
+	}
+}
+
+func TestCapacityClusters(t *testing.T) {
+	// A DynamIQ part with one prime, three big and four little cores; CPU
+	// 5 is offline and missing from the list.
+	got := capacityClusters([]int{0, 1, 2, 3, 4, 6, 7, 8}, []int{400, 400, 400, 400, 1024, 870, 870, 870})
+	want := []Cluster{
+		{Level: 0, Name: performance, CPUs: []int{4}},
+		{Level: 1, Name: "Level 1", CPUs: []int{6, 7, 8}},
+		{Level: 2, Name: efficiency, CPUs: []int{0, 1, 2, 3}},
+	}
+	if !reflect.DeepEqual(got, want) {
+		t.Fatalf("got %+v", got)
+	}
+	if got := capacityClusters([]int{0, 1}, []int{1024, 1024}); got != nil {
+		t.Fatalf("uniform capacities grouped: %+v", got)
+	}
+
+	topo := newTopology(want)
+	if topo.ClusterOf[5] != -1 || topo.ClusterOf[4] != 0 || topo.ClusterOf[0] != 2 {
+		t.Fatalf("ClusterOf %v", topo.ClusterOf)
+	}
+	nan := math.NaN()
+	stats := topo.Aggregate([]float64{1, 2, 3, 4, 10, 99, 5, nan, 7, 42}, nil)
+	wantStats := []ClusterStat{
+		{Min: 10, Mean: 10, Max: 10, CPUs: 1},
+		{Min: 5, Mean: 6, Max: 7, CPUs: 2},
+		{Min: 1, Mean: 2.5, Max: 4, CPUs: 4},
+	}
+	if !reflect.DeepEqual(stats, wantStats) {
+		t.Fatalf("Aggregate %+v", stats)
+	}
+}
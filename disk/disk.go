@@ -0,0 +1,196 @@
+// Package disk reports block device I/O: bytes and operations per second,
+// average latency per operation and utilisation, derived from the kernel's
+// cumulative per-device counters.
+//
+// A Sampler reads every device's counters in one pass and keeps the
+// previous reading, so rates come from deltas between polls. Deltas are
+// wrap-safe and the steady state allocates nothing: the read buffer, the
+// counter slices and device names are reused between polls.
+package disk
+
+import (
+	"errors"
+	"math"
+	"time"
+
+	"github.com/sm-moshi/dmetrics-go/instrument"
+)
+
+// ErrUnsupported is returned on platforms without a disk source.
+var ErrUnsupported = errors.New("disk: not supported on this platform")
+
+// SectorSize is the unit of the kernel's sector counters, independent of
+// the device's physical sector size.
+const SectorSize = 512
+
+// Counters are the cumulative counters of one device, as the kernel keeps
+// them. Sectors are in units of SectorSize; times are the milliseconds spent
+// on operations.
+type Counters struct {
+	Device       string
+	Reads        uint64
+	Writes       uint64
+	ReadSectors  uint64
+	WriteSectors uint64
+	ReadTime     uint64
+	WriteTime    uint64
+	// IOTime is the milliseconds the device had I/O in flight. darwin does
+	// not track it, so it and Utilisation stay zero there.
+	IOTime uint64
+}
+
+// Rate is the activity of one device over an interval.
+type Rate struct {
+	Device         string
+	ReadBytesPerS  float64
+	WriteBytesPerS float64
+	ReadOpsPerS    float64
+	WriteOpsPerS   float64
+	ReadLatency    time.Duration
+	WriteLatency   time.Duration
+	Utilisation    float64 // 0 to 1
+	Interval       time.Duration
+}
+
+// source reads the counters of every device, appending them to dst. prev
+// is the previous reading, whose device names may be reused. It also
+// returns the number of IOKit calls made.
+type source interface {
+	read(dst, prev []Counters) ([]Counters, uint64, error)
+	close() error
+}
+
+// Sampler turns successive counter readings into rates. It is not safe
+// for concurrent use.
+type Sampler struct {
+	src    source
+	prev   []Counters
+	cur    []Counters
+	prevAt time.Time
+	stats  *instrument.Stats
+}
+
+// NewSampler opens the platform's disk statistics.
+func NewSampler() (*Sampler, error) {
+	src, err := openSource()
+	if err != nil {
+		return nil, err
+	}
+	return &Sampler{src: src, stats: instrument.For(instrument.Disk)}, nil
+}
+
+// Counters appends the current counters of every device to dst.
+func (s *Sampler) Counters(dst []Counters) ([]Counters, error) {
+	sp := s.stats.Start()
+	dst, calls, err := s.src.read(dst, s.prev)
+	sp.End(err)
+	s.stats.AddCalls(instrument.IOKit, calls)
+	return dst, err
+}
+
+// Sample reads the counters and appends to dst one Rate per device over
+// the interval since the previous Sample. The first call only records a
+// baseline and returns dst unchanged.
+func (s *Sampler) Sample(dst []Rate) ([]Rate, error) {
+	now := time.Now()
+	cur, err := s.Counters(s.cur[:0])
+	if err != nil {
+		return dst, err
+	}
+	if !s.prevAt.IsZero() {
+		dst = appendRates(dst, s.prev, cur, now.Sub(s.prevAt))
+	}
+	s.prev, s.cur = cur, s.prev
+	s.prevAt = now
+	return dst, nil
+}
+
+// Close releases the underlying statistics source.
+func (s *Sampler) Close() error {
+	return s.src.close()
+}
+
+func appendRates(dst []Rate, prev, cur []Counters, interval time.Duration) []Rate {
+	secs := interval.Seconds()
+	if secs <= 0 {
+		return dst
+	}
+	ms := interval.Milliseconds()
+	for i := range cur {
+		c := &cur[i]
+		p := find(prev, c.Device, i)
+		if p == nil {
+			// Devices that appeared since the last poll get a rate next time.
+			continue
+		}
+		reads, writes := delta(p.Reads, c.Reads, countMax), delta(p.Writes, c.Writes, countMax)
+		r := Rate{
+			Device: c.Device,
+			// Scale after taking the delta, so wraps are those of the raw
+			// sector counters.
+			ReadBytesPerS:  float64(delta(p.ReadSectors, c.ReadSectors, countMax)) * SectorSize / secs,
+			WriteBytesPerS: float64(delta(p.WriteSectors, c.WriteSectors, countMax)) * SectorSize / secs,
+			ReadOpsPerS:    float64(reads) / secs,
+			WriteOpsPerS:   float64(writes) / secs,
+			ReadLatency:    perOp(delta(p.ReadTime, c.ReadTime, timeMax), reads),
+			WriteLatency:   perOp(delta(p.WriteTime, c.WriteTime, timeMax), writes),
+			Interval:       interval,
+		}
+		if ms > 0 {
+			r.Utilisation = min(float64(delta(p.IOTime, c.IOTime, timeMax))/float64(ms), 1)
+		}
+		dst = append(dst, r)
+	}
+	return dst
+}
+
+// deviceName returns name as a string, reusing the string of an earlier
+// reading when the device is the same, so steady-state polls do not
+// allocate. dst's spare capacity holds the reading from two polls ago.
+func deviceName(name []byte, dst, prev []Counters) string {
+	i := len(dst)
+	if i < cap(dst) {
+		if old := dst[:i+1][i].Device; old == string(name) {
+			return old
+		}
+	}
+	if p := find(prev, string(name), i); p != nil {
+		return p.Device
+	}
+	return string(name)
+}
+
+// find returns the entry for device in prev, looking first at the index it
+// had in the current reading since device order rarely changes.
+func find(prev []Counters, device string, hint int) *Counters {
+	if hint < len(prev) && prev[hint].Device == device {
+		return &prev[hint]
+	}
+	for i := range prev {
+		if prev[i].Device == device {
+			return &prev[i]
+		}
+	}
+	return nil
+}
+
+// delta returns the increase from prev to cur of a counter that wraps
+// after limit. A decrease is a wrap if the counter is narrower than 64 bits;
+// otherwise it is a reset and counts as no activity rather than a spike.
+func delta(prev, cur, limit uint64) uint64 {
+	switch {
+	case cur >= prev:
+		return cur - prev
+	case limit < math.MaxUint64 && prev <= limit:
+		return cur + (limit - prev) + 1
+	default:
+		return 0
+	}
+}
+
+func perOp(ms, ops uint64) time.Duration {
+	if ops == 0 {
+		return 0
+	}
+	return time.Duration(ms) * time.Millisecond / time.Duration(ops)
+}
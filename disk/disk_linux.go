@@ -0,0 +1,134 @@
+//go:build linux
+
+package disk
+
+import (
+	"bytes"
+	"errors"
+	"math"
+	"os"
+
+	"github.com/sm-moshi/dmetrics-go/internal/procfs"
+)
+
+const (
+	diskstatsPath = "/proc/diskstats"
+	initialBuf    = 4096
+)
+
+// Largest values of the kernel counters, past which they wrap: operation
+// and sector counts are unsigned longs, the word size of the platform, and
+// times are 32-bit.
+const (
+	countMax = math.MaxUint
+	timeMax  = math.MaxUint32
+)
+
+// Field positions in a /proc/diskstats line, after major, minor and name.
+const (
+	fieldName = 2 + iota
+	fieldReads
+	fieldReadsMerged
+	fieldReadSectors
+	fieldReadTime
+	fieldWrites
+	fieldWritesMerged
+	fieldWriteSectors
+	fieldWriteTime
+	fieldInFlight
+	fieldIOTime
+	minFields
+)
+
+var errMalformed = errors.New("disk: malformed " + diskstatsPath)
+
+type procSource struct {
+	f   *os.File
+	buf []byte
+}
+
+func openSource() (source, error) {
+	f, err := os.Open(diskstatsPath)
+	if err != nil {
+		return nil, err
+	}
+	return &procSource{f: f, buf: make([]byte, initialBuf)}, nil
+}
+
+func (s *procSource) close() error {
+	return s.f.Close()
+}
+
+func (s *procSource) read(dst, prev []Counters) ([]Counters, uint64, error) {
+	data, err := procfs.Reread(s.f, &s.buf)
+	if err != nil {
+		return dst, 0, err
+	}
+	for len(data) > 0 {
+		var line []byte
+		line, data, _ = bytes.Cut(data, []byte{'\n'})
+		c, name, err := parseLine(line)
+		if err != nil {
+			return dst, 0, err
+		}
+		if name == nil {
+			continue
+		}
+		c.Device = deviceName(name, dst, prev)
+		dst = append(dst, c)
+	}
+	return dst, 0, nil
+}
+
+// parseLine parses one line into counters and the device name, which
+// aliases line. Blank lines and devices that never did any I/O, such as
+// unused loop and ram devices, return a nil name.
+func parseLine(line []byte) (Counters, []byte, error) {
+	var (
+		c      Counters
+		f      [minFields]uint64
+		name   []byte
+		nField int
+	)
+	for field := 0; len(line) > 0 && field < minFields; field++ {
+		line = bytes.TrimLeft(line, " \t")
+		if len(line) == 0 {
+			break
+		}
+		tok := line
+		if i := bytes.IndexAny(line, " \t"); i >= 0 {
+			tok, line = line[:i], line[i:]
+		} else {
+			line = nil
+		}
+		nField++
+		if field == fieldName {
+			name = tok
+			continue
+		}
+		v, ok := procfs.ParseUint(tok)
+		if !ok {
+			return c, nil, errMalformed
+		}
+		f[field] = v
+	}
+	if nField == 0 {
+		return c, nil, nil
+	}
+	if nField < minFields {
+		return c, nil, errMalformed
+	}
+	c = Counters{
+		Reads:        f[fieldReads],
+		Writes:       f[fieldWrites],
+		ReadSectors:  f[fieldReadSectors],
+		WriteSectors: f[fieldWriteSectors],
+		ReadTime:     f[fieldReadTime],
+		WriteTime:    f[fieldWriteTime],
+		IOTime:       f[fieldIOTime],
+	}
+	if c.Reads == 0 && c.Writes == 0 {
+		return c, nil, nil
+	}
+	return c, name, nil
+}
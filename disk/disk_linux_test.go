@@ -0,0 +1,114 @@
+package disk
+
+import (
+	"errors"
+	"os"
+	"path/filepath"
+	"testing"
+
+	"github.com/sm-moshi/dmetrics-go/instrument"
+)
+
+// diskstats is a /proc/diskstats with an idle loop device, a current kernel's
+// 17 counters and a pre-4.18 kernel's 11.
+const diskstats = `   7       0 loop0 0 0 0 0 0 0 0 0 0 0 0 0 0 0 0 0 0
+ 259       0 nvme0n1 169412 51338 13413426 36915 1234167 870224 62823712 1098271 0 599176 1158413 0 0 0 0 12345 23217
+ 259       1 nvme0n1p1 313 1000 12342 53 2 0 2 0 0 96 53 0 0 0 0 0 0
+   8       0 sda 100 0 800 10 50 0 400 5 0 12 15
+
+`
+
+func openFixture(t testing.TB, data string) *procSource {
+	t.Helper()
+	path := filepath.Join(t.TempDir(), "diskstats")
+	if err := os.WriteFile(path, []byte(data), 0o600); err != nil {
+		t.Fatal(err)
+	}
+	f, err := os.Open(path)
+	if err != nil {
+		t.Fatal(err)
+	}
+	t.Cleanup(func() { _ = f.Close() })
+	// A small buffer so load has to grow it.
+	return &procSource{f: f, buf: make([]byte, 16)}
+}
+
+func TestParseLine(t *testing.T) {
+	for _, c := range []struct {
+		line string
+		name string
+		want Counters
+		err  error
+	}{
+		{line: ""},
+		{line: "   "},
+		{line: "   7       0 loop0 0 0 0 0 0 0 0 0 0 0 0 0 0 0 0 0 0"},
+		{
+			line: "   8       0 sda 100 0 800 10 50 0 400 5 0 12 15",
+			name: "sda",
+			want: Counters{Reads: 100, ReadSectors: 800, ReadTime: 10, Writes: 50, WriteSectors: 400, WriteTime: 5, IOTime: 12},
+		},
+		{
+			line: "8\t1\tsda1\t1 2 3 4 5 6 7 8 9 10 11",
+			name: "sda1",
+			want: Counters{Reads: 1, ReadSectors: 3, ReadTime: 4, Writes: 5, WriteSectors: 7, WriteTime: 8, IOTime: 10},
+		},
+		{line: "8 0 sdb 1 2 x 4 5 6 7 8 9 10", err: errMalformed},
+		{line: "8 0 sdb 1 2 3", err: errMalformed},
+		{line: "8 0 sdb -1 2 3 4 5 6 7 8 9 10", err: errMalformed},
+	} {
+		got, name, err := parseLine([]byte(c.line))
+		if !errors.Is(err, c.err) || string(name) != c.name || (c.name != "" && got != c.want) {
+			t.Errorf("%q: %+v %q %v, want %+v %q %v", c.line, got, name, err, c.want, c.name, c.err)
+		}
+	}
+}
+
+func TestReadFixture(t *testing.T) {
+	src := openFixture(t, diskstats)
+	var got []Counters
+	for i := 0; i < 2; i++ {
+		var err error
+		if got, _, err = src.read(got[:0], got); err != nil {
+			t.Fatal(err)
+		}
+	}
+	want := []Counters{
+		{Device: "nvme0n1", Reads: 169412, ReadSectors: 13413426, ReadTime: 36915, Writes: 1234167, WriteSectors: 62823712, WriteTime: 1098271, IOTime: 599176},
+		{Device: "nvme0n1p1", Reads: 313, ReadSectors: 12342, ReadTime: 53, Writes: 2, WriteSectors: 2, IOTime: 96},
+		{Device: "sda", Reads: 100, ReadSectors: 800, ReadTime: 10, Writes: 50, WriteSectors: 400, WriteTime: 5, IOTime: 12},
+	}
+	if len(got) != len(want) {
+		t.Fatalf("got %+v", got)
+	}
+	for i := range want {
+		if got[i] != want[i] {
+			t.Errorf("device %d: %+v, want %+v", i, got[i], want[i])
+		}
+	}
+
+	if _, _, err := openFixture(t, "8 0 sda 1 2\n").read(nil, nil); !errors.Is(err, errMalformed) {
+		t.Fatalf("short line: %v", err)
+	}
+}
+
+func TestSampleDoesNotAllocate(t *testing.T) {
+	s := &Sampler{src: openFixture(t, diskstats), stats: instrument.For(instrument.Disk)}
+	var dst []Rate
+	var err error
+	// Two polls fill both counter slices and the read buffer.
+	for i := 0; i < 3; i++ {
+		if dst, err = s.Sample(dst[:0]); err != nil {
+			t.Fatal(err)
+		}
+	}
+	if len(dst) != 3 {
+		t.Fatalf("%d rates", len(dst))
+	}
+	allocs := testing.AllocsPerRun(100, func() {
+		dst, err = s.Sample(dst[:0])
+	})
+	if err != nil || allocs != 0 {
+		t.Fatalf("%v allocations per Sample, err %v", allocs, err)
+	}
+}
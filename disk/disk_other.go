@@ -0,0 +1,18 @@
+//go:build !linux && !(darwin && cgo)
+
+package disk
+
+import "math"
+
+// No source reads counters here; the widths only keep appendRates
+// compiling.
+const (
+	countMax = math.MaxUint64
+	timeMax  = math.MaxUint64
+)
+
+// openSource fails on platforms without a disk source. On darwin the
+// counters come from IOKit, which needs cgo.
+func openSource() (source, error) {
+	return nil, ErrUnsupported
+}
@@ -0,0 +1,72 @@
+package disk
+
+import (
+	"errors"
+	"math"
+	"testing"
+	"time"
+)
+
+func TestDelta(t *testing.T) {
+	for _, c := range []struct {
+		prev, cur, limit, want uint64
+	}{
+		{10, 15, math.MaxUint32, 5},
+		{math.MaxUint32 - 1, 3, math.MaxUint32, 5}, // a 32-bit wrap
+		{math.MaxUint32, 0, math.MaxUint32, 1},
+		{math.MaxUint32 - 1, 3, math.MaxUint64, 0}, // a 64-bit counter reset
+		{1 << 40, 5, math.MaxUint32, 0},            // past the width: a reset
+		{7, 7, math.MaxUint64, 0},
+	} {
+		if got := delta(c.prev, c.cur, c.limit); got != c.want {
+			t.Errorf("delta(%d, %d, %d) = %d, want %d", c.prev, c.cur, c.limit, got, c.want)
+		}
+	}
+}
+
+func TestRatesAcrossWrapAndReset(t *testing.T) {
+	if countMax != math.MaxUint64 || timeMax == math.MaxUint64 {
+		t.Skip("counter widths differ on this platform")
+	}
+	prev := []Counters{
+		{Device: "sda", Reads: 100, ReadSectors: 1000, ReadTime: math.MaxUint32 - 9, IOTime: math.MaxUint32 - 99},
+		{Device: "sdb", Reads: 1 << 40, Writes: 1 << 40, ReadSectors: 1 << 40, ReadTime: 500, IOTime: 800},
+	}
+	cur := []Counters{
+		// sdb was reset, as when a device is removed and a new one gets
+		// its name; sda's 32-bit times wrapped.
+		{Device: "sdb", Reads: 4, Writes: 2, ReadSectors: 8, ReadTime: 10, IOTime: 20},
+		{Device: "sda", Reads: 110, ReadSectors: 1020, ReadTime: 10, IOTime: 400},
+		{Device: "sdc", Reads: 1},
+	}
+	got := appendRates(nil, prev, cur, time.Second)
+	if len(got) != 2 {
+		t.Fatalf("rates %+v", got)
+	}
+	if r := got[0]; r.Device != "sdb" || r.ReadOpsPerS != 0 || r.WriteOpsPerS != 0 || r.ReadBytesPerS != 0 || r.ReadLatency != 0 {
+		t.Errorf("reset device %+v", r)
+	}
+	if r := got[1]; r.Device != "sda" || r.ReadOpsPerS != 10 || r.ReadBytesPerS != 20*SectorSize ||
+		r.ReadLatency != 2*time.Millisecond || r.Utilisation != 0.5 {
+		t.Errorf("wrapped device %+v", r)
+	}
+}
+
+// BenchmarkSample polls the host's devices, the collector's steady state.
+func BenchmarkSample(b *testing.B) {
+	s, err := NewSampler()
+	if errors.Is(err, ErrUnsupported) {
+		b.Skip(err)
+	}
+	if err != nil {
+		b.Fatal(err)
+	}
+	defer func() { _ = s.Close() }()
+	var dst []Rate
+	b.ReportAllocs()
+	for i := 0; i < b.N; i++ {
+		if dst, err = s.Sample(dst[:0]); err != nil {
+			b.Fatal(err)
+		}
+	}
+}
@@ -0,0 +1,124 @@
+// Package filesystem reports capacity, free space and inode usage of the
+// mounted filesystems.
+//
+// A poll costs one getfsstat(2) call on darwin. On Linux it is one read of
+// /proc/self/mountinfo plus one statfs(2) per mount; the mount table is
+// only parsed again when it changed. Network and pseudo filesystems are
+// skipped unless asked for, and on Linux every statfs runs under a
+// timeout, so a hung network mount cannot stall a poll.
+package filesystem
+
+import (
+	"errors"
+	"time"
+
+	"github.com/sm-moshi/dmetrics-go/instrument"
+)
+
+// DefaultTimeout bounds the statfs of each mount on Linux.
+const DefaultTimeout = time.Second
+
+var (
+	// ErrUnsupported is returned on platforms without a mount source.
+	ErrUnsupported = errors.New("filesystem: not supported on this platform")
+	// ErrTimeout is returned alongside the usage of the mounts that did
+	// answer when some did not within the timeout. Such mounts are left
+	// out of later polls until their pending statfs returns.
+	ErrTimeout = errors.New("filesystem: statfs timed out")
+)
+
+// Usage is the usage of one mounted filesystem. Sizes are in bytes.
+type Usage struct {
+	Mountpoint string
+	Device     string
+	Type       string
+	ReadOnly   bool
+	Total      uint64
+	Free       uint64
+	// Avail is the space available to unprivileged users, which excludes
+	// blocks reserved for root.
+	Avail      uint64
+	Used       uint64
+	Inodes     uint64
+	InodesFree uint64
+}
+
+// Options configure a Collector.
+type Options struct {
+	// IncludeNetwork reports network filesystems such as NFS and SMB.
+	IncludeNetwork bool
+	// IncludePseudo reports pseudo filesystems such as proc, sysfs and
+	// devfs.
+	IncludePseudo bool
+	// Timeout bounds the statfs of each mount on Linux. Mounts are queried
+	// concurrently, so it also bounds a whole poll. Defaults to
+	// DefaultTimeout.
+	Timeout time.Duration
+}
+
+func (o *Options) setDefaults() {
+	if o.Timeout <= 0 {
+		o.Timeout = DefaultTimeout
+	}
+}
+
+// Collector polls filesystem usage, caching mount metadata between polls.
+// It is not safe for concurrent use.
+type Collector struct {
+	opts  Options
+	stats *instrument.Stats
+	platform
+}
+
+// New returns a Collector. Nothing is read until the first Usage call.
+func New(opts Options) *Collector {
+	opts.setDefaults()
+	return &Collector{opts: opts, stats: instrument.For(instrument.Filesystem)}
+}
+
+// Usage appends the usage of every reported mount to dst.
+func (c *Collector) Usage(dst []Usage) ([]Usage, error) {
+	sp := c.stats.Start()
+	dst, calls, err := c.collect(dst)
+	c.stats.AddCalls(instrument.Sysctl, calls)
+	sp.End(err)
+	return dst, err
+}
+
+// networkTypes are filesystem types served over the network.
+var networkTypes = map[string]bool{
+	"9p": true, "afpfs": true, "afs": true, "ceph": true, "cifs": true,
+	"fuse.sshfs": true, "glusterfs": true, "lustre": true, "ncpfs": true,
+	"nfs": true, "nfs4": true, "smb3": true, "smbfs": true, "webdav": true,
+}
+
+// pseudoTypes are filesystem types without backing storage worth
+// reporting. tmpfs is not among them since it consumes memory.
+var pseudoTypes = map[string]bool{
+	"autofs": true, "binfmt_misc": true, "bpf": true, "cgroup": true,
+	"cgroup2": true, "configfs": true, "debugfs": true, "devfs": true,
+	"devpts": true, "devtmpfs": true, "fusectl": true, "hugetlbfs": true,
+	"mqueue": true, "nsfs": true, "nullfs": true, "proc": true,
+	"pstore": true, "rpc_pipefs": true, "securityfs": true,
+	"selinuxfs": true, "squashfs": true, "sysfs": true, "tracefs": true,
+}
+
+// skip reports whether a mount of fsType is left out. local is false for
+// mounts the platform itself flags as remote.
+func (o *Options) skip(fsType string, local bool) bool {
+	if (!local || networkTypes[fsType]) && !o.IncludeNetwork {
+		return true
+	}
+	return pseudoTypes[fsType] && !o.IncludePseudo
+}
+
+func usage(bsize, blocks, bfree, bavail, files, ffree uint64) Usage {
+	return Usage{
+		Total:      blocks * bsize,
+		Free:       bfree * bsize,
+		Avail:      bavail * bsize,
+		Used:       (blocks - min(bfree, blocks)) * bsize,
+		Inodes:     files,
+		InodesFree: ffree,
+	}
+}
@@ -0,0 +1,98 @@
+//go:build darwin
+
+package filesystem
+
+import "syscall"
+
+// getfsstat(2) flags and statfs f_flags bits from <sys/mount.h>.
+const (
+	mntNoWait = 2
+	mntRdOnly = 0x1
+	mntLocal  = 0x1000
+)
+
+// spareEntries is headroom for mounts appearing between sizing the buffer
+// and filling it, and later on; the buffer is kept across polls.
+const spareEntries = 4
+
+// platform caches the getfsstat buffer and the strings of the previous
+// poll, so unchanged mounts cost no allocation.
+type platform struct {
+	buf  []syscall.Statfs_t
+	prev []Usage
+}
+
+// collect reads every mount in one getfsstat call. MNT_NOWAIT returns the
+// statistics the kernel has cached instead of querying each filesystem,
+// so a hung network mount cannot block it and no timeout is needed.
+func (c *Collector) collect(dst []Usage) ([]Usage, uint64, error) {
+	var calls uint64
+	var n int
+	for {
+		if len(c.buf) == 0 {
+			size, err := syscall.Getfsstat(nil, mntNoWait)
+			calls++
+			if err != nil {
+				return dst, calls, err
+			}
+			c.buf = make([]syscall.Statfs_t, size+spareEntries)
+		}
+		var err error
+		n, err = syscall.Getfsstat(c.buf, mntNoWait)
+		calls++
+		if err != nil {
+			return dst, calls, err
+		}
+		if n < len(c.buf) {
+			break
+		}
+		// A full buffer may have cut the list short: grow it and retry.
+		c.buf = make([]syscall.Statfs_t, 2*len(c.buf))
+	}
+	start := len(dst)
+	for i := range c.buf[:n] {
+		st := &c.buf[i]
+		fsType := c.cached(st.Fstypename[:], func(u *Usage) string { return u.Type })
+		if c.opts.skip(fsType, st.Flags&mntLocal != 0) {
+			continue
+		}
+		u := usage(uint64(st.Bsize), st.Blocks, st.Bfree, st.Bavail, st.Files, st.Ffree)
+		u.Type = fsType
+		u.Mountpoint = c.cached(st.Mntonname[:], func(u *Usage) string { return u.Mountpoint })
+		u.Device = c.cached(st.Mntfromname[:], func(u *Usage) string { return u.Device })
+		u.ReadOnly = st.Flags&mntRdOnly != 0
+		dst = append(dst, u)
+	}
+	c.prev = append(c.prev[:0], dst[start:]...)
+	return dst, calls, nil
+}
+
+// cached returns the NUL-terminated name as a string, reusing the string
+// of a mount from the previous poll when one matches.
+func (c *Collector) cached(name []int8, field func(*Usage) string) string {
+	for i := range c.prev {
+		if s := field(&c.prev[i]); equalC(name, s) {
+			return s
+		}
+	}
+	b := make([]byte, 0, len(name))
+	for _, ch := range name {
+		if ch == 0 {
+			break
+		}
+		b = append(b, byte(ch))
+	}
+	return string(b)
+}
+
+func equalC(name []int8, s string) bool {
+	if len(s) >= len(name) || name[len(s)] != 0 {
+		return false
+	}
+	for i := 0; i < len(s); i++ {
+		if byte(name[i]) != s[i] {
+			return false
+		}
+	}
+	return true
+}
@@ -0,0 +1,230 @@
+//go:build linux
+
+package filesystem
+
+import (
+	"bytes"
+	"errors"
+	"os"
+	"strings"
+	"sync/atomic"
+	"syscall"
+	"time"
+
+	"github.com/sm-moshi/dmetrics-go/internal/procfs"
+)
+
+const (
+	mountinfoPath = "/proc/self/mountinfo"
+	initialBuf    = 8192
+)
+
+// Field positions in a /proc/self/mountinfo line. The optional fields
+// after the mount options end with a lone "-", followed by the type and
+// source.
+const (
+	fieldDevID      = 2
+	fieldMountpoint = 4
+	fieldOptions    = 5
+	minFields       = 10
+)
+
+var errMalformed = errors.New("filesystem: malformed " + mountinfoPath)
+
+// mount is the cached metadata of one mount. A mount whose statfs is
+// still pending from an earlier poll is busy and skipped.
+type mount struct {
+	Usage
+	busy   atomic.Bool
+	st     syscall.Statfs_t
+	err    error
+	polled uint64
+}
+
+type platform struct {
+	f       *os.File
+	buf     []byte
+	table   []byte // the mountinfo the mounts were parsed from
+	mounts  []*mount
+	byPoint map[string]*mount
+	poll    uint64
+}
+
+func (c *Collector) collect(dst []Usage) ([]Usage, uint64, error) {
+	if err := c.loadMounts(); err != nil {
+		return dst, 0, err
+	}
+	c.poll++
+	done := make(chan *mount, len(c.mounts))
+	pending, hung := 0, false
+	for _, m := range c.mounts {
+		if !m.busy.CompareAndSwap(false, true) {
+			hung = true
+			continue
+		}
+		pending++
+		go func(m *mount) {
+			m.err = syscall.Statfs(m.Mountpoint, &m.st)
+			m.busy.Store(false)
+			done <- m
+		}(m)
+	}
+	calls := uint64(pending)
+
+	var err error
+	if hung {
+		err = ErrTimeout
+	}
+	timer := time.NewTimer(c.opts.Timeout)
+	defer timer.Stop()
+wait:
+	for pending > 0 {
+		select {
+		case m := <-done:
+			m.polled = c.poll
+			pending--
+		case <-timer.C:
+			err = ErrTimeout
+			break wait
+		}
+	}
+
+	for _, m := range c.mounts {
+		if m.polled != c.poll || m.err != nil {
+			continue
+		}
+		st := &m.st
+		bsize := uint64(st.Frsize)
+		if bsize == 0 {
+			bsize = uint64(st.Bsize)
+		}
+		u := usage(bsize, st.Blocks, st.Bfree, st.Bavail, st.Files, st.Ffree)
+		u.Mountpoint, u.Device, u.Type, u.ReadOnly = m.Mountpoint, m.Device, m.Type, m.ReadOnly
+		dst = append(dst, u)
+	}
+	return dst, calls, err
+}
+
+// loadMounts reads the mount table and parses it again only if it differs
+// from the one the cached mounts came from.
+func (c *Collector) loadMounts() error {
+	if c.f == nil {
+		f, err := os.Open(mountinfoPath)
+		if err != nil {
+			return err
+		}
+		c.f, c.buf = f, make([]byte, initialBuf)
+	}
+	data, err := procfs.Reread(c.f, &c.buf)
+	if err != nil {
+		return err
+	}
+	if c.table != nil && bytes.Equal(data, c.table) {
+		return nil
+	}
+	mounts, err := c.parse(data)
+	if err != nil {
+		return err
+	}
+	c.table = append(c.table[:0], data...)
+	c.mounts = mounts
+	return nil
+}
+
+// parse builds the mount list, keeping the first mount of each device so
+// bind mounts are not reported twice, and carrying over the cached mounts
+// that are still present.
+func (c *Collector) parse(data []byte) ([]*mount, error) {
+	var (
+		mounts  []*mount
+		byPoint = make(map[string]*mount)
+		devices = make(map[string]bool)
+	)
+	for _, line := range strings.Split(string(data), "\n") {
+		if line == "" {
+			continue
+		}
+		f := strings.Fields(line)
+		sep := -1
+		for i := fieldOptions + 1; i < len(f); i++ {
+			if f[i] == "-" {
+				sep = i
+				break
+			}
+		}
+		if len(f) < minFields || sep < 0 || sep+2 >= len(f) {
+			return nil, errMalformed
+		}
+		fsType, device := f[sep+1], unescape(f[sep+2])
+		if c.opts.skip(fsType, true) || devices[f[fieldDevID]] {
+			continue
+		}
+		devices[f[fieldDevID]] = true
+		point := unescape(f[fieldMountpoint])
+		m := c.byPoint[point]
+		if m == nil || m.Type != fsType || m.Device != device {
+			m = &mount{Usage: Usage{Mountpoint: point, Device: device, Type: fsType}}
+		}
+		m.ReadOnly = hasOption(f[fieldOptions], "ro")
+		if prev, ok := byPoint[point]; ok {
+			// A later mount on the same point hides the earlier one.
+			for i := range mounts {
+				if mounts[i] == prev {
+					mounts = append(mounts[:i], mounts[i+1:]...)
+					break
+				}
+			}
+		}
+		byPoint[point] = m
+		mounts = append(mounts, m)
+	}
+	c.byPoint = byPoint
+	return mounts, nil
+}
+
+func hasOption(opts, opt string) bool {
+	for opts != "" {
+		var o string
+		o, opts, _ = strings.Cut(opts, ",")
+		if o == opt {
+			return true
+		}
+	}
+	return false
+}
+
+// unescape decodes the octal escapes (\040 for space and so on) the kernel
+// uses for whitespace and backslashes in paths.
+func unescape(s string) string {
+	if !strings.Contains(s, `\`) {
+		return s
+	}
+	const escLen = 4
+	var b strings.Builder
+	for i := 0; i < len(s); i++ {
+		if s[i] == '\\' && i+escLen <= len(s) {
+			if v, ok := octal(s[i+1 : i+escLen]); ok {
+				b.WriteByte(v)
+				i += escLen - 1
+				continue
+			}
+		}
+		b.WriteByte(s[i])
+	}
+	return b.String()
+}
+
+func octal(s string) (byte, bool) {
+	const (
+		octalBits = 3
+		maxByte   = 0xff
+	)
+	var v int
+	for i := 0; i < len(s); i++ {
+		if s[i] < '0' || s[i] > '7' {
+			return 0, false
+		}
+		v = v<<octalBits | int(s[i]-'0')
+	}
+	return byte(v), v <= maxByte
+}
@@ -0,0 +1,154 @@
+package filesystem
+
+import (
+	"errors"
+	"os"
+	"path/filepath"
+	"strings"
+	"testing"
+)
+
+func TestUnescape(t *testing.T) {
+	for in, want := range map[string]string{
+		`/plain`:          `/plain`,
+		`/my\040disk`:     `/my disk`,
+		`/back\134slash`:  `/back\slash`,
+		`/tab\011end\012`: "/tab\tend\n",
+		`/bad\999`:        `/bad\999`, // not octal
+		`/big\400`:        `/big\400`, // past a byte
+		`/short\04`:       `/short\04`,
+		`/trailing\`:      `/trailing\`,
+	} {
+		if got := unescape(in); got != want {
+			t.Errorf("unescape(%q) = %q, want %q", in, got, want)
+		}
+	}
+}
+
+// mountinfo has optional fields of every count, a bind mount of the root
+// device, pseudo and network mounts, escaped paths and an overmount.
+const mountinfo = `22 1 8:1 / / rw,relatime shared:1 - ext4 /dev/sda1 rw
+23 22 0:21 / /proc rw,nosuid - proc proc rw
+24 22 8:1 /srv /mnt/bind rw shared:1 master:2 - ext4 /dev/sda1 rw
+25 22 8:16 / /mnt/my\040disk ro,noatime - ext4 /dev/disk\134by-label rw
+26 22 0:50 / /mnt/nfs rw - nfs4 server:/export rw,vers=4.2
+27 22 8:32 / /data rw - xfs /dev/sdc rw
+28 22 8:48 / /data rw shared:7 - xfs /dev/sdd rw
+29 22 0:53 / /tmp rw - tmpfs tmpfs rw
+`
+
+func points(ms []*mount) string {
+	var b []string
+	for _, m := range ms {
+		s := m.Mountpoint + " " + m.Type + " " + m.Device
+		if m.ReadOnly {
+			s += " ro"
+		}
+		b = append(b, s)
+	}
+	return strings.Join(b, "; ")
+}
+
+func TestParse(t *testing.T) {
+	for _, c := range []struct {
+		opts Options
+		want string
+	}{
+		{Options{}, `/ ext4 /dev/sda1; /mnt/my disk ext4 /dev/disk\by-label ro; /data xfs /dev/sdd; /tmp tmpfs tmpfs`},
+		{
+			Options{IncludePseudo: true, IncludeNetwork: true},
+			`/ ext4 /dev/sda1; /proc proc proc; /mnt/my disk ext4 /dev/disk\by-label ro; /mnt/nfs nfs4 server:/export; /data xfs /dev/sdd; /tmp tmpfs tmpfs`,
+		},
+	} {
+		ms, err := New(c.opts).parse([]byte(mountinfo))
+		if err != nil {
+			t.Fatal(err)
+		}
+		if got := points(ms); got != c.want {
+			t.Errorf("%+v:\n got %s\nwant %s", c.opts, got, c.want)
+		}
+	}
+}
+
+func TestParseMalformed(t *testing.T) {
+	for _, line := range []string{
+		"22 1 8:1 / / rw,relatime shared:1 ext4 /dev/sda1 rw", // no separator
+		"22 1 8:1 / / rw,relatime -",                          // nothing after it
+		"22 1 8:1 / / rw - ext4",                              // no source
+		"22 1 8:1 / /",
+	} {
+		if _, err := New(Options{}).parse([]byte(line + "\n")); !errors.Is(err, errMalformed) {
+			t.Errorf("%q: %v", line, err)
+		}
+	}
+}
+
+func TestParseCarriesMountsOver(t *testing.T) {
+	c := New(Options{})
+	before, err := c.parse([]byte(mountinfo))
+	if err != nil {
+		t.Fatal(err)
+	}
+	changed := strings.Replace(mountinfo, "/dev/sdd", "/dev/sde", 1)
+	changed = strings.Replace(changed, "/ / rw,relatime", "/ / ro,relatime", 1)
+	changed += "30 22 8:64 / /home rw - ext4 /dev/sdf rw\n"
+	after, err := c.parse([]byte(changed))
+	if err != nil {
+		t.Fatal(err)
+	}
+	if len(after) != len(before)+1 {
+		t.Fatalf("mounts %s", points(after))
+	}
+	// The unchanged mounts keep their cached entries, with options read
+	// afresh; a different device on the same point gets a new one.
+	if after[0] != before[0] || !after[0].ReadOnly || after[1] != before[1] || after[3] != before[3] {
+		t.Errorf("mounts not carried over: %s", points(after))
+	}
+	if after[2] == before[2] || after[2].Device != "/dev/sde" {
+		t.Errorf("replaced mount kept: %s", points(after))
+	}
+}
+
+// fixtureCollector returns a collector reading table as its mount table.
+func fixtureCollector(t *testing.T, table string) *Collector {
+	t.Helper()
+	path := filepath.Join(t.TempDir(), "mountinfo")
+	if err := os.WriteFile(path, []byte(table), 0o600); err != nil {
+		t.Fatal(err)
+	}
+	f, err := os.Open(path)
+	if err != nil {
+		t.Fatal(err)
+	}
+	t.Cleanup(func() { _ = f.Close() })
+	c := New(Options{})
+	c.f, c.buf = f, make([]byte, 16)
+	return c
+}
+
+func TestTimeoutKeepsPartialResults(t *testing.T) {
+	dir := t.TempDir()
+	spaced := filepath.Join(dir, "my disk")
+	if err := os.Mkdir(spaced, 0o700); err != nil {
+		t.Fatal(err)
+	}
+	c := fixtureCollector(t, "40 1 8:1 / "+dir+" rw - ext4 /dev/a rw\n"+
+		"41 1 8:2 / "+strings.ReplaceAll(spaced, " ", `\040`)+" rw - ext4 /dev/b rw\n")
+
+	got, err := c.Usage(nil)
+	if err != nil || len(got) != 2 || got[1].Mountpoint != spaced || got[1].Total == 0 {
+		t.Fatalf("first poll: %+v, %v", got, err)
+	}
+
+	// A statfs still pending from an earlier poll keeps its mount out and
+	// the poll reports the timeout next to the other mounts' usage.
+	c.mounts[1].busy.Store(true)
+	got, err = c.Usage(got[:0])
+	if !errors.Is(err, ErrTimeout) || len(got) != 1 || got[0].Device != "/dev/a" {
+		t.Fatalf("hung mount: %+v, %v", got, err)
+	}
+	c.mounts[1].busy.Store(false)
+	if got, err = c.Usage(got[:0]); err != nil || len(got) != 2 {
+		t.Fatalf("recovered mount: %+v, %v", got, err)
+	}
+}
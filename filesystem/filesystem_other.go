@@ -0,0 +1,9 @@
+//go:build !darwin && !linux
+
+package filesystem
+
+type platform struct{}
+
+func (c *Collector) collect(dst []Usage) ([]Usage, uint64, error) {
+	return dst, 0, ErrUnsupported
+}
@@ -0,0 +1,25 @@
+package filesystem
+
+import (
+	"errors"
+	"testing"
+)
+
+// BenchmarkUsage polls the host's mounts with the mount table cached.
+func BenchmarkUsage(b *testing.B) {
+	c := New(Options{})
+	dst, err := c.Usage(nil)
+	if errors.Is(err, ErrUnsupported) {
+		b.Skip(err)
+	}
+	if err != nil {
+		b.Fatal(err)
+	}
+	b.ReportAllocs()
+	b.ResetTimer()
+	for i := 0; i < b.N; i++ {
+		if dst, err = c.Usage(dst[:0]); err != nil {
+			b.Fatal(err)
+		}
+	}
+}
@@ -0,0 +1,88 @@
+package history
+
+// bstream is an append-only bit stream.
+type bstream struct {
+	b    []byte
+	free uint8 // unused low bits in the last byte
+}
+
+const byteBits = 8
+
+func (w *bstream) writeBit(bit bool) {
+	if w.free == 0 {
+		w.b = append(w.b, 0)
+		w.free = byteBits
+	}
+	w.free--
+	if bit {
+		w.b[len(w.b)-1] |= 1 << w.free
+	}
+}
+
+// writeBits writes the low n bits of u, most significant first.
+func (w *bstream) writeBits(u uint64, n int) {
+	u <<= 64 - uint(n)
+	for n >= byteBits {
+		w.writeByte(byte(u >> (64 - byteBits)))
+		u <<= byteBits
+		n -= byteBits
+	}
+	for ; n > 0; n-- {
+		w.writeBit(u>>63 == 1)
+		u <<= 1
+	}
+}
+
+func (w *bstream) writeByte(c byte) {
+	if w.free == 0 {
+		w.b = append(w.b, c)
+		return
+	}
+	// Fill the free bits of the last byte and carry the rest over.
+	w.b[len(w.b)-1] |= c >> (byteBits - w.free)
+	w.b = append(w.b, c<<w.free)
+}
+
+// breader reads a bit stream written by bstream.
+type breader struct {
+	b   []byte
+	pos uint // next bit
+}
+
+func (r *breader) readBit() (bool, bool) {
+	i := r.pos / byteBits
+	if i >= uint(len(r.b)) {
+		return false, false
+	}
+	bit := r.b[i]&(0x80>>(r.pos%byteBits)) != 0
+	r.pos++
+	return bit, true
+}
+
+// readBits reads n bits, most significant first.
+func (r *breader) readBits(n int) (uint64, bool) {
+	if r.pos+uint(n) > uint(len(r.b))*byteBits {
+		return 0, false
+	}
+	var u uint64
+	for n > 0 {
+		i := r.pos / byteBits
+		off := r.pos % byteBits
+		avail := byteBits - int(off)
+		take := min(avail, n)
+		c := uint64(r.b[i]<<off) >> (byteBits - take)
+		u = u<<uint(take) | c
+		r.pos += uint(take)
+		n -= take
+	}
+	return u, true
+}
+
+// ReadByte implements io.ByteReader for decoding varints from the stream.
+func (r *breader) ReadByte() (byte, error) {
+	u, ok := r.readBits(byteBits)
+	if !ok {
+		return 0, errShortChunk
+	}
+	return byte(u), nil
+}
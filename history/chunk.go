@@ -0,0 +1,274 @@
+package history
+
+import (
+	"encoding/binary"
+	"errors"
+	"math"
+	"math/bits"
+)
+
+// Chunks use the Gorilla encoding (Pelkonen et al., VLDB 2015) with the
+// timestamp buckets Prometheus picked for millisecond resolution:
+//
+//   - the first sample stores its timestamp as a varint and its value as
+//     raw 64 bits;
+//   - the second stores the timestamp delta as a uvarint and the value XOR;
+//   - every later sample stores the delta-of-delta of its timestamp in a
+//     prefix-coded bucket, and the XOR of its value with the previous one
+//     either as a single zero bit, within the previous leading/trailing-zero
+//     window, or with a new window.
+//
+// Regular collection intervals make almost every timestamp a single bit
+// and slowly changing values a handful of bits.
+
+var errShortChunk = errors.New("history: truncated chunk")
+
+const (
+	dodBits1 = 14
+	dodBits2 = 17
+	dodBits3 = 20
+
+	leadingBits = 5
+	sigBits     = 6
+	maxLeading  = 1<<leadingBits - 1
+	floatBits   = 64
+	// noWindow marks that no XOR window has been established yet.
+	noWindow = 0xff
+)
+
+// chunk holds up to Options.ChunkSamples consecutive samples of a series.
+// Sealed chunks are immutable and can be read without locking.
+type chunk struct {
+	data  []byte
+	count uint16
+	minT  int64
+	maxT  int64
+}
+
+// appender encodes samples into the head chunk of a series.
+type appender struct {
+	w        bstream
+	c        *chunk
+	t        int64
+	tDelta   int64
+	v        float64
+	leading  uint8
+	trailing uint8
+}
+
+func newAppender(capacity int) *appender {
+	return &appender{
+		w:       bstream{b: make([]byte, 0, capacity)},
+		c:       &chunk{},
+		leading: noWindow,
+	}
+}
+
+func (a *appender) append(t int64, v float64) {
+	switch a.c.count {
+	case 0:
+		a.w.b = binary.AppendVarint(a.w.b, t)
+		a.w.writeBits(math.Float64bits(v), floatBits)
+		a.c.minT = t
+	case 1:
+		tDelta := t - a.t
+		var buf [binary.MaxVarintLen64]byte
+		for _, c := range buf[:binary.PutUvarint(buf[:], uint64(tDelta))] {
+			a.w.writeByte(c)
+		}
+		a.writeXOR(v)
+		a.tDelta = tDelta
+	default:
+		tDelta := t - a.t
+		a.writeDoD(tDelta - a.tDelta)
+		a.writeXOR(v)
+		a.tDelta = tDelta
+	}
+	a.t, a.v = t, v
+	a.c.maxT = t
+	a.c.count++
+	a.c.data = a.w.b
+}
+
+func (a *appender) writeDoD(dod int64) {
+	switch {
+	case dod == 0:
+		a.w.writeBit(false)
+	case bitRange(dod, dodBits1):
+		a.w.writeBits(0b10, 2)
+		a.w.writeBits(uint64(dod), dodBits1)
+	case bitRange(dod, dodBits2):
+		a.w.writeBits(0b110, 3)
+		a.w.writeBits(uint64(dod), dodBits2)
+	case bitRange(dod, dodBits3):
+		a.w.writeBits(0b1110, 4)
+		a.w.writeBits(uint64(dod), dodBits3)
+	default:
+		a.w.writeBits(0b1111, 4)
+		a.w.writeBits(uint64(dod), floatBits)
+	}
+}
+
+// bitRange reports whether x fits the signed n-bit bucket.
+func bitRange(x int64, n uint8) bool {
+	return -(1<<(n-1))+1 <= x && x <= 1<<(n-1)
+}
+
+func (a *appender) writeXOR(v float64) {
+	delta := math.Float64bits(v) ^ math.Float64bits(a.v)
+	if delta == 0 {
+		a.w.writeBit(false)
+		return
+	}
+	a.w.writeBit(true)
+
+	leading := uint8(min(bits.LeadingZeros64(delta), maxLeading))
+	trailing := uint8(bits.TrailingZeros64(delta))
+	if a.leading != noWindow && leading >= a.leading && trailing >= a.trailing {
+		a.w.writeBit(false)
+		a.w.writeBits(delta>>a.trailing, floatBits-int(a.leading)-int(a.trailing))
+		return
+	}
+
+	a.leading, a.trailing = leading, trailing
+	a.w.writeBit(true)
+	a.w.writeBits(uint64(leading), leadingBits)
+	sig := floatBits - leading - trailing
+	// 64 significant bits do not fit in 6 bits; 0 is never valid so it
+	// stands in for 64.
+	a.w.writeBits(uint64(sig)&(1<<sigBits-1), sigBits)
+	a.w.writeBits(delta>>trailing, int(sig))
+}
+
+// chunkIterator decodes a chunk sample by sample.
+type chunkIterator struct {
+	r        breader
+	n, i     uint16
+	t        int64
+	tDelta   int64
+	v        float64
+	leading  uint8
+	trailing uint8
+	err      error
+}
+
+func (it *chunkIterator) reset(data []byte, count uint16) {
+	*it = chunkIterator{r: breader{b: data}, n: count}
+}
+
+func (it *chunkIterator) next() bool {
+	if it.err != nil || it.i >= it.n {
+		return false
+	}
+	switch it.i {
+	case 0:
+		t, k := binary.Varint(it.r.b)
+		if k <= 0 {
+			it.err = errShortChunk
+			return false
+		}
+		it.r.pos = uint(k) * byteBits
+		vb, ok := it.r.readBits(floatBits)
+		if !ok {
+			it.err = errShortChunk
+			return false
+		}
+		it.t, it.v = t, math.Float64frombits(vb)
+	case 1:
+		tDelta, err := binary.ReadUvarint(&it.r)
+		if err != nil {
+			it.err = errShortChunk
+			return false
+		}
+		it.tDelta = int64(tDelta)
+		it.t += it.tDelta
+		if !it.readXOR() {
+			return false
+		}
+	default:
+		dod, ok := it.readDoD()
+		if !ok || !it.readXOR() {
+			it.err = errShortChunk
+			return false
+		}
+		it.tDelta += dod
+		it.t += it.tDelta
+	}
+	it.i++
+	return true
+}
+
+func (it *chunkIterator) readDoD() (int64, bool) {
+	// Count the leading one bits of the bucket prefix, at most four.
+	var prefix int
+	for prefix < 4 {
+		bit, ok := it.r.readBit()
+		if !ok {
+			return 0, false
+		}
+		if !bit {
+			break
+		}
+		prefix++
+	}
+	var n int
+	switch prefix {
+	case 0:
+		return 0, true
+	case 1:
+		n = dodBits1
+	case 2:
+		n = dodBits2
+	case 3:
+		n = dodBits3
+	default:
+		u, ok := it.r.readBits(floatBits)
+		return int64(u), ok
+	}
+	u, ok := it.r.readBits(n)
+	if !ok {
+		return 0, false
+	}
+	// Sign-extend the n-bit value.
+	if u > 1<<(n-1) {
+		return int64(u) - 1<<n, true
+	}
+	return int64(u), true
+}
+
+func (it *chunkIterator) readXOR() bool {
+	same, ok := it.r.readBit()
+	if !ok {
+		it.err = errShortChunk
+		return false
+	}
+	if !same {
+		return true
+	}
+	newWindow, ok := it.r.readBit()
+	if !ok {
+		it.err = errShortChunk
+		return false
+	}
+	if newWindow {
+		leading, ok1 := it.r.readBits(leadingBits)
+		sig, ok2 := it.r.readBits(sigBits)
+		if !ok1 || !ok2 {
+			it.err = errShortChunk
+			return false
+		}
+		if sig == 0 {
+			sig = floatBits
+		}
+		it.leading = uint8(leading)
+		it.trailing = uint8(floatBits - leading - sig)
+	}
+	sig := floatBits - int(it.leading) - int(it.trailing)
+	u, ok := it.r.readBits(sig)
+	if !ok {
+		it.err = errShortChunk
+		return false
+	}
+	it.v = math.Float64frombits(math.Float64bits(it.v) ^ u<<it.trailing)
+	return true
+}
@@ -0,0 +1,153 @@
+package history
+
+// initialChunkCap is a first guess at a chunk's size in bytes; later chunks
+// start at the size of their predecessor.
+const initialChunkCap = 128
+
+// chunkList is a time-ordered run of sealed chunks followed by the head
+// chunk being appended to. It holds one value stream: raw samples, or one
+// of the aggregates of a downsampling tier. Callers provide the locking.
+type chunkList struct {
+	sealed []*chunk // oldest first, immutable
+	head   *appender
+	// headCap sizes the next head chunk after the last sealed one.
+	headCap int
+}
+
+func newChunkList() chunkList {
+	return chunkList{head: newAppender(initialChunkCap), headCap: initialChunkCap}
+}
+
+// lastT returns the timestamp of the newest sample and whether there is one.
+func (l *chunkList) lastT() (int64, bool) {
+	if l.head.c.count > 0 {
+		return l.head.t, true
+	}
+	if len(l.sealed) > 0 {
+		return l.sealed[len(l.sealed)-1].maxT, true
+	}
+	return 0, false
+}
+
+// append adds a sample, sealing the head first once it holds chunkSamples.
+// It returns the chunk sealed, if any. Samples must be newer than lastT.
+func (l *chunkList) append(t int64, v float64, chunkSamples int) *chunk {
+	var sealed *chunk
+	if int(l.head.c.count) >= chunkSamples {
+		sealed = l.seal()
+	}
+	l.head.append(t, v)
+	return sealed
+}
+
+// seal freezes the head chunk, trimmed to size, and starts a new one.
+func (l *chunkList) seal() *chunk {
+	c := l.head.c
+	c.data = append(make([]byte, 0, len(c.data)), c.data...)
+	l.sealed = append(l.sealed, c)
+	l.headCap = len(c.data)
+	l.head = newAppender(l.headCap)
+	return c
+}
+
+// dropBefore removes sealed chunks that end before mint.
+func (l *chunkList) dropBefore(mint int64) {
+	n := 0
+	for n < len(l.sealed) && l.sealed[n].maxT < mint {
+		n++
+	}
+	if n > 0 {
+		clear(l.sealed[:n])
+		l.sealed = l.sealed[n:]
+	}
+}
+
+// truncate drops the chunks that end before mint, including the head.
+func (l *chunkList) truncate(mint int64) {
+	l.dropBefore(mint)
+	if l.head.c.count > 0 && l.head.c.maxT < mint {
+		l.head = newAppender(l.headCap)
+	}
+}
+
+func (l *chunkList) empty() bool {
+	return len(l.sealed) == 0 && l.head.c.count == 0
+}
+
+// minT returns the timestamp of the oldest sample and whether there is one.
+func (l *chunkList) minT() (int64, bool) {
+	switch {
+	case len(l.sealed) > 0:
+		return l.sealed[0].minT, true
+	case l.head.c.count > 0:
+		return l.head.c.minT, true
+	default:
+		return 0, false
+	}
+}
+
+// overlapping returns the sealed chunks intersecting [mint, maxt].
+func (l *chunkList) overlapping(mint, maxt int64) []*chunk {
+	// Chunks are ordered and disjoint, so binary search for the first one
+	// ending at or after mint.
+	lo, hi := 0, len(l.sealed)
+	for lo < hi {
+		m := int(uint(lo+hi) >> 1)
+		if l.sealed[m].maxT < mint {
+			lo = m + 1
+		} else {
+			hi = m
+		}
+	}
+	end := lo
+	for end < len(l.sealed) && l.sealed[end].minT <= maxt {
+		end++
+	}
+	return l.sealed[lo:end]
+}
+
+// headOverlaps reports whether the head chunk has samples in [mint, maxt].
+func (l *chunkList) headOverlaps(mint, maxt int64) bool {
+	h := l.head.c
+	return h.count > 0 && h.minT <= maxt && h.maxT >= mint
+}
+
+// rangeInto appends the points within [mint, maxt] to dst. Chunks outside
+// the range are skipped without being decoded.
+func (l *chunkList) rangeInto(mint, maxt int64, dst []Point) []Point {
+	var it chunkIterator
+	for _, c := range l.overlapping(mint, maxt) {
+		dst = appendChunk(dst, &it, c, mint, maxt)
+	}
+	if l.headOverlaps(mint, maxt) {
+		dst = appendChunk(dst, &it, l.head.c, mint, maxt)
+	}
+	return dst
+}
+
+func appendChunk(dst []Point, it *chunkIterator, c *chunk, mint, maxt int64) []Point {
+	it.reset(c.data, c.count)
+	for it.next() {
+		if it.t > maxt {
+			break
+		}
+		if it.t >= mint {
+			dst = append(dst, Point{T: it.t, V: it.v})
+		}
+	}
+	return dst
+}
+
+// addStats adds the list's chunk accounting to st.
+func (l *chunkList) addStats(chunks *int, samples, bytes *uint64) {
+	for _, c := range l.sealed {
+		*chunks++
+		*samples += uint64(c.count)
+		*bytes += uint64(len(c.data))
+	}
+	if h := l.head.c; h.count > 0 {
+		*chunks++
+		*samples += uint64(h.count)
+		*bytes += uint64(len(h.data))
+	}
+}
@@ -0,0 +1,303 @@
+package history
+
+import (
+	"context"
+	"math"
+	"time"
+)
+
+// Tier is one downsampling level. Every Resolution-long bucket of its
+// source, the raw samples for the first tier and the previous tier for the
+// others, is reduced to min, max, sum and count.
+type Tier struct {
+	Resolution time.Duration
+	Retention  time.Duration
+}
+
+// DefaultTiers keeps 10 s rollups for a day and 1 min rollups for 30 days.
+// Combine it with Options.Retention of an hour to hold raw samples for the
+// last hour only.
+var DefaultTiers = []Tier{
+	{Resolution: 10 * time.Second, Retention: 24 * time.Hour},
+	{Resolution: time.Minute, Retention: 30 * 24 * time.Hour},
+}
+
+// Aggregate summarises the samples of one bucket.
+type Aggregate struct {
+	T     int64 // bucket start, milliseconds since the Unix epoch
+	Min   float64
+	Max   float64
+	Sum   float64
+	Count uint64
+}
+
+// Mean returns the average of the bucket's samples.
+func (a *Aggregate) Mean() float64 {
+	return a.Sum / float64(a.Count)
+}
+
+func (a *Aggregate) merge(o *Aggregate) {
+	if a.Count == 0 {
+		*a = Aggregate{T: a.T, Min: o.Min, Max: o.Max, Sum: o.Sum, Count: o.Count}
+		return
+	}
+	a.Min = min(a.Min, o.Min)
+	a.Max = max(a.Max, o.Max)
+	a.Sum += o.Sum
+	a.Count += o.Count
+}
+
+// tierData holds a series' buckets of one tier as four value streams with
+// identical timestamps, so each compresses like an ordinary series.
+type tierData struct {
+	min, max, sum, count chunkList
+	// watermark is the exclusive end of the source time already folded in;
+	// math.MinInt64 until the first compaction.
+	watermark int64
+}
+
+func newTierData() tierData {
+	return tierData{
+		min:       newChunkList(),
+		max:       newChunkList(),
+		sum:       newChunkList(),
+		count:     newChunkList(),
+		watermark: math.MinInt64,
+	}
+}
+
+func (d *tierData) append(a *Aggregate, chunkSamples int) {
+	d.min.append(a.T, a.Min, chunkSamples)
+	d.max.append(a.T, a.Max, chunkSamples)
+	d.sum.append(a.T, a.Sum, chunkSamples)
+	d.count.append(a.T, float64(a.Count), chunkSamples)
+}
+
+func (d *tierData) dropBefore(mint int64) {
+	d.min.dropBefore(mint)
+	d.max.dropBefore(mint)
+	d.sum.dropBefore(mint)
+	d.count.dropBefore(mint)
+}
+
+func (d *tierData) truncate(mint int64) {
+	d.min.truncate(mint)
+	d.max.truncate(mint)
+	d.sum.truncate(mint)
+	d.count.truncate(mint)
+}
+
+func (d *tierData) empty() bool {
+	return d.count.empty()
+}
+
+// rangeInto appends the buckets starting within [mint, maxt] to dst. The
+// four streams are appended and dropped in lockstep, so their chunks line
+// up and can be zipped.
+func (d *tierData) rangeInto(mint, maxt int64, dst []Aggregate, sc *scratch) []Aggregate {
+	sc.mins = d.min.rangeInto(mint, maxt, sc.mins[:0])
+	sc.maxs = d.max.rangeInto(mint, maxt, sc.maxs[:0])
+	sc.sums = d.sum.rangeInto(mint, maxt, sc.sums[:0])
+	sc.counts = d.count.rangeInto(mint, maxt, sc.counts[:0])
+	for i := range sc.counts {
+		dst = append(dst, Aggregate{
+			T:     sc.counts[i].T,
+			Min:   sc.mins[i].V,
+			Max:   sc.maxs[i].V,
+			Sum:   sc.sums[i].V,
+			Count: uint64(sc.counts[i].V),
+		})
+	}
+	return dst
+}
+
+func (d *tierData) addStats(ts *TierStats) {
+	var chunks int
+	var buckets, bytes, same uint64
+	d.count.addStats(&chunks, &buckets, &bytes)
+	// The other streams hold the same buckets; only their bytes count.
+	d.min.addStats(&chunks, &same, &bytes)
+	d.max.addStats(&chunks, &same, &bytes)
+	d.sum.addStats(&chunks, &same, &bytes)
+	ts.Buckets += buckets
+	ts.Bytes += bytes
+}
+
+// scratch holds the buffers reused across a compaction pass.
+type scratch struct {
+	points                   []Point
+	mins, maxs, sums, counts []Point
+	aggs                     []Aggregate
+}
+
+// RangeTier appends the buckets of the given tier starting within
+// [mint, maxt] to dst.
+func (s *Series) RangeTier(tier int, mint, maxt int64, dst []Aggregate) []Aggregate {
+	s.mu.RLock()
+	defer s.mu.RUnlock()
+	if tier < 0 || tier >= len(s.tiers) {
+		return dst
+	}
+	var sc scratch
+	return s.tiers[tier].rangeInto(mint, maxt, dst, &sc)
+}
+
+// compact folds every complete source bucket past the tier's watermark into
+// the tier and returns the number of buckets written. now bounds how long a
+// bucket of an idle series is considered incomplete.
+func (s *Series) compact(tier int, o *Options, now int64, sc *scratch) int {
+	s.mu.Lock()
+	defer s.mu.Unlock()
+
+	d := &s.tiers[tier]
+	res := o.Tiers[tier].Resolution.Milliseconds()
+
+	// complete is the exclusive end of the source data that can no longer
+	// change: samples are appended in order, so everything before the
+	// newest raw sample is final, as is anything a bucket ago.
+	var complete, first int64
+	var ok bool
+	if tier == 0 {
+		var last int64
+		if last, ok = s.raw.lastT(); !ok {
+			return 0
+		}
+		complete = max(last, now-res)
+		first, _ = s.raw.minT()
+	} else {
+		src := &s.tiers[tier-1]
+		if src.watermark == math.MinInt64 {
+			return 0
+		}
+		complete = src.watermark
+		if first, ok = src.count.minT(); !ok {
+			return 0
+		}
+	}
+
+	from := d.watermark
+	if from == math.MinInt64 {
+		from = alignDown(first, res)
+	}
+	end := alignDown(complete, res)
+	if end <= from {
+		return 0
+	}
+
+	sc.aggs = sc.aggs[:0]
+	if tier == 0 {
+		sc.points = s.raw.rangeInto(from, end-1, sc.points[:0])
+		sc.aggs = bucketPoints(sc.points, res, sc.aggs)
+	} else {
+		sc.aggs = s.tiers[tier-1].rangeInto(from, end-1, sc.aggs, sc)
+		sc.aggs = bucketAggregates(sc.aggs, res)
+	}
+	for i := range sc.aggs {
+		d.append(&sc.aggs[i], o.ChunkSamples)
+	}
+	d.watermark = end
+	d.dropBefore(end - o.Tiers[tier].Retention.Milliseconds())
+	return len(sc.aggs)
+}
+
+func alignDown(t, res int64) int64 {
+	r := t % res
+	if r < 0 {
+		r += res
+	}
+	return t - r
+}
+
+// bucketPoints reduces time-ordered points to per-bucket aggregates,
+// appended to dst.
+func bucketPoints(points []Point, res int64, dst []Aggregate) []Aggregate {
+	for _, p := range points {
+		if math.IsNaN(p.V) {
+			continue
+		}
+		b := alignDown(p.T, res)
+		if n := len(dst); n > 0 && dst[n-1].T == b {
+			a := &dst[n-1]
+			a.Min = min(a.Min, p.V)
+			a.Max = max(a.Max, p.V)
+			a.Sum += p.V
+			a.Count++
+			continue
+		}
+		dst = append(dst, Aggregate{T: b, Min: p.V, Max: p.V, Sum: p.V, Count: 1})
+	}
+	return dst
+}
+
+// bucketAggregates merges time-ordered finer aggregates into coarser
+// buckets in place.
+func bucketAggregates(aggs []Aggregate, res int64) []Aggregate {
+	out := aggs[:0]
+	for i := range aggs {
+		a := aggs[i]
+		b := alignDown(a.T, res)
+		if n := len(out); n > 0 && out[n-1].T == b {
+			out[n-1].merge(&a)
+			continue
+		}
+		a.T = b
+		out = append(out, a)
+	}
+	return out
+}
+
+// CompactStats describes one compaction pass.
+type CompactStats struct {
+	Series   int
+	Buckets  int
+	Duration time.Duration
+}
+
+// Compact runs one incremental downsampling pass over all series, folding
+// the buckets completed since the previous pass into each tier. It locks one
+// series at a time, so appends to the others carry on meanwhile. now is
+// normally time.Now().
+func (st *Store) Compact(now time.Time) CompactStats {
+	start := time.Now()
+	stats := CompactStats{}
+	if len(st.opts.Tiers) == 0 {
+		return stats
+	}
+
+	st.compactMu.Lock()
+	defer st.compactMu.Unlock()
+
+	// Snapshot the series so the store lock is not held while compacting.
+	list := st.compactList[:0]
+	st.Each(func(s *Series) bool {
+		list = append(list, s)
+		return true
+	})
+
+	nowMs := now.UnixMilli()
+	for _, s := range list {
+		for tier := range st.opts.Tiers {
+			stats.Buckets += s.compact(tier, &st.opts, nowMs, &st.compactScratch)
+		}
+	}
+	stats.Series = len(list)
+	clear(list)
+	st.compactList = list
+	stats.Duration = time.Since(start)
+	return stats
+}
+
+// RunCompaction calls Compact every interval until ctx is done. Run it in
+// its own goroutine.
+func (st *Store) RunCompaction(ctx context.Context, interval time.Duration) {
+	ticker := time.NewTicker(interval)
+	defer ticker.Stop()
+	for {
+		select {
+		case <-ctx.Done():
+			return
+		case now := <-ticker.C:
+			st.Compact(now)
+		}
+	}
+}
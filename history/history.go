@@ -0,0 +1,227 @@
+// Package history keeps recent samples of every series in memory, compressed
+// with the Gorilla scheme: delta-of-delta timestamps and XOR-encoded values
+// packed into fixed-size chunks per series. Regularly collected metrics
+// compress to one or two bytes per sample instead of sixteen.
+//
+// Optionally, sealed chunks are also appended to memory-mapped segment files
+// (see Segments), so history survives an agent restart.
+package history
+
+import (
+	"math"
+	"sync"
+	"sync/atomic"
+	"time"
+
+	"github.com/sm-moshi/dmetrics-go/metric"
+)
+
+// Defaults applied by New to zero Options fields.
+const (
+	DefaultChunkSamples = 120
+	DefaultRetention    = 24 * time.Hour
+)
+
+// Options configures a Store.
+type Options struct {
+	// ChunkSamples is the number of samples per chunk. Larger chunks
+	// compress slightly better but make range reads decode more.
+	ChunkSamples int
+	// Retention is how far behind its newest sample a series keeps history.
+	// Chunks are dropped whole once they fall out of it.
+	Retention time.Duration
+	// Segments, if set, persists every sealed chunk to disk. Its segment
+	// duration should stay below Retention, so chunks are still in memory
+	// until the segment holding them is final and readable.
+	Segments *Segments
+	// Tiers, if set, are filled by Compact with downsampled rollups that
+	// outlive the raw samples. Each tier's Resolution must be a multiple of
+	// the previous one's.
+	Tiers []Tier
+}
+
+// Stats describes the contents of a Store.
+type Stats struct {
+	Series  int
+	Chunks  int
+	Samples uint64
+	// Bytes is the size of the encoded chunk data.
+	Bytes uint64
+	// Rejected counts samples not newer than their series' last sample.
+	Rejected uint64
+	// Tiers describes the downsampled data, one entry per Options.Tiers.
+	Tiers []TierStats
+}
+
+// TierStats describes the downsampled data of one tier.
+type TierStats struct {
+	Buckets uint64
+	// Bytes is the size of the encoded min, max, sum and count streams.
+	Bytes uint64
+}
+
+// Store holds the history of all series. It is safe for concurrent use.
+type Store struct {
+	opts Options
+
+	mu     sync.RWMutex
+	series map[uint64][]*Series
+	index  index
+
+	rejected atomic.Uint64
+
+	compactMu      sync.Mutex // serialises Compact
+	compactList    []*Series
+	compactScratch scratch
+}
+
+// New returns an empty Store.
+func New(opts Options) *Store {
+	if opts.ChunkSamples <= 0 {
+		opts.ChunkSamples = DefaultChunkSamples
+	}
+	if opts.Retention <= 0 {
+		opts.Retention = DefaultRetention
+	}
+	return &Store{opts: opts, series: make(map[uint64][]*Series), index: newIndex()}
+}
+
+// Append records samples and returns how many were rejected for not being
+// newer than the previous sample of their series.
+func (st *Store) Append(samples ...metric.Sample) int {
+	rejected := 0
+	for i := range samples {
+		s := &samples[i]
+		h := s.SeriesHash()
+		for {
+			// A series Truncate removed after the lookup is dead; the
+			// retry creates its replacement.
+			ok, live := st.getOrCreate(h, s.Name, s.Labels).append(s.Timestamp, s.Value, &st.opts)
+			if live {
+				if !ok {
+					rejected++
+				}
+				break
+			}
+		}
+	}
+	st.rejected.Add(uint64(rejected))
+	return rejected
+}
+
+// Get returns the series with the given identity, or nil.
+func (st *Store) Get(name string, ls metric.Labels) *Series {
+	st.mu.RLock()
+	defer st.mu.RUnlock()
+	return find(st.series[metric.SeriesHash(name, ls)], name, ls)
+}
+
+func (st *Store) getOrCreate(h uint64, name string, ls metric.Labels) *Series {
+	st.mu.RLock()
+	s := find(st.series[h], name, ls)
+	st.mu.RUnlock()
+	if s != nil {
+		return s
+	}
+
+	st.mu.Lock()
+	defer st.mu.Unlock()
+	if s = find(st.series[h], name, ls); s == nil {
+		s = newSeries(name, ls, &st.opts)
+		st.series[h] = append(st.series[h], s)
+		st.index.add(s)
+	}
+	return s
+}
+
+func find(bucket []*Series, name string, ls metric.Labels) *Series {
+	for _, s := range bucket {
+		if s.name == name && s.labels.Equal(ls) {
+			return s
+		}
+	}
+	return nil
+}
+
+// Range appends the points of the series within [mint, maxt] to dst. With
+// Segments attached, points older than the series' in-memory history, e.g.
+// from before a restart, are read from disk first.
+func (st *Store) Range(name string, ls metric.Labels, mint, maxt int64, dst []Point) ([]Point, error) {
+	s := st.Get(name, ls)
+	memMin := int64(math.MaxInt64)
+	if s != nil {
+		memMin = s.minTime()
+	}
+	var err error
+	if st.opts.Segments != nil && mint < memMin {
+		dst, err = st.opts.Segments.Range(name, ls, mint, min(maxt, memMin-1), dst)
+	}
+	if s != nil {
+		dst = s.Range(mint, maxt, dst)
+	}
+	return dst, err
+}
+
+// Close persists the samples not yet in a sealed chunk and closes the
+// attached Segments. The Store must not be used afterwards.
+func (st *Store) Close() error {
+	if st.opts.Segments == nil {
+		return nil
+	}
+	st.Each(func(s *Series) bool {
+		s.persistHead(st.opts.Segments)
+		return true
+	})
+	return st.opts.Segments.Close()
+}
+
+// Each calls fn for every series until fn returns false. Series created
+// during the walk may or may not be visited.
+func (st *Store) Each(fn func(*Series) bool) {
+	st.mu.RLock()
+	defer st.mu.RUnlock()
+	for _, bucket := range st.series {
+		for _, s := range bucket {
+			if !fn(s) {
+				return
+			}
+		}
+	}
+}
+
+// Truncate drops all chunks ending before mint, in every tier, and forgets
+// series left without samples, e.g. those of exited processes.
+func (st *Store) Truncate(mint int64) {
+	st.mu.Lock()
+	defer st.mu.Unlock()
+	for h, bucket := range st.series {
+		kept := bucket[:0]
+		for _, s := range bucket {
+			if s.truncate(mint) {
+				st.index.remove(s)
+			} else {
+				kept = append(kept, s)
+			}
+		}
+		if len(kept) == 0 {
+			delete(st.series, h)
+		} else {
+			clear(bucket[len(kept):])
+			st.series[h] = kept
+		}
+	}
+}
+
+// Stats walks the store and returns its current size.
+func (st *Store) Stats() Stats {
+	st.mu.RLock()
+	defer st.mu.RUnlock()
+	stats := Stats{Rejected: st.rejected.Load(), Tiers: make([]TierStats, len(st.opts.Tiers))}
+	for _, bucket := range st.series {
+		for _, s := range bucket {
+			stats.Series++
+			s.stats(&stats)
+		}
+	}
+	return stats
+}
@@ -0,0 +1,288 @@
+package history
+
+import (
+	"math"
+	"math/rand"
+	"runtime"
+	"strconv"
+	"testing"
+	"time"
+
+	"github.com/sm-moshi/dmetrics-go/metric"
+)
+
+func TestRoundTrip(t *testing.T) {
+	// Irregular timestamps reach every delta-of-delta bucket, including
+	// negative ones and the raw 64-bit escape; the values cover repeats,
+	// window changes and the special floats.
+	ts := []int64{
+		-5, 0, 1, 1000, 2000, 2001, 10_000, 10_000 + 1<<13, 10_000 + 1<<16,
+		10_000 + 1<<19 + 7, 1 << 40, 1<<40 + 1, 1<<40 + 3,
+	}
+	vs := []float64{
+		0, math.Copysign(0, -1), 1, 1, -1.5, math.NaN(), math.Inf(1),
+		math.Inf(-1), math.MaxFloat64, math.SmallestNonzeroFloat64, 42, 42, math.NaN(),
+	}
+	// The retention keeps the whole span of the jump to 1<<40 ms.
+	st := New(Options{ChunkSamples: 4, Retention: math.MaxInt64})
+	for i := range ts {
+		if n := st.Append(metric.Sample{Name: "m", Timestamp: ts[i], Value: vs[i]}); n != 0 {
+			t.Fatalf("sample %d rejected", i)
+		}
+	}
+	got, err := st.Range("m", nil, math.MinInt64, math.MaxInt64, nil)
+	if err != nil {
+		t.Fatal(err)
+	}
+	if len(got) != len(ts) {
+		t.Fatalf("got %d points, want %d", len(got), len(ts))
+	}
+	for i, p := range got {
+		// Compare bits: NaN and the sign of zero must survive.
+		if p.T != ts[i] || math.Float64bits(p.V) != math.Float64bits(vs[i]) {
+			t.Fatalf("point %d = %d %v, want %d %v", i, p.T, p.V, ts[i], vs[i])
+		}
+	}
+
+	it := st.Get("m", nil).Iterator(1000, 10_000)
+	var n int
+	for it.Next() {
+		n++
+	}
+	if it.Err() != nil || n != 4 {
+		t.Fatalf("iterator: %d points, err %v", n, it.Err())
+	}
+}
+
+func TestOutOfOrderRejected(t *testing.T) {
+	st := New(Options{ChunkSamples: 2})
+	ls := metric.NewLabels("cpu", "0")
+	for _, ts := range []int64{10, 20, 30} {
+		st.Append(metric.Sample{Name: "m", Labels: ls, Timestamp: ts, Value: float64(ts)})
+	}
+	// Equal and older timestamps, including one in a sealed chunk.
+	n := st.Append(
+		metric.Sample{Name: "m", Labels: ls, Timestamp: 30, Value: -1},
+		metric.Sample{Name: "m", Labels: ls, Timestamp: 15, Value: -1},
+		metric.Sample{Name: "m", Labels: ls, Timestamp: 40, Value: 40},
+	)
+	if n != 2 || st.Stats().Rejected != 2 {
+		t.Fatalf("rejected %d, stats %+v", n, st.Stats())
+	}
+	got, _ := st.Range("m", ls, 0, 100, nil)
+	want := []Point{{10, 10}, {20, 20}, {30, 30}, {40, 40}}
+	if len(got) != len(want) {
+		t.Fatalf("got %v", got)
+	}
+	for i := range want {
+		if got[i] != want[i] {
+			t.Fatalf("got %v, want %v", got, want)
+		}
+	}
+}
+
+func TestSegmentsPersist(t *testing.T) {
+	dir := t.TempDir()
+	segs, err := OpenSegments(SegmentOptions{Dir: dir})
+	if err != nil {
+		t.Fatal(err)
+	}
+	st := New(Options{ChunkSamples: 8, Segments: segs})
+	ls := metric.NewLabels("disk", "sda")
+	const n = 100
+	for i := 0; i < n; i++ {
+		st.Append(metric.Sample{Name: "io", Labels: ls, Timestamp: int64(i) * 1000, Value: float64(i)})
+	}
+	if err := st.Close(); err != nil {
+		t.Fatal(err)
+	}
+	if stats := segs.Stats(); stats.Dropped != 0 || stats.WriteErrors != 0 {
+		t.Fatalf("stats %+v", stats)
+	}
+
+	// After a restart the sealed chunks and the head are read from disk.
+	segs, err = OpenSegments(SegmentOptions{Dir: dir})
+	if err != nil {
+		t.Fatal(err)
+	}
+	defer segs.Close()
+	got, err := New(Options{Segments: segs}).Range("io", ls, 0, n*1000, nil)
+	if err != nil {
+		t.Fatal(err)
+	}
+	if len(got) != n || got[n-1] != (Point{T: (n - 1) * 1000, V: n - 1}) {
+		t.Fatalf("got %d points, last %v", len(got), got[len(got)-1])
+	}
+}
+
+// BenchmarkAppend fills a day of 10 s samples for a set of slowly changing
+// series and reports the encoded and heap bytes per sample.
+func BenchmarkAppend(b *testing.B) {
+	const (
+		series   = 100
+		samples  = 24 * 360
+		interval = 10_000
+	)
+	batch := make([]metric.Sample, series)
+	for i := range batch {
+		batch[i] = metric.Sample{Name: "dmetrics_process_cpu_seconds_total", Labels: metric.NewLabels("pid", strconv.Itoa(i))}
+	}
+	b.ReportAllocs()
+	var heap, encoded float64
+	for i := 0; i < b.N; i++ {
+		var before, after runtime.MemStats
+		runtime.GC()
+		runtime.ReadMemStats(&before)
+
+		st := New(Options{})
+		for j := 0; j < samples; j++ {
+			for k := range batch {
+				batch[k].Timestamp = int64(j) * interval
+				batch[k].Value = float64(j/6) + float64(k)/8
+			}
+			st.Append(batch...)
+		}
+
+		runtime.GC()
+		runtime.ReadMemStats(&after)
+		stats := st.Stats()
+		heap = float64(after.HeapAlloc-before.HeapAlloc) / float64(stats.Samples)
+		encoded = float64(stats.Bytes) / float64(stats.Samples)
+		runtime.KeepAlive(st)
+	}
+	b.ReportMetric(encoded, "B/sample")
+	b.ReportMetric(heap, "heapB/sample")
+}
+
+// BenchmarkRange reads the last hour and the whole of a day of 10 s
+// samples from one series, the reads behind a dashboard panel.
+func BenchmarkRange(b *testing.B) {
+	const (
+		samples  = 24 * 360
+		interval = 10_000
+	)
+	st := New(Options{})
+	ls := metric.NewLabels("pid", "1")
+	for j := 0; j < samples; j++ {
+		st.Append(metric.Sample{Name: "dmetrics_process_cpu_seconds_total", Labels: ls, Timestamp: int64(j) * interval, Value: float64(j / 6)})
+	}
+	end := int64(samples-1) * interval
+	for _, bc := range []struct {
+		name string
+		mint int64
+	}{
+		{"hour", end - 3600_000},
+		{"day", 0},
+	} {
+		b.Run(bc.name, func(b *testing.B) {
+			var dst []Point
+			b.ReportAllocs()
+			for i := 0; i < b.N; i++ {
+				var err error
+				if dst, err = st.Range("dmetrics_process_cpu_seconds_total", ls, bc.mint, end, dst[:0]); err != nil {
+					b.Fatal(err)
+				}
+			}
+		})
+	}
+}
+
+func TestTruncateDuringAppend(t *testing.T) {
+	st := New(Options{ChunkSamples: 4})
+	const n = 20000
+	done := make(chan struct{})
+	go func() {
+		defer close(done)
+		for i := 0; i < n; i++ {
+			st.Append(metric.Sample{Name: "m", Timestamp: int64(i), Value: 1})
+		}
+	}()
+	// Truncating everything before the final sample keeps removing the
+	// series under the appender; that sample must survive.
+	for {
+		select {
+		case <-done:
+			if got, _ := st.Range("m", nil, n-1, n-1, nil); len(got) != 1 {
+				t.Fatalf("last sample lost: %v", got)
+			}
+			return
+		default:
+			st.Truncate(n - 1)
+		}
+	}
+}
+
+func TestCompact(t *testing.T) {
+	st := New(Options{Tiers: DefaultTiers})
+	// Five minutes of one-second samples, 0..299.
+	for i := int64(0); i < 300; i++ {
+		st.Append(metric.Sample{Name: "m", Timestamp: i * 1000, Value: float64(i)})
+	}
+	// Ten seconds past the last sample, its bucket is complete too.
+	now := time.UnixMilli(310_000)
+	if cs := st.Compact(now); cs.Buckets != 30+5 {
+		t.Fatalf("compact %+v", cs)
+	}
+	s := st.Get("m", nil)
+	tens := s.RangeTier(0, 0, math.MaxInt64, nil)
+	mins := s.RangeTier(1, 0, math.MaxInt64, nil)
+	if len(tens) != 30 || len(mins) != 5 {
+		t.Fatalf("%d 10 s and %d 1 min buckets", len(tens), len(mins))
+	}
+	for i, a := range mins {
+		lo := float64(60 * i)
+		want := Aggregate{T: int64(i) * 60_000, Min: lo, Max: lo + 59, Sum: 60*lo + 59*60/2, Count: 60}
+		if a != want {
+			t.Fatalf("bucket %d = %+v, want %+v", i, a, want)
+		}
+	}
+	// A second pass has nothing new to fold.
+	if cs := st.Compact(now); cs.Buckets != 0 {
+		t.Fatalf("second compact %+v", cs)
+	}
+}
+
+// BenchmarkCompact measures incremental compaction of ten minutes of
+// one-second samples per series into the default tiers, and reports the
+// memory each tier needs per series-hour next to that of raw samples.
+func BenchmarkCompact(b *testing.B) {
+	const (
+		series = 100
+		step   = 10 * time.Minute
+	)
+	st := New(Options{Retention: time.Hour, Tiers: DefaultTiers})
+	batch := make([]metric.Sample, series)
+	for i := range batch {
+		batch[i] = metric.Sample{Name: "dmetrics_process_rss_bytes", Labels: metric.NewLabels("pid", strconv.Itoa(i))}
+	}
+	r := rand.New(rand.NewSource(1))
+	var now int64
+	var compacted time.Duration
+	b.ReportAllocs()
+	b.ResetTimer()
+	for i := 0; i < b.N; i++ {
+		b.StopTimer()
+		for end := now + step.Milliseconds(); now < end; now += 1000 {
+			for k := range batch {
+				batch[k].Timestamp = now
+				batch[k].Value = float64(1<<20*k) + math.Round(r.NormFloat64()*4096)
+			}
+			st.Append(batch...)
+		}
+		b.StartTimer()
+		compacted += st.Compact(time.UnixMilli(now)).Duration
+	}
+	b.StopTimer()
+
+	samples := float64(b.N) * step.Seconds() * series
+	b.ReportMetric(samples/compacted.Seconds(), "samples/s")
+	stats := st.Stats()
+	elapsed := time.Duration(b.N) * step
+	perHour := func(bytes uint64, retention time.Duration) float64 {
+		return float64(bytes) / series / min(elapsed, retention).Hours()
+	}
+	b.ReportMetric(perHour(stats.Bytes, time.Hour), "rawB/series-h")
+	for i, tier := range DefaultTiers {
+		b.ReportMetric(perHour(stats.Tiers[i].Bytes, tier.Retention), strconv.Itoa(int(tier.Resolution.Seconds()))+"sB/series-h")
+	}
+}
@@ -0,0 +1,103 @@
+package history
+
+import "sort"
+
+// NameLabel is the label under which the index files the metric name.
+const NameLabel = "__name__"
+
+// index maps every label name and value to the ids of the series carrying
+// it, in ascending order, so selecting a few series out of many intersects
+// short lists instead of scanning the store. Lists are never modified in
+// place once handed out: new ids are appended past the end readers see, and
+// removals build a new list.
+type index struct {
+	nextID   uint32
+	byID     map[uint32]*Series
+	postings map[string]map[string][]uint32
+}
+
+func newIndex() index {
+	return index{
+		byID:     make(map[uint32]*Series),
+		postings: make(map[string]map[string][]uint32),
+	}
+}
+
+func (ix *index) add(s *Series) {
+	s.id = ix.nextID
+	ix.nextID++
+	ix.byID[s.id] = s
+	ix.addPosting(NameLabel, s.name, s.id)
+	for _, l := range s.labels {
+		ix.addPosting(l.Name, l.Value, s.id)
+	}
+}
+
+func (ix *index) addPosting(name, value string, id uint32) {
+	values := ix.postings[name]
+	if values == nil {
+		values = make(map[string][]uint32)
+		ix.postings[name] = values
+	}
+	values[value] = append(values[value], id)
+}
+
+func (ix *index) remove(s *Series) {
+	delete(ix.byID, s.id)
+	ix.removePosting(NameLabel, s.name, s.id)
+	for _, l := range s.labels {
+		ix.removePosting(l.Name, l.Value, s.id)
+	}
+}
+
+func (ix *index) removePosting(name, value string, id uint32) {
+	values := ix.postings[name]
+	list := values[value]
+	i := sort.Search(len(list), func(i int) bool { return list[i] >= id })
+	if i == len(list) || list[i] != id {
+		return
+	}
+	if len(list) == 1 {
+		delete(values, value)
+		if len(values) == 0 {
+			delete(ix.postings, name)
+		}
+		return
+	}
+	next := make([]uint32, 0, len(list)-1)
+	next = append(next, list[:i]...)
+	values[value] = append(next, list[i+1:]...)
+}
+
+// ID returns the series' id in the store's index.
+func (s *Series) ID() uint32 { return s.id }
+
+// Postings returns the ids of the series with label name set to value, in
+// ascending order. Use NameLabel to look up by metric name. The slice must
+// not be modified.
+func (st *Store) Postings(name, value string) []uint32 {
+	st.mu.RLock()
+	defer st.mu.RUnlock()
+	return st.index.postings[name][value]
+}
+
+// LabelValues calls fn for every value of the label name and the ids of the
+// series carrying it, until fn returns false. fn must not call back into
+// the Store.
+func (st *Store) LabelValues(name string, fn func(value string, ids []uint32) bool) {
+	st.mu.RLock()
+	defer st.mu.RUnlock()
+	for v, ids := range st.index.postings[name] {
+		if !fn(v, ids) {
+			return
+		}
+	}
+}
+
+// SeriesByID returns the series with the given id, or nil if it has been
+// removed.
+func (st *Store) SeriesByID(id uint32) *Series {
+	st.mu.RLock()
+	defer st.mu.RUnlock()
+	return st.index.byID[id]
+}
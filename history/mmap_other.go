@@ -0,0 +1,21 @@
+//go:build !darwin && !linux
+
+package history
+
+import (
+	"io"
+	"os"
+)
+
+// mapFile reads the whole file into memory where mmap is not available.
+func mapFile(f *os.File, size int) ([]byte, error) {
+	b := make([]byte, size)
+	if _, err := io.ReadFull(io.NewSectionReader(f, 0, int64(size)), b); err != nil {
+		return nil, err
+	}
+	return b, nil
+}
+
+func unmapFile([]byte) error {
+	return nil
+}
@@ -0,0 +1,17 @@
+//go:build darwin || linux
+
+package history
+
+import (
+	"os"
+	"syscall"
+)
+
+// mapFile maps the whole file read-only.
+func mapFile(f *os.File, size int) ([]byte, error) {
+	return syscall.Mmap(int(f.Fd()), 0, size, syscall.PROT_READ, syscall.MAP_SHARED)
+}
+
+func unmapFile(b []byte) error {
+	return syscall.Munmap(b)
+}
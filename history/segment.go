@@ -0,0 +1,576 @@
+package history
+
+import (
+	"bufio"
+	"encoding/binary"
+	"errors"
+	"fmt"
+	"hash/crc32"
+	"hash/fnv"
+	"os"
+	"sort"
+	"sync"
+
+	"github.com/sm-moshi/dmetrics-go/metric"
+)
+
+// A segment file holds the sealed chunks written during one stretch of time:
+//
+//	header   64 bytes, see the hdr* offsets
+//	records  series and chunk records, each prefixed by type, payload
+//	         length and payload CRC
+//	index    series table sorted by stable series hash, then chunk table,
+//	         both fixed-width so lookups binary-search the mapping in place
+//
+// The index is written and the header marked final when the segment is
+// rotated out. Opening a final segment reads the header and maps the file,
+// nothing more. A segment left unfinished by a crash is recovered by
+// scanning its records once.
+
+const (
+	segMagic   = "DMHIST01"
+	segVersion = 1
+	segExt     = ".seg"
+
+	hdrMagic     = 0
+	hdrVersion   = 8
+	hdrFlags     = 12
+	hdrMinT      = 16
+	hdrMaxT      = 24
+	hdrIndexOff  = 32
+	hdrNSeries   = 40
+	hdrNChunks   = 44
+	hdrIndexCRC  = 48
+	hdrHeaderCRC = 60
+	headerSize   = 64
+
+	flagFinal = 1
+
+	recSeries     = 1
+	recChunk      = 2
+	recHeaderSize = 1 + 4 + 4 // type, payload length, payload CRC
+
+	// Chunk payload: series id, sample count, minT, maxT, then the data.
+	chunkPayloadHeader = 4 + 2 + 8 + 8
+
+	// Series table entry: hash, series record offset, first chunk, chunk count.
+	seriesEntrySize = 8 + 8 + 4 + 4
+	// Chunk table entry: chunk record offset, minT, maxT.
+	chunkEntrySize = 8 + 8 + 8
+)
+
+var (
+	crcTable = crc32.MakeTable(crc32.Castagnoli)
+
+	errBadSegment = errors.New("history: corrupt segment")
+)
+
+// stableHash identifies a series across restarts, unlike
+// metric.SeriesHash whose seed changes with every process.
+func stableHash(name string, ls metric.Labels) uint64 {
+	h := fnv.New64a()
+	_, _ = h.Write([]byte(name))
+	for _, l := range ls {
+		_, _ = h.Write([]byte{0xff})
+		_, _ = h.Write([]byte(l.Name))
+		_, _ = h.Write([]byte{0xfe})
+		_, _ = h.Write([]byte(l.Value))
+	}
+	return h.Sum64()
+}
+
+// segment is a final, memory-mapped segment file.
+type segment struct {
+	path       string
+	data       []byte
+	minT, maxT int64
+	index      []byte // series and chunk tables within data
+	series     []byte
+	chunks     []byte
+
+	verify    sync.Once
+	verifyErr error
+}
+
+func openSegment(path string) (*segment, error) {
+	f, err := os.Open(path)
+	if err != nil {
+		return nil, err
+	}
+	defer f.Close()
+
+	var hdr [headerSize]byte
+	if _, err := f.ReadAt(hdr[:], 0); err != nil {
+		return nil, fmt.Errorf("history: %s: %w", path, err)
+	}
+	if err := checkHeader(hdr[:]); err != nil {
+		return nil, fmt.Errorf("history: %s: %w", path, err)
+	}
+	if binary.LittleEndian.Uint32(hdr[hdrFlags:])&flagFinal == 0 {
+		return nil, errNotFinal
+	}
+	fi, err := f.Stat()
+	if err != nil {
+		return nil, err
+	}
+	data, err := mapFile(f, int(fi.Size()))
+	if err != nil {
+		return nil, fmt.Errorf("history: mmap %s: %w", path, err)
+	}
+
+	le := binary.LittleEndian
+	off := le.Uint64(hdr[hdrIndexOff:])
+	nSeries := uint64(le.Uint32(hdr[hdrNSeries:]))
+	nChunks := uint64(le.Uint32(hdr[hdrNChunks:]))
+	end := off + nSeries*seriesEntrySize + nChunks*chunkEntrySize
+	if off < headerSize || end > uint64(len(data)) {
+		_ = unmapFile(data)
+		return nil, fmt.Errorf("history: %s: %w", path, errBadSegment)
+	}
+	index := data[off:end]
+	return &segment{
+		path:   path,
+		data:   data,
+		minT:   int64(le.Uint64(hdr[hdrMinT:])),
+		maxT:   int64(le.Uint64(hdr[hdrMaxT:])),
+		index:  index,
+		series: index[:nSeries*seriesEntrySize],
+		chunks: index[nSeries*seriesEntrySize:],
+	}, nil
+}
+
+var errNotFinal = errors.New("history: segment not finalised")
+
+func checkHeader(hdr []byte) error {
+	if string(hdr[hdrMagic:hdrMagic+len(segMagic)]) != segMagic {
+		return errBadSegment
+	}
+	if binary.LittleEndian.Uint32(hdr[hdrVersion:]) != segVersion {
+		return fmt.Errorf("%w: unsupported version", errBadSegment)
+	}
+	if crc32.Checksum(hdr[:hdrHeaderCRC], crcTable) != binary.LittleEndian.Uint32(hdr[hdrHeaderCRC:]) {
+		return fmt.Errorf("%w: header checksum mismatch", errBadSegment)
+	}
+	return nil
+}
+
+func (s *segment) close() error {
+	return unmapFile(s.data)
+}
+
+// checkIndex verifies the index checksum the first time the segment is
+// read, keeping open itself independent of the segment size.
+func (s *segment) checkIndex() error {
+	s.verify.Do(func() {
+		if crc32.Checksum(s.index, crcTable) != binary.LittleEndian.Uint32(s.data[hdrIndexCRC:]) {
+			s.verifyErr = fmt.Errorf("history: %s: %w: index checksum mismatch", s.path, errBadSegment)
+		}
+	})
+	return s.verifyErr
+}
+
+// rangeSeries appends the points of the series within [mint, maxt] to dst,
+// decoding straight from the mapping.
+func (s *segment) rangeSeries(h uint64, name string, ls metric.Labels, mint, maxt int64, dst []Point) ([]Point, error) {
+	if s.maxT < mint || s.minT > maxt {
+		return dst, nil
+	}
+	if err := s.checkIndex(); err != nil {
+		return dst, err
+	}
+	first, n, ok := s.lookup(h, name, ls)
+	if !ok {
+		return dst, nil
+	}
+
+	le := binary.LittleEndian
+	var it chunkIterator
+	for i := first; i < first+n; i++ {
+		e := s.chunks[i*chunkEntrySize:]
+		if int64(le.Uint64(e[8:])) > maxt {
+			break
+		}
+		if int64(le.Uint64(e[16:])) < mint {
+			continue
+		}
+		payload, err := s.record(le.Uint64(e), recChunk)
+		if err != nil {
+			return dst, err
+		}
+		count := le.Uint16(payload[4:])
+		dst = appendChunk(dst, &it, &chunk{data: payload[chunkPayloadHeader:], count: count}, mint, maxt)
+	}
+	return dst, nil
+}
+
+// lookup binary-searches the series table for the series.
+func (s *segment) lookup(h uint64, name string, ls metric.Labels) (first, n int, ok bool) {
+	le := binary.LittleEndian
+	count := len(s.series) / seriesEntrySize
+	i := sort.Search(count, func(i int) bool {
+		return le.Uint64(s.series[i*seriesEntrySize:]) >= h
+	})
+	// Walk the entries sharing the hash; collisions are compared by identity.
+	for ; i < count; i++ {
+		e := s.series[i*seriesEntrySize:]
+		if le.Uint64(e) != h {
+			return 0, 0, false
+		}
+		payload, err := s.record(le.Uint64(e[8:]), recSeries)
+		if err != nil {
+			return 0, 0, false
+		}
+		if seriesMatches(payload, name, ls) {
+			return int(le.Uint32(e[16:])), int(le.Uint32(e[20:])), true
+		}
+	}
+	return 0, 0, false
+}
+
+// record returns the verified payload of the record at off.
+func (s *segment) record(off uint64, typ byte) ([]byte, error) {
+	if off+recHeaderSize > uint64(len(s.data)) {
+		return nil, errBadSegment
+	}
+	r := s.data[off:]
+	n := uint64(binary.LittleEndian.Uint32(r[1:]))
+	if r[0] != typ || off+recHeaderSize+n > uint64(len(s.data)) {
+		return nil, errBadSegment
+	}
+	payload := r[recHeaderSize : recHeaderSize+n]
+	if crc32.Checksum(payload, crcTable) != binary.LittleEndian.Uint32(r[5:]) {
+		return nil, fmt.Errorf("history: %s: %w: record checksum mismatch", s.path, errBadSegment)
+	}
+	return payload, nil
+}
+
+// appendSeriesPayload encodes a series record: id, name, labels.
+func appendSeriesPayload(b []byte, id uint32, name string, ls metric.Labels) []byte {
+	b = binary.LittleEndian.AppendUint32(b, id)
+	b = appendString(b, name)
+	b = binary.AppendUvarint(b, uint64(len(ls)))
+	for _, l := range ls {
+		b = appendString(b, l.Name)
+		b = appendString(b, l.Value)
+	}
+	return b
+}
+
+func appendString(b []byte, s string) []byte {
+	b = binary.AppendUvarint(b, uint64(len(s)))
+	return append(b, s...)
+}
+
+// readString returns the next length-prefixed string as bytes.
+func readString(b []byte) (s, rest []byte, ok bool) {
+	n, k := binary.Uvarint(b)
+	if k <= 0 || uint64(len(b)-k) < n {
+		return nil, nil, false
+	}
+	return b[k : k+int(n)], b[k+int(n):], true
+}
+
+// seriesMatches compares a series record with an identity, without
+// allocating.
+func seriesMatches(payload []byte, name string, ls metric.Labels) bool {
+	n, b, ok := readString(payload[4:])
+	if !ok || string(n) != name {
+		return false
+	}
+	count, k := binary.Uvarint(b)
+	if k <= 0 || count != uint64(len(ls)) {
+		return false
+	}
+	b = b[k:]
+	for _, l := range ls {
+		var ln, lv []byte
+		if ln, b, ok = readString(b); !ok || string(ln) != l.Name {
+			return false
+		}
+		if lv, b, ok = readString(b); !ok || string(lv) != l.Value {
+			return false
+		}
+	}
+	return true
+}
+
+// parseSeriesPayload decodes a series record, for recovery.
+func parseSeriesPayload(payload []byte) (id uint32, name string, ls metric.Labels, ok bool) {
+	if len(payload) < 4 {
+		return 0, "", nil, false
+	}
+	id = binary.LittleEndian.Uint32(payload)
+	n, b, ok := readString(payload[4:])
+	if !ok {
+		return 0, "", nil, false
+	}
+	count, k := binary.Uvarint(b)
+	if k <= 0 || count > uint64(len(b)) {
+		return 0, "", nil, false
+	}
+	b = b[k:]
+	ls = make(metric.Labels, count)
+	for i := range ls {
+		var ln, lv []byte
+		if ln, b, ok = readString(b); !ok {
+			return 0, "", nil, false
+		}
+		if lv, b, ok = readString(b); !ok {
+			return 0, "", nil, false
+		}
+		ls[i] = metric.Label{Name: string(ln), Value: string(lv)}
+	}
+	return id, string(n), ls, true
+}
+
+// segmentWriter appends records to the active segment and builds its index.
+type segmentWriter struct {
+	path       string
+	f          *os.File
+	w          *bufio.Writer
+	off        uint64
+	minT, maxT int64
+	nChunks    int
+
+	byHash map[uint64][]*segSeries
+	series []*segSeries
+	buf    []byte
+}
+
+type segSeries struct {
+	hash   uint64
+	id     uint32
+	recOff uint64
+	name   string
+	labels metric.Labels
+	chunks []chunkEntry
+}
+
+type chunkEntry struct {
+	off        uint64
+	minT, maxT int64
+}
+
+func createSegment(path string) (*segmentWriter, error) {
+	f, err := os.OpenFile(path, os.O_RDWR|os.O_CREATE|os.O_EXCL, 0o644) //nolint:gosec // metric history is not secret
+	if err != nil {
+		return nil, err
+	}
+	w := newSegmentWriter(path, f)
+	// Placeholder header, rewritten by finalise.
+	var hdr [headerSize]byte
+	putHeader(hdr[:], 0, w)
+	if _, err := w.w.Write(hdr[:]); err != nil {
+		_ = f.Close()
+		return nil, err
+	}
+	w.off = headerSize
+	return w, nil
+}
+
+func newSegmentWriter(path string, f *os.File) *segmentWriter {
+	return &segmentWriter{
+		path:   path,
+		f:      f,
+		w:      bufio.NewWriter(f),
+		byHash: make(map[uint64][]*segSeries),
+	}
+}
+
+func (w *segmentWriter) writeRecord(typ byte, payload []byte) (uint64, error) {
+	var hdr [recHeaderSize]byte
+	hdr[0] = typ
+	binary.LittleEndian.PutUint32(hdr[1:], uint32(len(payload)))
+	binary.LittleEndian.PutUint32(hdr[5:], crc32.Checksum(payload, crcTable))
+	off := w.off
+	if _, err := w.w.Write(hdr[:]); err != nil {
+		return 0, err
+	}
+	if _, err := w.w.Write(payload); err != nil {
+		return 0, err
+	}
+	w.off += recHeaderSize + uint64(len(payload))
+	return off, nil
+}
+
+func (w *segmentWriter) getSeries(name string, ls metric.Labels) (*segSeries, error) {
+	h := stableHash(name, ls)
+	for _, s := range w.byHash[h] {
+		if s.name == name && s.labels.Equal(ls) {
+			return s, nil
+		}
+	}
+	s := &segSeries{hash: h, id: uint32(len(w.series)), name: name, labels: ls}
+	w.buf = appendSeriesPayload(w.buf[:0], s.id, name, ls)
+	off, err := w.writeRecord(recSeries, w.buf)
+	if err != nil {
+		return nil, err
+	}
+	s.recOff = off
+	w.byHash[h] = append(w.byHash[h], s)
+	w.series = append(w.series, s)
+	return s, nil
+}
+
+func (w *segmentWriter) writeChunk(name string, ls metric.Labels, c *chunk) error {
+	s, err := w.getSeries(name, ls)
+	if err != nil {
+		return err
+	}
+	le := binary.LittleEndian
+	b := le.AppendUint32(w.buf[:0], s.id)
+	b = le.AppendUint16(b, c.count)
+	b = le.AppendUint64(b, uint64(c.minT))
+	b = le.AppendUint64(b, uint64(c.maxT))
+	b = append(b, c.data...)
+	w.buf = b
+	off, err := w.writeRecord(recChunk, b)
+	if err != nil {
+		return err
+	}
+	s.chunks = append(s.chunks, chunkEntry{off: off, minT: c.minT, maxT: c.maxT})
+	w.track(c.minT, c.maxT)
+	return nil
+}
+
+func (w *segmentWriter) track(minT, maxT int64) {
+	if w.nChunks == 0 || minT < w.minT {
+		w.minT = minT
+	}
+	if w.nChunks == 0 || maxT > w.maxT {
+		w.maxT = maxT
+	}
+	w.nChunks++
+}
+
+// finalise writes the index and the final header, syncs and closes the
+// file.
+func (w *segmentWriter) finalise() error {
+	sort.Slice(w.series, func(i, j int) bool { return w.series[i].hash < w.series[j].hash })
+
+	le := binary.LittleEndian
+	idx := make([]byte, 0, len(w.series)*seriesEntrySize+w.nChunks*chunkEntrySize)
+	first := uint32(0)
+	for _, s := range w.series {
+		idx = le.AppendUint64(idx, s.hash)
+		idx = le.AppendUint64(idx, s.recOff)
+		idx = le.AppendUint32(idx, first)
+		idx = le.AppendUint32(idx, uint32(len(s.chunks)))
+		first += uint32(len(s.chunks))
+	}
+	for _, s := range w.series {
+		for _, c := range s.chunks {
+			idx = le.AppendUint64(idx, c.off)
+			idx = le.AppendUint64(idx, uint64(c.minT))
+			idx = le.AppendUint64(idx, uint64(c.maxT))
+		}
+	}
+	indexOff := w.off
+	if _, err := w.w.Write(idx); err != nil {
+		return w.abort(err)
+	}
+	if err := w.w.Flush(); err != nil {
+		return w.abort(err)
+	}
+
+	var hdr [headerSize]byte
+	putHeader(hdr[:], flagFinal, w)
+	le.PutUint64(hdr[hdrIndexOff:], indexOff)
+	le.PutUint32(hdr[hdrNSeries:], uint32(len(w.series)))
+	le.PutUint32(hdr[hdrNChunks:], uint32(w.nChunks))
+	le.PutUint32(hdr[hdrIndexCRC:], crc32.Checksum(idx, crcTable))
+	le.PutUint32(hdr[hdrHeaderCRC:], crc32.Checksum(hdr[:hdrHeaderCRC], crcTable))
+	if _, err := w.f.WriteAt(hdr[:], 0); err != nil {
+		return w.abort(err)
+	}
+	if err := w.f.Sync(); err != nil {
+		return w.abort(err)
+	}
+	return w.f.Close()
+}
+
+func (w *segmentWriter) abort(err error) error {
+	_ = w.f.Close()
+	return err
+}
+
+func putHeader(hdr []byte, flags uint32, w *segmentWriter) {
+	le := binary.LittleEndian
+	copy(hdr[hdrMagic:], segMagic)
+	le.PutUint32(hdr[hdrVersion:], segVersion)
+	le.PutUint32(hdr[hdrFlags:], flags)
+	le.PutUint64(hdr[hdrMinT:], uint64(w.minT))
+	le.PutUint64(hdr[hdrMaxT:], uint64(w.maxT))
+	le.PutUint32(hdr[hdrHeaderCRC:], crc32.Checksum(hdr[:hdrHeaderCRC], crcTable))
+}
+
+// recoverSegment rebuilds the index of a segment whose writer did not
+// finalise it, keeping every record up to the first damaged one.
+func recoverSegment(path string) error {
+	data, err := os.ReadFile(path) //nolint:gosec // path comes from the configured directory
+	if err != nil {
+		return err
+	}
+	if len(data) < headerSize || checkHeader(data[:headerSize]) != nil {
+		// Nothing usable was written before the crash.
+		return os.Remove(path)
+	}
+
+	f, err := os.OpenFile(path, os.O_RDWR, 0)
+	if err != nil {
+		return err
+	}
+	w := newSegmentWriter(path, f)
+	ids := make(map[uint32]*segSeries)
+	off := uint64(headerSize)
+	for off+recHeaderSize <= uint64(len(data)) {
+		r := data[off:]
+		n := uint64(binary.LittleEndian.Uint32(r[1:]))
+		if off+recHeaderSize+n > uint64(len(data)) {
+			break
+		}
+		payload := r[recHeaderSize : recHeaderSize+n]
+		if crc32.Checksum(payload, crcTable) != binary.LittleEndian.Uint32(r[5:]) || !w.recoverRecord(r[0], off, payload, ids) {
+			break
+		}
+		off += recHeaderSize + n
+	}
+
+	if err := f.Truncate(int64(off)); err != nil {
+		return w.abort(err)
+	}
+	if _, err := f.Seek(int64(off), 0); err != nil {
+		return w.abort(err)
+	}
+	w.off = off
+	return w.finalise()
+}
+
+func (w *segmentWriter) recoverRecord(typ byte, off uint64, payload []byte, ids map[uint32]*segSeries) bool {
+	switch typ {
+	case recSeries:
+		id, name, ls, ok := parseSeriesPayload(payload)
+		if !ok {
+			return false
+		}
+		s := &segSeries{hash: stableHash(name, ls), id: id, recOff: off, name: name, labels: ls}
+		ids[id] = s
+		w.byHash[s.hash] = append(w.byHash[s.hash], s)
+		w.series = append(w.series, s)
+	case recChunk:
+		if len(payload) < chunkPayloadHeader {
+			return false
+		}
+		le := binary.LittleEndian
+		s := ids[le.Uint32(payload)]
+		if s == nil {
+			return false
+		}
+		minT, maxT := int64(le.Uint64(payload[6:])), int64(le.Uint64(payload[14:]))
+		s.chunks = append(s.chunks, chunkEntry{off: off, minT: minT, maxT: maxT})
+		w.track(minT, maxT)
+	default:
+		return false
+	}
+	return true
+}
@@ -0,0 +1,298 @@
+package history
+
+import (
+	"errors"
+	"fmt"
+	"os"
+	"path/filepath"
+	"sort"
+	"strconv"
+	"strings"
+	"sync"
+	"sync/atomic"
+	"time"
+
+	"github.com/sm-moshi/dmetrics-go/metric"
+)
+
+// Defaults applied by OpenSegments to zero SegmentOptions fields.
+const (
+	DefaultMaxSegmentBytes    = 64 << 20
+	DefaultMaxSegmentDuration = 2 * time.Hour
+	DefaultSegmentRetention   = 7 * 24 * time.Hour
+	DefaultSegmentQueueSize   = 1024
+)
+
+// SegmentOptions configures the on-disk history.
+type SegmentOptions struct {
+	// Dir holds the segment files. It is created if missing.
+	Dir string
+	// MaxSegmentBytes rotates the active segment once it reaches this size.
+	MaxSegmentBytes int64
+	// MaxSegmentDuration rotates the active segment once its samples span
+	// this much time.
+	MaxSegmentDuration time.Duration
+	// Retention removes segments whose newest sample is this much older
+	// than the newest sample written.
+	Retention time.Duration
+	// QueueSize bounds the sealed chunks waiting for the background writer.
+	// Chunks arriving while it is full are dropped, not waited for.
+	QueueSize int
+}
+
+// SegmentStats describes the on-disk history.
+type SegmentStats struct {
+	Segments int
+	// Bytes is the size of the mapped segments.
+	Bytes int64
+	// WriteErrors counts chunks that could not be persisted.
+	WriteErrors uint64
+	// Dropped counts chunks discarded because the write queue was full.
+	Dropped uint64
+}
+
+// Segments persists sealed chunks to append-only, memory-mapped segment
+// files so history survives restarts. Attach it to a Store through
+// Options.Segments; chunks are queued as the Store seals them and written
+// by a background goroutine, so disk latency never holds up an append.
+type Segments struct {
+	opts SegmentOptions
+
+	mu     sync.RWMutex
+	final  []*segment // oldest first
+	active *segmentWriter
+	seq    uint64
+	newest int64
+
+	// qmu guards closed, so nothing is sent on queue once it is closed.
+	qmu    sync.RWMutex
+	closed bool
+	queue  chan chunkWrite
+	done   chan struct{}
+
+	writeErrors atomic.Uint64
+	dropped     atomic.Uint64
+}
+
+// chunkWrite is a chunk waiting for the background writer.
+type chunkWrite struct {
+	name   string
+	labels metric.Labels
+	c      *chunk
+}
+
+// OpenSegments maps the segments found in opts.Dir, recovering any left
+// unfinished by a crash, and prepares for new writes.
+func OpenSegments(opts SegmentOptions) (*Segments, error) {
+	if opts.Dir == "" {
+		return nil, errors.New("history: no segment directory configured")
+	}
+	if opts.MaxSegmentBytes <= 0 {
+		opts.MaxSegmentBytes = DefaultMaxSegmentBytes
+	}
+	if opts.MaxSegmentDuration <= 0 {
+		opts.MaxSegmentDuration = DefaultMaxSegmentDuration
+	}
+	if opts.Retention <= 0 {
+		opts.Retention = DefaultSegmentRetention
+	}
+	if opts.QueueSize <= 0 {
+		opts.QueueSize = DefaultSegmentQueueSize
+	}
+	if err := os.MkdirAll(opts.Dir, 0o755); err != nil { //nolint:gosec // metric history is not secret
+		return nil, err
+	}
+
+	seqs, err := listSegments(opts.Dir)
+	if err != nil {
+		return nil, err
+	}
+	s := &Segments{opts: opts}
+	for _, seq := range seqs {
+		s.seq = seq
+		path := s.path(seq)
+		seg, err := openSegment(path)
+		if errors.Is(err, errNotFinal) {
+			if err = recoverSegment(path); err != nil {
+				return nil, s.closeWith(err)
+			}
+			if _, statErr := os.Stat(path); os.IsNotExist(statErr) {
+				continue
+			}
+			seg, err = openSegment(path)
+		}
+		if err != nil {
+			return nil, s.closeWith(err)
+		}
+		s.final = append(s.final, seg)
+		s.newest = max(s.newest, seg.maxT)
+	}
+	s.queue = make(chan chunkWrite, opts.QueueSize)
+	s.done = make(chan struct{})
+	go s.run()
+	return s, nil
+}
+
+// listSegments returns the sequence numbers of the segment files in dir,
+// in order.
+func listSegments(dir string) ([]uint64, error) {
+	entries, err := os.ReadDir(dir)
+	if err != nil {
+		return nil, err
+	}
+	var seqs []uint64
+	for _, e := range entries {
+		name, ok := strings.CutSuffix(e.Name(), segExt)
+		if !ok || e.IsDir() {
+			continue
+		}
+		if seq, err := strconv.ParseUint(name, 10, 64); err == nil {
+			seqs = append(seqs, seq)
+		}
+	}
+	sort.Slice(seqs, func(i, j int) bool { return seqs[i] < seqs[j] })
+	return seqs, nil
+}
+
+func (s *Segments) path(seq uint64) string {
+	return filepath.Join(s.opts.Dir, fmt.Sprintf("%020d%s", seq, segExt))
+}
+
+func (s *Segments) closeWith(err error) error {
+	for _, seg := range s.final {
+		_ = seg.close()
+	}
+	s.final = nil
+	return err
+}
+
+// write queues a sealed chunk for persisting. The chunk and labels must
+// not change afterwards. With block unset, a full queue drops the chunk;
+// failures are counted, not returned, as they must not hold up collection.
+func (s *Segments) write(name string, ls metric.Labels, c *chunk, block bool) {
+	s.qmu.RLock()
+	defer s.qmu.RUnlock()
+	if s.closed {
+		s.dropped.Add(1)
+		return
+	}
+	w := chunkWrite{name: name, labels: ls, c: c}
+	if block {
+		s.queue <- w
+		return
+	}
+	select {
+	case s.queue <- w:
+	default:
+		s.dropped.Add(1)
+	}
+}
+
+// run writes queued chunks until the queue is closed. Each chunk is flushed
+// to the file as a whole, so a crash loses at most the records still queued.
+func (s *Segments) run() {
+	defer close(s.done)
+	for w := range s.queue {
+		s.mu.Lock()
+		err := s.writeLocked(w.name, w.labels, w.c)
+		if err == nil {
+			err = s.active.w.Flush()
+		}
+		s.mu.Unlock()
+		if err != nil {
+			s.writeErrors.Add(1)
+		}
+	}
+}
+
+func (s *Segments) writeLocked(name string, ls metric.Labels, c *chunk) error {
+	if w := s.active; w != nil && (int64(w.off) >= s.opts.MaxSegmentBytes ||
+		time.Duration(c.maxT-w.minT)*time.Millisecond >= s.opts.MaxSegmentDuration) {
+		if err := s.rotate(); err != nil {
+			return err
+		}
+	}
+	if s.active == nil {
+		s.seq++
+		w, err := createSegment(s.path(s.seq))
+		if err != nil {
+			return err
+		}
+		s.active = w
+	}
+	s.newest = max(s.newest, c.maxT)
+	return s.active.writeChunk(name, ls, c)
+}
+
+// rotate finalises and maps the active segment, then applies retention.
+func (s *Segments) rotate() error {
+	w := s.active
+	s.active = nil
+	if err := w.finalise(); err != nil {
+		return err
+	}
+	seg, err := openSegment(w.path)
+	if err != nil {
+		return err
+	}
+	s.final = append(s.final, seg)
+
+	mint := s.newest - s.opts.Retention.Milliseconds()
+	n := 0
+	for n < len(s.final) && s.final[n].maxT < mint {
+		_ = s.final[n].close()
+		_ = os.Remove(s.final[n].path)
+		n++
+	}
+	clear(s.final[:n])
+	s.final = s.final[n:]
+	return nil
+}
+
+// Range appends the persisted points of the series within [mint, maxt] to
+// dst. Only final segments are read; the chunks of the active one are still
+// held by the Store.
+func (s *Segments) Range(name string, ls metric.Labels, mint, maxt int64, dst []Point) ([]Point, error) {
+	s.mu.RLock()
+	defer s.mu.RUnlock()
+	h := stableHash(name, ls)
+	for _, seg := range s.final {
+		var err error
+		if dst, err = seg.rangeSeries(h, name, ls, mint, maxt, dst); err != nil {
+			return dst, err
+		}
+	}
+	return dst, nil
+}
+
+// Stats returns the current size of the on-disk history.
+func (s *Segments) Stats() SegmentStats {
+	s.mu.RLock()
+	defer s.mu.RUnlock()
+	st := SegmentStats{Segments: len(s.final), WriteErrors: s.writeErrors.Load(), Dropped: s.dropped.Load()}
+	for _, seg := range s.final {
+		st.Bytes += int64(len(seg.data))
+	}
+	return st
+}
+
+// Close writes the queued chunks, finalises the active segment and unmaps
+// all others.
+func (s *Segments) Close() error {
+	s.qmu.Lock()
+	if !s.closed {
+		s.closed = true
+		close(s.queue)
+	}
+	s.qmu.Unlock()
+	<-s.done
+
+	s.mu.Lock()
+	defer s.mu.Unlock()
+	var err error
+	if s.active != nil {
+		err = s.active.finalise()
+		s.active = nil
+	}
+	return s.closeWith(err)
+}
@@ -0,0 +1,206 @@
+package history
+
+import (
+	"math"
+	"sync"
+
+	"github.com/sm-moshi/dmetrics-go/metric"
+)
+
+// Point is a decoded sample.
+type Point struct {
+	T int64 // milliseconds since the Unix epoch
+	V float64
+}
+
+// Series is the compressed history of one series.
+type Series struct {
+	id     uint32
+	name   string
+	labels metric.Labels
+
+	mu    sync.RWMutex
+	raw   chunkList
+	tiers []tierData // one per Options.Tiers entry
+	// dead marks a series Truncate removed from the Store; appends to it
+	// must look the series up again.
+	dead bool
+}
+
+func newSeries(name string, ls metric.Labels, o *Options) *Series {
+	s := &Series{
+		name:   name,
+		labels: append(metric.Labels(nil), ls...),
+		raw:    newChunkList(),
+	}
+	if len(o.Tiers) > 0 {
+		s.tiers = make([]tierData, len(o.Tiers))
+		for i := range s.tiers {
+			s.tiers[i] = newTierData()
+		}
+	}
+	return s
+}
+
+// Name returns the metric name of the series.
+func (s *Series) Name() string { return s.name }
+
+// Labels returns the labels of the series. They must not be modified.
+func (s *Series) Labels() metric.Labels { return s.labels }
+
+// append adds a sample, rejecting those not newer than the last one. It
+// reports live as false, without adding anything, if the series has been
+// removed from its Store.
+func (s *Series) append(t int64, v float64, o *Options) (ok, live bool) {
+	s.mu.Lock()
+	defer s.mu.Unlock()
+
+	if s.dead {
+		return false, false
+	}
+	if last, ok := s.raw.lastT(); ok && t <= last {
+		return false, true
+	}
+	if c := s.raw.append(t, v, o.ChunkSamples); c != nil {
+		if o.Segments != nil {
+			o.Segments.write(s.name, s.labels, c, false)
+		}
+		s.raw.dropBefore(t - o.Retention.Milliseconds())
+	}
+	return true, true
+}
+
+// Range appends the points with mint <= T <= maxt to dst and returns it.
+// Chunks outside the range are skipped without being decoded.
+func (s *Series) Range(mint, maxt int64, dst []Point) []Point {
+	s.mu.RLock()
+	defer s.mu.RUnlock()
+	return s.raw.rangeInto(mint, maxt, dst)
+}
+
+// Iterator returns an iterator over the points with mint <= T <= maxt. It
+// works on a snapshot and does not block appends to the series.
+func (s *Series) Iterator(mint, maxt int64) *Iterator {
+	s.mu.RLock()
+	defer s.mu.RUnlock()
+
+	over := s.raw.overlapping(mint, maxt)
+	chunks := make([]*chunk, len(over), len(over)+1)
+	copy(chunks, over)
+	if s.raw.headOverlaps(mint, maxt) {
+		// The head keeps changing, so take a copy of what is there now.
+		h := s.raw.head.c
+		chunks = append(chunks, &chunk{
+			data:  append([]byte(nil), h.data...),
+			count: h.count,
+			minT:  h.minT,
+			maxT:  h.maxT,
+		})
+	}
+	return &Iterator{chunks: chunks, mint: mint, maxt: maxt, ci: -1}
+}
+
+// Iterator walks the points of a series in time order.
+type Iterator struct {
+	chunks     []*chunk
+	ci         int
+	it         chunkIterator
+	mint, maxt int64
+}
+
+// Next advances to the next point and reports whether there is one.
+func (it *Iterator) Next() bool {
+	for {
+		if it.ci >= 0 && it.it.next() {
+			if it.it.t > it.maxt {
+				it.ci = len(it.chunks)
+				return false
+			}
+			if it.it.t >= it.mint {
+				return true
+			}
+			continue
+		}
+		if it.ci >= 0 && it.it.err != nil {
+			return false
+		}
+		it.ci++
+		if it.ci >= len(it.chunks) {
+			return false
+		}
+		c := it.chunks[it.ci]
+		it.it.reset(c.data, c.count)
+	}
+}
+
+// At returns the current point.
+func (it *Iterator) At() (int64, float64) {
+	return it.it.t, it.it.v
+}
+
+// Err returns the decoding error that stopped the iteration, if any.
+func (it *Iterator) Err() error {
+	return it.it.err
+}
+
+// stats adds the series' chunk accounting to st, whose Tiers must have an
+// entry per tier.
+func (s *Series) stats(st *Stats) {
+	s.mu.RLock()
+	defer s.mu.RUnlock()
+	s.raw.addStats(&st.Chunks, &st.Samples, &st.Bytes)
+	for i := range s.tiers {
+		s.tiers[i].addStats(&st.Tiers[i])
+	}
+}
+
+// minTime returns the timestamp of the oldest raw sample held in memory, or
+// math.MaxInt64 if there is none.
+func (s *Series) minTime() int64 {
+	s.mu.RLock()
+	defer s.mu.RUnlock()
+	if t, ok := s.raw.minT(); ok {
+		return t
+	}
+	return math.MaxInt64
+}
+
+// persistHead queues a copy of the unsealed samples on segs, waiting for
+// room as nothing may be lost at shutdown.
+func (s *Series) persistHead(segs *Segments) {
+	s.mu.RLock()
+	h := *s.raw.head.c
+	h.data = append([]byte(nil), h.data...)
+	s.mu.RUnlock()
+	if h.count > 0 {
+		segs.write(s.name, s.labels, &h, true)
+	}
+}
+
+// empty reports whether the series holds no samples in any tier. The
+// caller holds s.mu.
+func (s *Series) empty() bool {
+	if !s.raw.empty() {
+		return false
+	}
+	for i := range s.tiers {
+		if !s.tiers[i].empty() {
+			return false
+		}
+	}
+	return true
+}
+
+// truncate drops the chunks that end before mint, in every tier. A series
+// left empty is marked dead, in the same critical section, so no append can
+// slip in between the check and its removal from the Store.
+func (s *Series) truncate(mint int64) (dead bool) {
+	s.mu.Lock()
+	defer s.mu.Unlock()
+	s.raw.truncate(mint)
+	for i := range s.tiers {
+		s.tiers[i].truncate(mint)
+	}
+	s.dead = s.empty()
+	return s.dead
+}
@@ -0,0 +1,88 @@
+// Package host exposes static facts about the machine: architecture, CPU
+// model, core counts, memory size, boot time, page size and model
+// identifier. None of them change while the host runs, so each is looked
+// up the first time it is asked for and cached for the life of the
+// process. Nothing is read at package initialisation; importing the
+// package costs nothing.
+package host
+
+import (
+	"errors"
+	"os"
+	"sync"
+	"time"
+)
+
+// ErrUnknown is returned for facts the platform does not provide.
+var ErrUnknown = errors.New("host: fact not available")
+
+// ErrUnsupported is returned on platforms without a fact source.
+var ErrUnsupported = errors.New("host: not supported on this platform")
+
+// cpuFacts are the facts read together from one source. model is empty
+// if the source does not name the processor.
+type cpuFacts struct {
+	model    string
+	logical  int
+	physical int
+}
+
+var (
+	machine  = sync.OnceValues(readMachine)
+	cpuInfo  = sync.OnceValues(readCPU)
+	memory   = sync.OnceValues(readMemory)
+	bootTime = sync.OnceValues(readBootTime)
+	model    = sync.OnceValues(readModel)
+)
+
+// Arch returns the hardware architecture as the kernel reports it, such
+// as "arm64" or "x86_64". It can differ from runtime.GOARCH, the binary's
+// architecture; on macOS an x86_64 binary running under Rosetta 2 also
+// sees arm64.
+func Arch() (string, error) {
+	return machine()
+}
+
+// CPUModel returns the processor's marketing name, or ErrUnknown where
+// the platform does not name it, as on many ARM boards.
+func CPUModel() (string, error) {
+	c, err := cpuInfo()
+	if err == nil && c.model == "" {
+		err = ErrUnknown
+	}
+	return c.model, err
+}
+
+// LogicalCores returns the number of logical CPUs of the host, regardless
+// of the process's affinity mask.
+func LogicalCores() (int, error) {
+	c, err := cpuInfo()
+	return c.logical, err
+}
+
+// PhysicalCores returns the number of physical cores of the host.
+func PhysicalCores() (int, error) {
+	c, err := cpuInfo()
+	return c.physical, err
+}
+
+// MemoryTotal returns the physical memory in bytes.
+func MemoryTotal() (uint64, error) {
+	return memory()
+}
+
+// BootTime returns when the host booted.
+func BootTime() (time.Time, error) {
+	return bootTime()
+}
+
+// PageSize returns the memory page size in bytes.
+func PageSize() int {
+	return os.Getpagesize()
+}
+
+// Model returns the hardware model identifier, such as "MacBookPro18,3"
+// or the DMI product name.
+func Model() (string, error) {
+	return model()
+}
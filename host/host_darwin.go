@@ -0,0 +1,82 @@
+//go:build darwin
+
+package host
+
+import (
+	"encoding/binary"
+	"syscall"
+	"time"
+)
+
+// Sizes of the binary sysctl values read here.
+const (
+	uint64Size  = 8
+	timevalSize = 16
+	usecOffset  = 8
+)
+
+// readMachine reports hw.machine, except under Rosetta 2, which makes it
+// read x86_64; sysctl.proc_translated only exists on Apple Silicon.
+func readMachine() (string, error) {
+	if translated, err := syscall.SysctlUint32("sysctl.proc_translated"); err == nil && translated == 1 {
+		return "arm64", nil
+	}
+	return syscall.Sysctl("hw.machine")
+}
+
+func readCPU() (cpuFacts, error) {
+	var c cpuFacts
+	logical, err := syscall.SysctlUint32("hw.logicalcpu")
+	if err != nil {
+		return c, err
+	}
+	physical, err := syscall.SysctlUint32("hw.physicalcpu")
+	if err != nil {
+		return c, err
+	}
+	c.logical, c.physical = int(logical), int(physical)
+	// A missing brand string leaves the model unknown, not the counts.
+	c.model, _ = syscall.Sysctl("machdep.cpu.brand_string")
+	return c, nil
+}
+
+func readMemory() (uint64, error) {
+	b, err := sysctlBytes("hw.memsize", uint64Size)
+	if err != nil {
+		return 0, err
+	}
+	return binary.LittleEndian.Uint64(b), nil
+}
+
+// readBootTime decodes kern.boottime, a struct timeval of a 64-bit tv_sec
+// and a 32-bit tv_usec padded to 16 bytes.
+func readBootTime() (time.Time, error) {
+	b, err := sysctlBytes("kern.boottime", timevalSize)
+	if err != nil {
+		return time.Time{}, err
+	}
+	sec := int64(binary.LittleEndian.Uint64(b))
+	usec := int64(binary.LittleEndian.Uint32(b[usecOffset:]))
+	return time.Unix(sec, usec*int64(time.Microsecond)), nil
+}
+
+func readModel() (string, error) {
+	return syscall.Sysctl("hw.model")
+}
+
+// sysctlBytes reads a binary sysctl of size bytes. syscall.Sysctl treats
+// every value as a C string and drops a final zero byte, so it is put back.
+func sysctlBytes(name string, size int) ([]byte, error) {
+	s, err := syscall.Sysctl(name)
+	if err != nil {
+		return nil, err
+	}
+	b := []byte(s)
+	if len(b) == size-1 {
+		b = append(b, 0)
+	}
+	if len(b) != size {
+		return nil, ErrUnknown
+	}
+	return b, nil
+}
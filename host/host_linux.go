@@ -0,0 +1,123 @@
+//go:build linux
+
+package host
+
+import (
+	"bufio"
+	"bytes"
+	"io"
+	"os"
+	"strconv"
+	"strings"
+	"syscall"
+	"time"
+)
+
+func readMachine() (string, error) {
+	var u syscall.Utsname
+	if err := syscall.Uname(&u); err != nil {
+		return "", err
+	}
+	b := make([]byte, 0, len(u.Machine))
+	for _, c := range u.Machine {
+		if c == 0 {
+			break
+		}
+		b = append(b, byte(c))
+	}
+	return string(b), nil
+}
+
+// readCPU parses /proc/cpuinfo once for the model name and core counts.
+func readCPU() (cpuFacts, error) {
+	f, err := os.Open("/proc/cpuinfo")
+	if err != nil {
+		return cpuFacts{}, err
+	}
+	defer f.Close()
+	return parseCPUInfo(f)
+}
+
+// parseCPUInfo reads cpuinfo records from r. The "Model" key of ARM
+// boards names the board, not the processor, and is left to readModel.
+// Physical cores are the distinct (physical id, core id) pairs; where the
+// kernel omits them, as on most ARM systems, each logical CPU is a core.
+func parseCPUInfo(r io.Reader) (cpuFacts, error) {
+	var c cpuFacts
+	type core struct{ pkg, id string }
+	cores := make(map[core]bool)
+	var cur core
+	sc := bufio.NewScanner(r)
+	for sc.Scan() {
+		key, value, ok := strings.Cut(sc.Text(), ":")
+		if !ok {
+			continue
+		}
+		key, value = strings.TrimSpace(key), strings.TrimSpace(value)
+		switch key {
+		case "processor":
+			c.logical++
+		case "model name", "Hardware":
+			if c.model == "" {
+				c.model = value
+			}
+		case "physical id":
+			cur.pkg = value
+		case "core id":
+			cur.id = value
+			cores[cur] = true
+		}
+	}
+	if err := sc.Err(); err != nil {
+		return c, err
+	}
+	c.physical = len(cores)
+	if c.physical == 0 {
+		c.physical = c.logical
+	}
+	return c, nil
+}
+
+func readMemory() (uint64, error) {
+	var si syscall.Sysinfo_t
+	if err := syscall.Sysinfo(&si); err != nil {
+		return 0, err
+	}
+	return uint64(si.Totalram) * uint64(si.Unit), nil
+}
+
+func readBootTime() (time.Time, error) {
+	b, err := os.ReadFile("/proc/stat")
+	if err != nil {
+		return time.Time{}, err
+	}
+	return parseBootTime(b)
+}
+
+// parseBootTime finds the btime line of /proc/stat, the boot time in
+// seconds since the epoch.
+func parseBootTime(stat []byte) (time.Time, error) {
+	for _, line := range bytes.Split(stat, []byte{'\n'}) {
+		if v, ok := bytes.CutPrefix(line, []byte("btime ")); ok {
+			sec, err := strconv.ParseInt(string(bytes.TrimSpace(v)), 10, 64)
+			if err != nil {
+				return time.Time{}, err
+			}
+			return time.Unix(sec, 0), nil
+		}
+	}
+	return time.Time{}, ErrUnknown
+}
+
+// readModel returns the DMI product name on PCs and the device tree model
+// on boards without DMI.
+func readModel() (string, error) {
+	for _, path := range []string{"/sys/class/dmi/id/product_name", "/sys/firmware/devicetree/base/model"} {
+		if b, err := os.ReadFile(path); err == nil {
+			if s := strings.TrimSpace(strings.TrimRight(string(b), "\x00")); s != "" {
+				return s, nil
+			}
+		}
+	}
+	return "", ErrUnknown
+}
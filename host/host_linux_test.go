@@ -0,0 +1,85 @@
+package host
+
+import (
+	"errors"
+	"strings"
+	"testing"
+	"time"
+)
+
+// x86 is two packages of two hyperthreaded cores each, abridged.
+const x86 = `processor	: 0
+physical id	: 0
+core id		: 0
+model name	: Intel(R) Xeon(R) CPU E5-2680 v4 @ 2.40GHz
+
+processor	: 1
+physical id	: 0
+core id		: 0
+model name	: Intel(R) Xeon(R) CPU E5-2680 v4 @ 2.40GHz
+
+processor	: 2
+physical id	: 0
+core id		: 1
+model name	: Intel(R) Xeon(R) CPU E5-2680 v4 @ 2.40GHz
+
+processor	: 3
+physical id	: 1
+core id		: 0
+model name	: Intel(R) Xeon(R) CPU E5-2680 v4 @ 2.40GHz
+
+processor	: 4
+physical id	: 1
+core id		: 1
+model name	: Intel(R) Xeon(R) CPU E5-2680 v4 @ 2.40GHz
+`
+
+// arm is a Raspberry Pi 4, which names the board but not the processor.
+const arm = `processor	: 0
+BogoMIPS	: 108.00
+CPU part	: 0xd08
+
+processor	: 1
+BogoMIPS	: 108.00
+CPU part	: 0xd08
+
+processor	: 2
+BogoMIPS	: 108.00
+
+processor	: 3
+BogoMIPS	: 108.00
+
+Revision	: c03111
+Model		: Raspberry Pi 4 Model B Rev 1.1
+`
+
+func TestParseCPUInfo(t *testing.T) {
+	for _, c := range []struct {
+		name string
+		in   string
+		want cpuFacts
+	}{
+		{"x86", x86, cpuFacts{"Intel(R) Xeon(R) CPU E5-2680 v4 @ 2.40GHz", 5, 4}},
+		{"arm", arm, cpuFacts{"", 4, 4}},
+		{"arm32", "processor : 0\nHardware : BCM2835\n", cpuFacts{"BCM2835", 1, 1}},
+		{"empty", "", cpuFacts{}},
+	} {
+		got, err := parseCPUInfo(strings.NewReader(c.in))
+		if err != nil || got != c.want {
+			t.Errorf("%s: %+v, %v, want %+v", c.name, got, err, c.want)
+		}
+	}
+}
+
+func TestParseBootTime(t *testing.T) {
+	got, err := parseBootTime([]byte("cpu  1 2 3\nintr 5\nbtime 1700000000\nprocesses 9\n"))
+	if err != nil || !got.Equal(time.Unix(1_700_000_000, 0)) {
+		t.Fatalf("%v, %v", got, err)
+	}
+	if _, err := parseBootTime([]byte("cpu  1 2 3\n")); !errors.Is(err, ErrUnknown) {
+		t.Fatalf("missing btime: %v", err)
+	}
+	if _, err := parseBootTime([]byte("btime x\n")); err == nil {
+		t.Fatal("malformed btime accepted")
+	}
+}
@@ -0,0 +1,11 @@
+//go:build !darwin && !linux
+
+package host
+
+import "time"
+
+func readMachine() (string, error)     { return "", ErrUnsupported }
+func readCPU() (cpuFacts, error)       { return cpuFacts{}, ErrUnsupported }
+func readMemory() (uint64, error)      { return 0, ErrUnsupported }
+func readBootTime() (time.Time, error) { return time.Time{}, ErrUnsupported }
+func readModel() (string, error)       { return "", ErrUnsupported }
@@ -0,0 +1,46 @@
+package host
+
+import (
+	"errors"
+	"os"
+	"testing"
+	"time"
+)
+
+func TestFacts(t *testing.T) {
+	arch, err := Arch()
+	if errors.Is(err, ErrUnsupported) {
+		t.Skip(err)
+	}
+	if err != nil || arch == "" {
+		t.Fatalf("Arch: %q, %v", arch, err)
+	}
+	logical, err := LogicalCores()
+	if err != nil || logical <= 0 {
+		t.Fatalf("LogicalCores: %d, %v", logical, err)
+	}
+	physical, err := PhysicalCores()
+	if err != nil || physical <= 0 || physical > logical {
+		t.Fatalf("PhysicalCores: %d, %v (logical %d)", physical, err, logical)
+	}
+	if mem, err := MemoryTotal(); err != nil || mem == 0 {
+		t.Fatalf("MemoryTotal: %d, %v", mem, err)
+	}
+	if boot, err := BootTime(); err != nil || boot.After(time.Now()) || boot.Unix() <= 0 {
+		t.Fatalf("BootTime: %v, %v", boot, err)
+	}
+	if PageSize() != os.Getpagesize() {
+		t.Fatalf("PageSize: %d", PageSize())
+	}
+}
+
+func TestFactsCached(t *testing.T) {
+	a, errA := BootTime()
+	b, errB := BootTime()
+	if !a.Equal(b) || !errors.Is(errB, errA) {
+		t.Fatalf("%v, %v then %v, %v", a, errA, b, errB)
+	}
+	if n := testing.AllocsPerRun(10, func() { _, _ = CPUModel() }); n != 0 {
+		t.Fatalf("CPUModel allocates %v times once cached", n)
+	}
+}
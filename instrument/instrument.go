@@ -0,0 +1,231 @@
+// Package instrument measures the library's own cost: for every collector
+// module, how long collections take, how often they fail, how many kernel,
+// IOKit and SMC calls they make and, with SetAllocTracking, how much they
+// allocate. All counters are lock-free atomics, so recording stays cheap
+// enough to leave on.
+//
+// The figures are exposed as metric.Samples, so they travel through the
+// same exporters and history as the system metrics.
+package instrument
+
+import (
+	"math/bits"
+	"runtime/metrics"
+	"strconv"
+	"sync"
+	"sync/atomic"
+	"time"
+
+	"github.com/sm-moshi/dmetrics-go/metric"
+)
+
+// Module names of the collectors.
+const (
+	CPU         = "cpu"
+	Memory      = "memory"
+	GPU         = "gpu"
+	Power       = "power"
+	Temperature = "temperature"
+	Network     = "network"
+	Process     = "process"
+	Disk        = "disk"
+	Filesystem  = "filesystem"
+	// Poll records the scheduler's polls, named by job, on top of what
+	// the collectors record themselves.
+	Poll = "poll"
+)
+
+// CallKind is a kind of expensive call made by a collector.
+type CallKind uint8
+
+const (
+	// Sysctl counts sysctl(3) and other plain system calls. Reads of
+	// /proc and /sys files are not counted.
+	Sysctl CallKind = iota
+	// IOKit counts IOKit registry and service calls.
+	IOKit
+	// SMC counts System Management Controller reads.
+	SMC
+	numCallKinds
+)
+
+var callKindNames = [numCallKinds]string{"sysctl", "iokit", "smc"}
+
+// String returns the label value of the call kind.
+func (k CallKind) String() string {
+	if k < numCallKinds {
+		return callKindNames[k]
+	}
+	return "unknown"
+}
+
+// Latency buckets are powers of two from 1024 ns (about 1 µs) to 2^31 ns
+// (about 2 s), so finding a bucket is a single bits.Len64.
+const (
+	minBucketShift = 10
+	numBuckets     = 22
+)
+
+// Stats holds the counters of one module.
+type Stats struct {
+	module  string
+	buckets [numBuckets + 1]atomic.Uint64 // the last one is +Inf
+	sumNs   atomic.Uint64
+	calls   atomic.Uint64
+	errors  atomic.Uint64
+	allocs  atomic.Uint64
+	kinds   [numCallKinds]atomic.Uint64
+}
+
+var registry sync.Map // module name -> *Stats
+
+// For returns the stats of a module, creating them on first use.
+func For(module string) *Stats {
+	if s, ok := registry.Load(module); ok {
+		return s.(*Stats)
+	}
+	s, _ := registry.LoadOrStore(module, &Stats{module: module})
+	return s.(*Stats)
+}
+
+// Span measures one collection. Obtain it from Start and finish it with End.
+type Span struct {
+	stats   *Stats
+	start   time.Time
+	allocs  uint64
+	tracked bool // allocs holds a reading to take the delta from
+}
+
+var allocTracking atomic.Bool
+
+// SetAllocTracking turns the measurement of allocated bytes per collection
+// on or off. It is off by default: every Start and End then reads the
+// process-wide allocation counter, which takes a runtime lock, and the delta
+// also counts what other goroutines allocated meanwhile, so it is only exact
+// when collectors run one after another. Turn it on to find which module
+// allocates, not in production.
+func SetAllocTracking(on bool) {
+	allocTracking.Store(on)
+}
+
+const allocsMetric = "/gc/heap/allocs:bytes"
+
+// heapAllocs returns the bytes allocated by the process so far.
+func heapAllocs() uint64 {
+	s := allocSamples.Get().(*[1]metrics.Sample)
+	defer allocSamples.Put(s)
+	metrics.Read(s[:])
+	if s[0].Value.Kind() != metrics.KindUint64 {
+		return 0
+	}
+	return s[0].Value.Uint64()
+}
+
+// allocSamples recycles the argument of metrics.Read, which escapes, so
+// measuring a collection does not itself allocate.
+var allocSamples = sync.Pool{New: func() any {
+	return &[1]metrics.Sample{{Name: allocsMetric}}
+}}
+
+// Start begins measuring a collection.
+func (s *Stats) Start() Span {
+	sp := Span{stats: s, start: time.Now()}
+	if allocTracking.Load() {
+		sp.allocs, sp.tracked = heapAllocs(), true
+	}
+	return sp
+}
+
+// End records the collection's latency, outcome and, if tracked when the
+// span started, allocations.
+func (sp Span) End(err error) {
+	s := sp.stats
+	ns := uint64(time.Since(sp.start))
+	s.buckets[bucket(ns)].Add(1)
+	s.sumNs.Add(ns)
+	s.calls.Add(1)
+	if err != nil {
+		s.errors.Add(1)
+	}
+	if !sp.tracked {
+		return
+	}
+	if a := heapAllocs(); a > sp.allocs {
+		s.allocs.Add(a - sp.allocs)
+	}
+}
+
+func bucket(ns uint64) int {
+	b := bits.Len64(ns >> minBucketShift)
+	if ns > 0 && ns&(ns-1) == 0 {
+		// Exact powers of two belong to the bucket they bound.
+		b--
+	}
+	return min(max(b, 0), numBuckets)
+}
+
+// AddCalls counts n calls of the given kind.
+func (s *Stats) AddCalls(kind CallKind, n uint64) {
+	if kind < numCallKinds {
+		s.kinds[kind].Add(n)
+	}
+}
+
+// Metric names of the exported samples.
+const (
+	DurationName = "dmetrics_collector_duration_seconds"
+	CallsName    = "dmetrics_collector_calls_total"
+	ErrorsName   = "dmetrics_collector_errors_total"
+	AllocsName   = "dmetrics_collector_alloc_bytes_total"
+	SysCallsName = "dmetrics_collector_system_calls_total"
+)
+
+// bucketBounds holds the "le" label values, computed once.
+var bucketBounds = func() [numBuckets + 1]string {
+	var b [numBuckets + 1]string
+	for i := 0; i < numBuckets; i++ {
+		secs := float64(uint64(1)<<(minBucketShift+i)) / float64(time.Second)
+		b[i] = strconv.FormatFloat(secs, 'g', -1, 64)
+	}
+	b[numBuckets] = "+Inf"
+	return b
+}()
+
+// AppendSamples appends the module's counters to dst as samples stamped
+// with now: a cumulative latency histogram in the Prometheus layout plus
+// counters of calls, errors, allocated bytes and system calls by kind. The
+// allocated bytes only grow while SetAllocTracking is on.
+func (s *Stats) AppendSamples(dst []metric.Sample, now time.Time) []metric.Sample {
+	ts := now.UnixMilli()
+	counter := func(name string, v uint64, ls metric.Labels) {
+		dst = append(dst, metric.Sample{Name: name, Labels: ls, Kind: metric.Counter, Value: float64(v), Timestamp: ts})
+	}
+	module := metric.Labels{{Name: "module", Value: s.module}}
+
+	var cum uint64
+	for i := range s.buckets {
+		cum += s.buckets[i].Load()
+		counter(DurationName+"_bucket", cum, metric.NewLabels("le", bucketBounds[i], "module", s.module))
+	}
+	dst = append(dst, metric.Sample{
+		Name: DurationName + "_sum", Labels: module, Kind: metric.Counter,
+		Value: float64(s.sumNs.Load()) / float64(time.Second), Timestamp: ts,
+	})
+	counter(DurationName+"_count", cum, module)
+	counter(CallsName, s.calls.Load(), module)
+	counter(ErrorsName, s.errors.Load(), module)
+	counter(AllocsName, s.allocs.Load(), module)
+	for k := CallKind(0); k < numCallKinds; k++ {
+		counter(SysCallsName, s.kinds[k].Load(), metric.NewLabels("kind", k.String(), "module", s.module))
+	}
+	return dst
+}
+
+// AppendAll appends the samples of every module seen so far.
+func AppendAll(dst []metric.Sample, now time.Time) []metric.Sample {
+	registry.Range(func(_, v any) bool {
+		dst = v.(*Stats).AppendSamples(dst, now)
+		return true
+	})
+	return dst
+}
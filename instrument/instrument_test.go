@@ -0,0 +1,131 @@
+package instrument
+
+import (
+	"errors"
+	"testing"
+	"time"
+
+	"github.com/sm-moshi/dmetrics-go/metric"
+)
+
+func TestBucket(t *testing.T) {
+	for _, c := range []struct {
+		ns   uint64
+		want int
+	}{
+		{0, 0},
+		{1, 0},
+		{1023, 0},
+		{1024, 0}, // exactly the first bound
+		{1025, 1},
+		{2048, 1},
+		{2049, 2},
+		{3000, 2},
+		{1 << 30, 20},
+		{1 << 31, numBuckets - 1}, // the last finite bound
+		{1<<31 + 1, numBuckets},
+		{1 << 40, numBuckets},
+		{^uint64(0), numBuckets},
+	} {
+		if got := bucket(c.ns); got != c.want {
+			t.Errorf("bucket(%d) = %d, want %d", c.ns, got, c.want)
+		}
+	}
+}
+
+func TestBucketBounds(t *testing.T) {
+	if bucketBounds[0] != "1.024e-06" || bucketBounds[numBuckets-1] != "2.147483648" || bucketBounds[numBuckets] != "+Inf" {
+		t.Fatalf("bounds %q … %q, %q", bucketBounds[0], bucketBounds[numBuckets-1], bucketBounds[numBuckets])
+	}
+}
+
+// record books a span of ns nanoseconds the way End does.
+func record(s *Stats, ns uint64, err error) {
+	s.buckets[bucket(ns)].Add(1)
+	s.sumNs.Add(ns)
+	s.calls.Add(1)
+	if err != nil {
+		s.errors.Add(1)
+	}
+}
+
+func TestAppendSamples(t *testing.T) {
+	s := &Stats{module: "test"}
+	for _, ns := range []uint64{500, 1024, 1500, 2048, 1 << 31, 3 << 31} {
+		record(s, ns, nil)
+	}
+	record(s, 4096, errors.New("failed"))
+	s.AddCalls(IOKit, 3)
+	s.AddCalls(numCallKinds, 5) // ignored
+
+	now := time.UnixMilli(1_700_000_000_000)
+	out := s.AppendSamples(nil, now)
+	if want := numBuckets + 1 + 2 + 3 + int(numCallKinds); len(out) != want {
+		t.Fatalf("%d samples, want %d", len(out), want)
+	}
+	byLe := map[string]float64{}
+	prev := 0.0
+	for i, x := range out[:numBuckets+1] {
+		if x.Name != DurationName+"_bucket" || x.Kind != metric.Counter || x.Timestamp != now.UnixMilli() {
+			t.Fatalf("sample %d: %+v", i, x)
+		}
+		if x.Labels.Get("module") != "test" || x.Labels.Get("le") != bucketBounds[i] {
+			t.Fatalf("sample %d labels %v", i, x.Labels)
+		}
+		if x.Value < prev {
+			t.Fatalf("bucket %s decreases: %v after %v", bucketBounds[i], x.Value, prev)
+		}
+		prev = x.Value
+		byLe[bucketBounds[i]] = x.Value
+	}
+	for le, want := range map[string]float64{
+		"1.024e-06":   2, // 500 and the edge 1024
+		"2.048e-06":   4, // 1500 and the edge 2048
+		"4.096e-06":   5,
+		"2.147483648": 6,
+		"+Inf":        7,
+	} {
+		if byLe[le] != want {
+			t.Errorf("le=%s: %v, want %v", le, byLe[le], want)
+		}
+	}
+
+	rest := map[string]float64{}
+	for _, x := range out[numBuckets+1:] {
+		key := x.Name
+		if k := x.Labels.Get("kind"); k != "" {
+			key += "/" + k
+		}
+		rest[key] = x.Value
+	}
+	wantSum := float64(500+1024+1500+2048+1<<31+3<<31+4096) / float64(time.Second)
+	for name, want := range map[string]float64{
+		DurationName + "_sum":   wantSum,
+		DurationName + "_count": 7,
+		CallsName:               7,
+		ErrorsName:              1,
+		AllocsName:              0,
+		SysCallsName + "/iokit": 3,
+		SysCallsName + "/smc":   0,
+	} {
+		if rest[name] != want {
+			t.Errorf("%s = %v, want %v", name, rest[name], want)
+		}
+	}
+}
+
+func TestSpanCounts(t *testing.T) {
+	s := For("test-span")
+	s.Start().End(nil)
+	s.Start().End(errors.New("failed"))
+	if s.calls.Load() != 2 || s.errors.Load() != 1 || s.allocs.Load() != 0 {
+		t.Fatalf("calls %d, errors %d, allocs %d", s.calls.Load(), s.errors.Load(), s.allocs.Load())
+	}
+	var n uint64
+	for i := range s.buckets {
+		n += s.buckets[i].Load()
+	}
+	if n != 2 {
+		t.Fatalf("%d spans in the histogram", n)
+	}
+}
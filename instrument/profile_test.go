@@ -0,0 +1,72 @@
+package instrument
+
+import (
+	"context"
+	"runtime/pprof"
+	"strings"
+	"testing"
+)
+
+// goroutineLabels returns the goroutine profile, which lists the labels of
+// every goroutine but the one taking it.
+func goroutineLabels(t *testing.T) string {
+	t.Helper()
+	var b strings.Builder
+	if err := pprof.Lookup("goroutine").WriteTo(&b, 1); err != nil {
+		t.Fatal(err)
+	}
+	return b.String()
+}
+
+func TestDoRestoresGoroutineLabels(t *testing.T) {
+	SetProfilerLabels(true)
+	defer SetProfilerLabels(false)
+
+	const own, ours = `"owner":"restore-test"`, `"metric":"restore-test"`
+	for _, caller := range []context.Context{
+		context.Background(),
+		pprof.WithLabels(context.Background(), pprof.Labels("req", "1")),
+	} {
+		// The collecting goroutine parks at each point its labels are
+		// checked at, and the test goroutine profiles it meanwhile.
+		parked, resume := make(chan struct{}), make(chan struct{})
+		go func() {
+			// Its labels differ from those of the context handed to
+			// Do, as for a goroutine started inside pprof.Do.
+			pprof.SetGoroutineLabels(pprof.WithLabels(context.Background(), pprof.Labels("owner", "restore-test")))
+			_ = Do(caller, CPU, "restore-test", func(context.Context) error {
+				parked <- struct{}{}
+				<-resume
+				return nil
+			})
+			parked <- struct{}{}
+			<-resume
+		}()
+
+		<-parked
+		if during := goroutineLabels(t); !strings.Contains(during, ours) || !strings.Contains(during, `"module":"cpu"`) {
+			t.Errorf("collection not labelled:\n%s", during)
+		}
+		resume <- struct{}{}
+		<-parked
+		if after := goroutineLabels(t); !strings.Contains(after, own) || strings.Contains(after, ours) {
+			t.Errorf("labels not restored:\n%s", after)
+		}
+		resume <- struct{}{}
+	}
+}
+
+func TestDoPassesCallerLabels(t *testing.T) {
+	SetProfilerLabels(true)
+	defer SetProfilerLabels(false)
+
+	ctx := pprof.WithLabels(context.Background(), pprof.Labels("req", "1"))
+	_ = Do(ctx, CPU, "usage", func(ctx context.Context) error {
+		for k, want := range map[string]string{"req": "1", LabelModule: CPU, LabelMetric: "usage"} {
+			if v, _ := pprof.Label(ctx, k); v != want {
+				t.Errorf("label %s = %q, want %q", k, v, want)
+			}
+		}
+		return nil
+	})
+}
@@ -0,0 +1,133 @@
+// Package intern maps byte sequences read from the kernel to canonical Go
+// strings, so names that repeat in every sample, such as process commands
+// and interface names, are allocated once rather than on every read.
+//
+// A Table holds a bounded number of strings and evicts with the CLOCK
+// algorithm: a string used since the hand last passed gets a second
+// chance. Handles carry the slot's generation, so a handle to an evicted
+// string is detected rather than resolving to whatever replaced it.
+package intern
+
+import (
+	"bytes"
+	"sync"
+)
+
+// DefaultCapacity is the number of strings a Table holds when New is given
+// no capacity.
+const DefaultCapacity = 4096
+
+// Handle identifies an interned string. The zero Handle is never issued.
+type Handle uint64
+
+const slotBits = 32
+
+func makeHandle(slot int, gen uint32) Handle {
+	return Handle(uint64(gen)<<slotBits | uint64(slot+1))
+}
+
+func (h Handle) split() (slot int, gen uint32) {
+	return int(uint32(h)) - 1, uint32(h >> slotBits)
+}
+
+// Stats are counters of a Table.
+type Stats struct {
+	Len       int
+	Hits      uint64
+	Misses    uint64
+	Evictions uint64
+}
+
+type entry struct {
+	s   string
+	gen uint32
+	ref bool
+}
+
+// Table is a bounded intern table. It is safe for concurrent use.
+type Table struct {
+	mu       sync.Mutex
+	index    map[string]int
+	entries  []entry
+	capacity int
+	hand     int
+
+	hits, misses, evictions uint64
+}
+
+// New returns a table holding up to capacity strings, DefaultCapacity if
+// capacity is not positive.
+func New(capacity int) *Table {
+	if capacity <= 0 {
+		capacity = DefaultCapacity
+	}
+	return &Table{index: make(map[string]int), capacity: capacity}
+}
+
+// Intern returns the canonical string equal to b and its handle. b is cut
+// at its first NUL byte, so fixed-size C character arrays can be passed as
+// they are. Only a miss allocates.
+func (t *Table) Intern(b []byte) (Handle, string) {
+	if i := bytes.IndexByte(b, 0); i >= 0 {
+		b = b[:i]
+	}
+	t.mu.Lock()
+	defer t.mu.Unlock()
+	if slot, ok := t.index[string(b)]; ok {
+		e := &t.entries[slot]
+		e.ref = true
+		t.hits++
+		return makeHandle(slot, e.gen), e.s
+	}
+	t.misses++
+	s := string(b)
+	slot := t.slot()
+	e := &t.entries[slot]
+	e.s, e.ref = s, true
+	t.index[s] = slot
+	return makeHandle(slot, e.gen), s
+}
+
+// Bytes returns the canonical string equal to b.
+func (t *Table) Bytes(b []byte) string {
+	_, s := t.Intern(b)
+	return s
+}
+
+// Lookup returns the string of h, or false if it has been evicted.
+func (t *Table) Lookup(h Handle) (string, bool) {
+	slot, gen := h.split()
+	t.mu.Lock()
+	defer t.mu.Unlock()
+	if slot < 0 || slot >= len(t.entries) || t.entries[slot].gen != gen {
+		return "", false
+	}
+	return t.entries[slot].s, true
+}
+
+// Stats returns a snapshot of the counters.
+func (t *Table) Stats() Stats {
+	t.mu.Lock()
+	defer t.mu.Unlock()
+	return Stats{Len: len(t.index), Hits: t.hits, Misses: t.misses, Evictions: t.evictions}
+}
+
+// slot returns a free slot, evicting the first entry the clock hand finds
+// unused since its last pass when the table is full.
+func (t *Table) slot() int {
+	if len(t.entries) < t.capacity {
+		t.entries = append(t.entries, entry{})
+		return len(t.entries) - 1
+	}
+	for t.entries[t.hand].ref {
+		t.entries[t.hand].ref = false
+		t.hand = (t.hand + 1) % len(t.entries)
+	}
+	slot := t.hand
+	t.hand = (t.hand + 1) % len(t.entries)
+	e := &t.entries[slot]
+	delete(t.index, e.s)
+	e.gen++
+	t.evictions++
+	return slot
+}
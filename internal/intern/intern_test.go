@@ -0,0 +1,82 @@
+package intern
+
+import "testing"
+
+func TestNULTrimmed(t *testing.T) {
+	tb := New(0)
+	var name [16]byte
+	copy(name[:], "eth0")
+	h1, s1 := tb.Intern(name[:])
+	h2, s2 := tb.Intern([]byte("eth0"))
+	if s1 != "eth0" || s2 != "eth0" || h1 != h2 {
+		t.Fatalf("%q %v, %q %v", s1, h1, s2, h2)
+	}
+	if _, s := tb.Intern([]byte("a\x00b")); s != "a" {
+		t.Fatalf("cut at the first NUL: %q", s)
+	}
+	if _, s := tb.Intern([]byte("\x00")); s != "" {
+		t.Fatalf("only a NUL: %q", s)
+	}
+	if st := tb.Stats(); st.Len != 3 || st.Hits != 1 || st.Misses != 3 {
+		t.Fatalf("stats %+v", st)
+	}
+}
+
+func TestClockEviction(t *testing.T) {
+	tb := New(3)
+	ha, _ := tb.Intern([]byte("a"))
+	hb, _ := tb.Intern([]byte("b"))
+	hc, _ := tb.Intern([]byte("c"))
+
+	// All were used since the hand last passed: one full turn clears
+	// them and the hand comes back to evict a.
+	hd, _ := tb.Intern([]byte("d"))
+	if _, ok := tb.Lookup(ha); ok {
+		t.Fatal("a not evicted")
+	}
+	// Using b gives it a second chance, so c goes next.
+	tb.Bytes([]byte("b"))
+	tb.Bytes([]byte("e"))
+	if _, ok := tb.Lookup(hc); ok {
+		t.Fatal("c not evicted")
+	}
+	for h, want := range map[Handle]string{hb: "b", hd: "d"} {
+		if s, ok := tb.Lookup(h); !ok || s != want {
+			t.Fatalf("Lookup = %q, %v, want %q", s, ok, want)
+		}
+	}
+	if st := tb.Stats(); st.Len != 3 || st.Evictions != 2 {
+		t.Fatalf("stats %+v", st)
+	}
+}
+
+func TestLookupStaleHandle(t *testing.T) {
+	tb := New(1)
+	old, _ := tb.Intern([]byte("old"))
+	cur, _ := tb.Intern([]byte("new"))
+	// The slot was reused; only the generation tells the handles apart.
+	if slot, _ := old.split(); slot != 0 || old == cur {
+		t.Fatalf("handles %x, %x", old, cur)
+	}
+	if s, ok := tb.Lookup(old); ok {
+		t.Fatalf("stale handle resolved to %q", s)
+	}
+	if s, ok := tb.Lookup(cur); !ok || s != "new" {
+		t.Fatalf("current handle: %q, %v", s, ok)
+	}
+	for _, h := range []Handle{0, makeHandle(5, 0)} {
+		if _, ok := tb.Lookup(h); ok {
+			t.Fatalf("handle %x resolved", h)
+		}
+	}
+}
+
+func TestHitDoesNotAllocate(t *testing.T) {
+	tb := New(0)
+	var name [32]byte
+	copy(name[:], "kworker/0:1")
+	tb.Bytes(name[:])
+	if allocs := testing.AllocsPerRun(100, func() { tb.Bytes(name[:]) }); allocs != 0 {
+		t.Fatalf("%v allocations per hit", allocs)
+	}
+}
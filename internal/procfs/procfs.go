@@ -0,0 +1,55 @@
+// Package procfs holds the helpers the Linux collectors share for reading
+// the kernel's text files in /proc and /sys. Those files are generated on
+// every read, so a collector keeps each one open and rereads it from the
+// start into a buffer it owns, which costs no allocation once the buffer
+// has grown to fit.
+package procfs
+
+import (
+	"errors"
+	"io"
+	"os"
+)
+
+const decimalBase = 10
+
+// Reread reads the whole of f from its start into *buf, doubling the buffer
+// while the contents do not fit, and returns the bytes read. *buf must not
+// be empty.
+func Reread(f *os.File, buf *[]byte) ([]byte, error) {
+	if _, err := f.Seek(0, io.SeekStart); err != nil {
+		return nil, err
+	}
+	b := *buf
+	n := 0
+	for {
+		if n == len(b) {
+			b = append(b, make([]byte, len(b))...)
+			*buf = b
+		}
+		m, err := f.Read(b[n:])
+		n += m
+		if errors.Is(err, io.EOF) || (err == nil && m == 0) {
+			return b[:n], nil
+		}
+		if err != nil {
+			return nil, err
+		}
+	}
+}
+
+// ParseUint parses a decimal number of digits only, as the kernel prints
+// its counters. It reports false for empty input, signs and spaces.
+func ParseUint(b []byte) (uint64, bool) {
+	if len(b) == 0 {
+		return 0, false
+	}
+	var v uint64
+	for _, ch := range b {
+		if ch < '0' || ch > '9' {
+			return 0, false
+		}
+		v = v*decimalBase + uint64(ch-'0')
+	}
+	return v, true
+}
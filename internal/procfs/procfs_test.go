@@ -0,0 +1,48 @@
+package procfs
+
+import (
+	"os"
+	"path/filepath"
+	"strings"
+	"testing"
+)
+
+func TestReread(t *testing.T) {
+	path := filepath.Join(t.TempDir(), "stat")
+	want := strings.Repeat("cpu 1 2 3\n", 100)
+	if err := os.WriteFile(path, []byte(want), 0o600); err != nil {
+		t.Fatal(err)
+	}
+	f, err := os.Open(path)
+	if err != nil {
+		t.Fatal(err)
+	}
+	defer func() { _ = f.Close() }()
+
+	buf := make([]byte, 16)
+	for i := 0; i < 2; i++ {
+		got, err := Reread(f, &buf)
+		if err != nil || string(got) != want {
+			t.Fatalf("read %d: %q, %v", i, got, err)
+		}
+	}
+	if len(buf) != 1024 {
+		t.Fatalf("buffer grew to %d", len(buf))
+	}
+	if allocs := testing.AllocsPerRun(10, func() { _, _ = Reread(f, &buf) }); allocs != 0 {
+		t.Fatalf("%v allocations per reread", allocs)
+	}
+}
+
+func TestParseUint(t *testing.T) {
+	for in, want := range map[string]uint64{"0": 0, "42": 42, "18446744073709551615": 1<<64 - 1} {
+		if v, ok := ParseUint([]byte(in)); !ok || v != want {
+			t.Errorf("ParseUint(%q) = %d, %v", in, v, ok)
+		}
+	}
+	for _, in := range []string{"", "-1", "+1", " 1", "1 ", "1a", "0x10"} {
+		if v, ok := ParseUint([]byte(in)); ok {
+			t.Errorf("ParseUint(%q) = %d", in, v)
+		}
+	}
+}
@@ -0,0 +1,170 @@
+// Package protowire holds the few protobuf wire-format primitives the
+// exporters need to hand-encode their requests into a reusable buffer, and
+// a field reader to check what they produce.
+//
+// Nested messages are length-prefixed, so callers size them first with the
+// *Size helpers and then append the fields in one pass.
+package protowire
+
+import (
+	"encoding/binary"
+	"errors"
+	"math"
+	"math/bits"
+)
+
+// Wire types used by the exporters.
+const (
+	TypeVarint  = 0
+	TypeFixed64 = 1
+	TypeBytes   = 2
+)
+
+const (
+	tagShift        = 3
+	varintGroupBits = 7
+	fixed64Size     = 8
+)
+
+// AppendVarint appends v in base-128 varint encoding.
+func AppendVarint(b []byte, v uint64) []byte {
+	for v >= 0x80 {
+		b = append(b, byte(v)|0x80)
+		v >>= 7
+	}
+	return append(b, byte(v))
+}
+
+// VarintSize returns the encoded length of v.
+func VarintSize(v uint64) int {
+	// Every 7 bits of payload need one byte; bits.Len64(0) is 0 but 0 still
+	// needs a byte, hence the |1.
+	return (bits.Len64(v|1) + varintGroupBits - 1) / varintGroupBits
+}
+
+// AppendTag appends the key of field num with the given wire type.
+func AppendTag(b []byte, num, typ int) []byte {
+	return AppendVarint(b, uint64(num)<<tagShift|uint64(typ))
+}
+
+// TagSize returns the encoded length of the key of field num.
+func TagSize(num int) int {
+	return VarintSize(uint64(num) << tagShift)
+}
+
+// AppendBytesField appends a length-delimited field holding s.
+func AppendBytesField(b []byte, num int, s string) []byte {
+	b = AppendTag(b, num, TypeBytes)
+	b = AppendVarint(b, uint64(len(s)))
+	return append(b, s...)
+}
+
+// BytesFieldSize returns the encoded length of a length-delimited field with
+// an n byte payload, including key and length prefix.
+func BytesFieldSize(num, n int) int {
+	return TagSize(num) + VarintSize(uint64(n)) + n
+}
+
+// AppendMessageHeader appends the key and length prefix of an embedded
+// message whose body, n bytes long, the caller appends next.
+func AppendMessageHeader(b []byte, num, n int) []byte {
+	b = AppendTag(b, num, TypeBytes)
+	return AppendVarint(b, uint64(n))
+}
+
+// AppendDoubleField appends a fixed64 double field.
+func AppendDoubleField(b []byte, num int, v float64) []byte {
+	b = AppendTag(b, num, TypeFixed64)
+	return binary.LittleEndian.AppendUint64(b, math.Float64bits(v))
+}
+
+// DoubleFieldSize returns the encoded length of a double field.
+func DoubleFieldSize(num int) int {
+	return TagSize(num) + fixed64Size
+}
+
+// AppendFixed64Field appends a fixed64 field.
+func AppendFixed64Field(b []byte, num int, v uint64) []byte {
+	b = AppendTag(b, num, TypeFixed64)
+	return binary.LittleEndian.AppendUint64(b, v)
+}
+
+// AppendVarintField appends a varint field. Negative int64 values must be
+// passed through uint64 conversion, matching protobuf's int64 encoding.
+func AppendVarintField(b []byte, num int, v uint64) []byte {
+	b = AppendTag(b, num, TypeVarint)
+	return AppendVarint(b, v)
+}
+
+// VarintFieldSize returns the encoded length of a varint field.
+func VarintFieldSize(num int, v uint64) int {
+	return TagSize(num) + VarintSize(v)
+}
+
+var zeros [binary.MaxVarintLen64]byte
+
+// StartMessage appends the key of an embedded message and reserves a byte
+// for its length, for messages too deeply nested to size up front. It
+// returns the offset to pass to EndMessage once the body has been appended.
+func StartMessage(b []byte, num int) ([]byte, int) {
+	b = AppendTag(b, num, TypeBytes)
+	return append(b, 0), len(b)
+}
+
+// EndMessage fills in the length reserved by StartMessage, shifting the body
+// when the length needs more than one byte.
+func EndMessage(b []byte, start int) []byte {
+	n := len(b) - start - 1
+	size := VarintSize(uint64(n))
+	if extra := size - 1; extra > 0 {
+		b = append(b, zeros[:extra]...)
+		copy(b[start+size:], b[start+1:len(b)-extra])
+	}
+	binary.PutUvarint(b[start:], uint64(n))
+	return b
+}
+
+// ErrTruncated is returned by ConsumeField for malformed input.
+var ErrTruncated = errors.New("protowire: truncated or malformed field")
+
+// Field is one decoded field. Varint and fixed64 values are in Value;
+// length-delimited payloads, including embedded messages, are in Bytes.
+type Field struct {
+	Num   int
+	Type  int
+	Value uint64
+	Bytes []byte
+}
+
+// ConsumeField decodes the first field of b and returns it with the rest
+// of b.
+func ConsumeField(b []byte) (Field, []byte, error) {
+	key, n := binary.Uvarint(b)
+	if n <= 0 {
+		return Field{}, nil, ErrTruncated
+	}
+	b = b[n:]
+	f := Field{Num: int(key >> tagShift), Type: int(key & (1<<tagShift - 1))}
+	switch f.Type {
+	case TypeVarint:
+		if f.Value, n = binary.Uvarint(b); n <= 0 {
+			return Field{}, nil, ErrTruncated
+		}
+		return f, b[n:], nil
+	case TypeFixed64:
+		if len(b) < fixed64Size {
+			return Field{}, nil, ErrTruncated
+		}
+		f.Value = binary.LittleEndian.Uint64(b)
+		return f, b[fixed64Size:], nil
+	case TypeBytes:
+		size, n := binary.Uvarint(b)
+		if n <= 0 || uint64(len(b)-n) < size {
+			return Field{}, nil, ErrTruncated
+		}
+		f.Bytes = b[n : n+int(size)]
+		return f, b[n+int(size):], nil
+	default:
+		return Field{}, nil, ErrTruncated
+	}
+}
@@ -0,0 +1,291 @@
+// Package snappy implements the Snappy block format, which is what
+// Prometheus remote_write expects on the wire. The exporters only encode;
+// Decode exists so the wire output can be checked end to end. Keeping it
+// in-tree avoids a dependency for a couple of hundred lines.
+//
+// The format is described at
+// https://github.com/google/snappy/blob/main/format_description.txt.
+package snappy
+
+import (
+	"encoding/binary"
+	"errors"
+)
+
+const (
+	tagLiteral = 0x00
+	tagCopy1   = 0x01
+	tagCopy2   = 0x02
+	tagBits    = 2
+	byteBits   = 8
+
+	// maxBlockSize is the largest input handed to encodeBlock at once; copy
+	// offsets must fit in 16 bits for tagCopy2.
+	maxBlockSize = 1 << 16
+
+	// inputMargin keeps the 8-byte loads in encodeBlock inside the block.
+	inputMargin = 16 - 1
+	// minNonLiteralBlockSize is the smallest block worth searching for
+	// matches in.
+	minNonLiteralBlockSize = 1 + 1 + inputMargin
+
+	tableBits = 14
+	tableSize = 1 << tableBits
+	hashMul   = 0x1e35a7bd
+	hashBits  = 32
+	skipShift = 5
+
+	minMatch         = 4
+	maxCopy1Length   = 11
+	maxCopy1Offset   = 1 << 11
+	copy1OffsetShift = 5
+	maxCopy2Length   = 64
+
+	literalLenShort = 60
+	literalLen1Byte = 1 << 8
+
+	// Worst-case expansion, as in the reference encoder.
+	encodedLenSlack   = 32
+	encodedLenDivisor = 6
+)
+
+// Encoder compresses into a buffer it keeps between calls, so steady-state
+// encoding does not allocate. An Encoder is not safe for concurrent use.
+type Encoder struct {
+	table [tableSize]uint16
+	dst   []byte
+}
+
+// MaxEncodedLen returns the worst-case encoded size of an n byte input.
+func MaxEncodedLen(n int) int {
+	return encodedLenSlack + n + n/encodedLenDivisor
+}
+
+// Encode returns the Snappy block encoding of src. The returned slice aliases
+// the Encoder's buffer and is only valid until the next call.
+func (e *Encoder) Encode(src []byte) []byte {
+	if n := MaxEncodedLen(len(src)); cap(e.dst) < n {
+		e.dst = make([]byte, 0, n)
+	}
+	dst := binary.AppendUvarint(e.dst[:0], uint64(len(src)))
+
+	for len(src) > 0 {
+		p := src
+		if len(p) > maxBlockSize {
+			p = p[:maxBlockSize]
+		}
+		src = src[len(p):]
+		if len(p) < minNonLiteralBlockSize {
+			dst = appendLiteral(dst, p)
+		} else {
+			dst = e.encodeBlock(dst, p)
+		}
+	}
+	e.dst = dst
+	return dst
+}
+
+func hash(u uint32) uint32 {
+	return (u * hashMul) >> (hashBits - tableBits)
+}
+
+func load32(b []byte, i int) uint32 {
+	return binary.LittleEndian.Uint32(b[i:])
+}
+
+func load64(b []byte, i int) uint64 {
+	return binary.LittleEndian.Uint64(b[i:])
+}
+
+// encodeBlock appends the encoding of src, at most maxBlockSize long, to dst.
+func (e *Encoder) encodeBlock(dst, src []byte) []byte {
+	e.table = [tableSize]uint16{}
+
+	sLimit := len(src) - inputMargin
+	nextEmit := 0
+	s := 1
+	nextHash := hash(load32(src, s))
+
+	for {
+		// Skip ahead faster the longer we go without finding a match, so
+		// incompressible input is not hashed byte by byte.
+		skip := 1 << skipShift
+		nextS := s
+		candidate := 0
+		for {
+			s = nextS
+			step := skip >> skipShift
+			nextS = s + step
+			skip += step
+			if nextS > sLimit {
+				return appendTail(dst, src, nextEmit)
+			}
+			candidate = int(e.table[nextHash])
+			e.table[nextHash] = uint16(s)
+			nextHash = hash(load32(src, nextS))
+			if load32(src, s) == load32(src, candidate) {
+				break
+			}
+		}
+
+		dst = appendLiteral(dst, src[nextEmit:s])
+
+		// Emit copies for as long as the bytes right after the previous copy
+		// match again, without going back to the literal search.
+		for {
+			base := s
+			s += minMatch
+			for i := candidate + minMatch; s < len(src) && src[i] == src[s]; i, s = i+1, s+1 {
+			}
+			dst = appendCopy(dst, base-candidate, s-base)
+			nextEmit = s
+			if s >= sLimit {
+				return appendTail(dst, src, nextEmit)
+			}
+
+			// Index the last byte of the copy and probe the one after it.
+			x := load64(src, s-1)
+			e.table[hash(uint32(x))] = uint16(s - 1)
+			cur := uint32(x >> byteBits)
+			curHash := hash(cur)
+			candidate = int(e.table[curHash])
+			e.table[curHash] = uint16(s)
+			if cur != load32(src, candidate) {
+				nextHash = hash(uint32(x >> (2 * byteBits)))
+				s++
+				break
+			}
+		}
+	}
+}
+
+func appendTail(dst, src []byte, nextEmit int) []byte {
+	if nextEmit < len(src) {
+		dst = appendLiteral(dst, src[nextEmit:])
+	}
+	return dst
+}
+
+// appendLiteral appends lit, which is never longer than maxBlockSize.
+func appendLiteral(dst, lit []byte) []byte {
+	n := len(lit) - 1
+	switch {
+	case n < literalLenShort:
+		dst = append(dst, byte(n)<<tagBits|tagLiteral)
+	case n < literalLen1Byte:
+		dst = append(dst, literalLenShort<<tagBits|tagLiteral, byte(n))
+	default:
+		dst = append(dst, (literalLenShort+1)<<tagBits|tagLiteral, byte(n), byte(n>>byteBits))
+	}
+	return append(dst, lit...)
+}
+
+func appendCopy(dst []byte, offset, length int) []byte {
+	// Long matches are split into maxCopy2Length pieces, leaving a remainder
+	// of at least minMatch so the last piece can still use tagCopy1.
+	for length >= maxCopy2Length+minMatch {
+		dst = appendCopy2(dst, offset, maxCopy2Length)
+		length -= maxCopy2Length
+	}
+	if length > maxCopy2Length {
+		dst = appendCopy2(dst, offset, maxCopy2Length-minMatch)
+		length -= maxCopy2Length - minMatch
+	}
+	if length <= maxCopy1Length && offset < maxCopy1Offset {
+		return append(dst,
+			byte(offset>>byteBits)<<copy1OffsetShift|byte(length-minMatch)<<tagBits|tagCopy1,
+			byte(offset))
+	}
+	return appendCopy2(dst, offset, length)
+}
+
+func appendCopy2(dst []byte, offset, length int) []byte {
+	return append(dst, byte(length-1)<<tagBits|tagCopy2, byte(offset), byte(offset>>byteBits))
+}
+
+// ErrCorrupt is returned by Decode for input that is not a valid block.
+var ErrCorrupt = errors.New("snappy: corrupt input")
+
+const (
+	tagMask          = 0x03
+	copy1LengthMask  = 0x07
+	copy1OffsetBytes = 1
+	copy2OffsetBytes = 2
+	literalLen2Byte  = literalLenShort + 1
+)
+
+// Decode returns the decoding of the Snappy block src.
+func Decode(src []byte) ([]byte, error) {
+	n, k := binary.Uvarint(src)
+	if k <= 0 || n > uint64(len(src))*maxBlockSize {
+		return nil, ErrCorrupt
+	}
+	src = src[k:]
+	dst := make([]byte, 0, n)
+	for len(src) > 0 {
+		tag := src[0]
+		src = src[1:]
+		switch tag & tagMask {
+		case tagLiteral:
+			length := int(tag >> tagBits)
+			switch length {
+			case literalLenShort:
+				if len(src) < 1 {
+					return nil, ErrCorrupt
+				}
+				length, src = int(src[0]), src[1:]
+			case literalLen2Byte:
+				if len(src) < 2 {
+					return nil, ErrCorrupt
+				}
+				length, src = int(binary.LittleEndian.Uint16(src)), src[2:]
+			case literalLen2Byte + 1, literalLen2Byte + 2:
+				return nil, ErrCorrupt // longer literals are never produced
+			}
+			length++
+			if len(src) < length {
+				return nil, ErrCorrupt
+			}
+			dst, src = append(dst, src[:length]...), src[length:]
+			continue
+		case tagCopy1:
+			if len(src) < copy1OffsetBytes {
+				return nil, ErrCorrupt
+			}
+			length := minMatch + int(tag>>tagBits&copy1LengthMask)
+			offset := int(tag>>copy1OffsetShift)<<byteBits | int(src[0])
+			src = src[copy1OffsetBytes:]
+			if dst = appendBackref(dst, offset, length); dst == nil {
+				return nil, ErrCorrupt
+			}
+		case tagCopy2:
+			if len(src) < copy2OffsetBytes {
+				return nil, ErrCorrupt
+			}
+			length := 1 + int(tag>>tagBits)
+			offset := int(binary.LittleEndian.Uint16(src))
+			src = src[copy2OffsetBytes:]
+			if dst = appendBackref(dst, offset, length); dst == nil {
+				return nil, ErrCorrupt
+			}
+		default:
+			return nil, ErrCorrupt // 4-byte offsets are never produced
+		}
+	}
+	if uint64(len(dst)) != n {
+		return nil, ErrCorrupt
+	}
+	return dst, nil
+}
+
+// appendBackref appends length bytes copied from offset bytes back, which
+// may overlap what it appends. It returns nil for an invalid offset.
+func appendBackref(dst []byte, offset, length int) []byte {
+	if offset <= 0 || offset > len(dst) {
+		return nil
+	}
+	for i := 0; i < length; i++ {
+		dst = append(dst, dst[len(dst)-offset])
+	}
+	return dst
+}
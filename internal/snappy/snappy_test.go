@@ -0,0 +1,103 @@
+package snappy
+
+import (
+	"bytes"
+	"math/rand"
+	"testing"
+)
+
+// Vectors built by hand from format_description.txt.
+var vectors = []struct {
+	name      string
+	decoded   string
+	encoded   string
+	canonical bool // also what Encode must produce
+}{
+	{name: "empty", decoded: "", encoded: "\x00", canonical: true},
+	{name: "one byte", decoded: "a", encoded: "\x01\x00a", canonical: true},
+	{name: "short literal", decoded: "hello", encoded: "\x05\x10hello", canonical: true},
+	// Literal "abcd", then a copy1 of length 6 at offset 4 that overlaps
+	// its own output.
+	{name: "overlapping copy1", decoded: "abcdabcdab", encoded: "\x0a\x0cabcd\x09\x04"},
+	// Literal "x", then a copy2 of length 64 at offset 1.
+	{name: "copy2 run", decoded: string(bytes.Repeat([]byte("x"), 65)), encoded: "\x41\x00x\xfe\x01\x00"},
+	// Literal with a one-byte length extension (61 bytes).
+	{
+		name:    "literal length byte",
+		decoded: string(bytes.Repeat([]byte("0123456789"), 6)) + "!",
+		encoded: "\x3d\xf0\x3c" + string(bytes.Repeat([]byte("0123456789"), 6)) + "!",
+	},
+}
+
+func TestDecodeVectors(t *testing.T) {
+	for _, v := range vectors {
+		got, err := Decode([]byte(v.encoded))
+		if err != nil {
+			t.Errorf("%s: Decode: %v", v.name, err)
+			continue
+		}
+		if string(got) != v.decoded {
+			t.Errorf("%s: Decode = %q, want %q", v.name, got, v.decoded)
+		}
+	}
+}
+
+func TestEncodeVectors(t *testing.T) {
+	var e Encoder
+	for _, v := range vectors {
+		if !v.canonical {
+			continue
+		}
+		if got := e.Encode([]byte(v.decoded)); string(got) != v.encoded {
+			t.Errorf("%s: Encode = %q, want %q", v.name, got, v.encoded)
+		}
+	}
+}
+
+func TestDecodeCorrupt(t *testing.T) {
+	for _, in := range []string{
+		"",             // no length
+		"\x05\x10hel",  // literal runs past the end
+		"\x04\x05\x00", // copy before any output
+		"\x03\x00a",    // decoded length mismatch
+	} {
+		if _, err := Decode([]byte(in)); err == nil {
+			t.Errorf("Decode(%q) succeeded", in)
+		}
+	}
+}
+
+func TestRoundTrip(t *testing.T) {
+	r := rand.New(rand.NewSource(1))
+	var e Encoder
+	for i := 0; i < 500; i++ {
+		// Mix compressible runs with noise, across block boundaries.
+		n := r.Intn(3 * maxBlockSize / 2)
+		src := make([]byte, n)
+		alphabet := 1 + r.Intn(255)
+		for j := range src {
+			src[j] = byte(r.Intn(alphabet))
+		}
+		enc := e.Encode(src)
+		if len(enc) > MaxEncodedLen(len(src)) {
+			t.Fatalf("encoded %d bytes to %d, above MaxEncodedLen", len(src), len(enc))
+		}
+		got, err := Decode(enc)
+		if err != nil {
+			t.Fatalf("round %d: %v", i, err)
+		}
+		if !bytes.Equal(got, src) {
+			t.Fatalf("round %d: round trip mismatch", i)
+		}
+	}
+}
+
+func BenchmarkEncode(b *testing.B) {
+	src := bytes.Repeat([]byte("dmetrics_cpu_usage_percent{core=\"3\"} 42.5 "), 1000)
+	var e Encoder
+	b.SetBytes(int64(len(src)))
+	b.ReportAllocs()
+	for i := 0; i < b.N; i++ {
+		e.Encode(src)
+	}
+}
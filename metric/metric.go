@@ -0,0 +1,110 @@
+// Package metric defines the sample model shared by the exporters and the
+// history store. Collectors turn their readings into Samples; everything
+// downstream of them speaks this type only.
+package metric
+
+import (
+	"hash/maphash"
+	"sort"
+)
+
+// Kind distinguishes point-in-time readings from monotonically increasing
+// totals, which exporters encode differently.
+type Kind uint8
+
+const (
+	// Gauge is a reading that may go up and down, e.g. a temperature.
+	Gauge Kind = iota
+	// Counter is a cumulative total that only resets when the source restarts,
+	// e.g. bytes received on an interface.
+	Counter
+)
+
+// String returns the lower-case name of the kind.
+func (k Kind) String() string {
+	switch k {
+	case Gauge:
+		return "gauge"
+	case Counter:
+		return "counter"
+	default:
+		return "unknown"
+	}
+}
+
+// Label is a single name/value dimension of a series.
+type Label struct {
+	Name  string
+	Value string
+}
+
+// Labels is a set of labels sorted by name. Exporters rely on the ordering,
+// so build it with NewLabels or keep it sorted by hand.
+type Labels []Label
+
+// NewLabels builds a sorted label set from alternating name/value pairs.
+// A trailing name without a value is ignored.
+func NewLabels(pairs ...string) Labels {
+	ls := make(Labels, 0, len(pairs)/2)
+	for i := 0; i+1 < len(pairs); i += 2 {
+		ls = append(ls, Label{Name: pairs[i], Value: pairs[i+1]})
+	}
+	sort.Slice(ls, func(i, j int) bool { return ls[i].Name < ls[j].Name })
+	return ls
+}
+
+// Get returns the value of the named label, or "" if it is not set.
+func (ls Labels) Get(name string) string {
+	for _, l := range ls {
+		if l.Name == name {
+			return l.Value
+		}
+	}
+	return ""
+}
+
+// Equal reports whether both sets hold the same labels.
+func (ls Labels) Equal(o Labels) bool {
+	if len(ls) != len(o) {
+		return false
+	}
+	for i := range ls {
+		if ls[i] != o[i] {
+			return false
+		}
+	}
+	return true
+}
+
+// Sample is one reading of one series.
+type Sample struct {
+	Name   string
+	Labels Labels
+	Kind   Kind
+	Value  float64
+	// Timestamp is in milliseconds since the Unix epoch.
+	Timestamp int64
+}
+
+var seed = maphash.MakeSeed()
+
+// SeriesHash returns a process-local hash identifying the series (name and
+// labels) of the sample. It is used for sharding and grouping and must not
+// be persisted.
+func (s *Sample) SeriesHash() uint64 {
+	return SeriesHash(s.Name, s.Labels)
+}
+
+// SeriesHash hashes a series identity without allocating.
+func SeriesHash(name string, ls Labels) uint64 {
+	var h maphash.Hash
+	h.SetSeed(seed)
+	_, _ = h.WriteString(name)
+	for _, l := range ls {
+		_ = h.WriteByte(0xff)
+		_, _ = h.WriteString(l.Name)
+		_ = h.WriteByte(0xfe)
+		_, _ = h.WriteString(l.Value)
+	}
+	return h.Sum64()
+}
@@ -0,0 +1,302 @@
+// Package otlp exports samples to an OpenTelemetry collector using
+// OTLP/HTTP with protobuf encoding.
+//
+// Samples go through a batch processor: a bounded queue drained by one
+// goroutine that exports whenever MaxBatchSize samples are pending or
+// BatchTimeout has passed. Counters are reported with cumulative or delta
+// temporality; gauges are reported as-is.
+package otlp
+
+import (
+	"bytes"
+	"context"
+	"errors"
+	"fmt"
+	"io"
+	"net/http"
+	"sync"
+	"sync/atomic"
+	"time"
+
+	"github.com/sm-moshi/dmetrics-go/metric"
+)
+
+// Defaults applied by New to zero Config fields.
+const (
+	DefaultMaxQueueSize = 16_384
+	DefaultMaxBatchSize = 4_096
+	DefaultBatchTimeout = 5 * time.Second
+	DefaultTimeout      = 10 * time.Second
+	DefaultMaxRetries   = 5
+	DefaultMinBackoff   = 100 * time.Millisecond
+	DefaultMaxBackoff   = 5 * time.Second
+)
+
+var (
+	// ErrNoEndpoint is returned by New when Config.Endpoint is empty.
+	ErrNoEndpoint = errors.New("otlp: no endpoint configured")
+	// ErrClosed is returned by Close when the exporter was already closed.
+	ErrClosed = errors.New("otlp: exporter closed")
+)
+
+// Config configures an Exporter. Zero fields take the Default* values.
+type Config struct {
+	// Endpoint is the full metrics URL, e.g. http://localhost:4318/v1/metrics.
+	Endpoint string
+	// Client sends the requests. Defaults to a client with DefaultTimeout.
+	Client *http.Client
+	// Headers are added to every request.
+	Headers map[string]string
+	// Resource holds the resource attributes, e.g. host.name.
+	Resource metric.Labels
+	// Temporality of counters. Defaults to Cumulative.
+	Temporality Temporality
+
+	// MaxQueueSize bounds the samples waiting to be batched. Samples
+	// exported to a full queue are dropped and counted in Stats.
+	MaxQueueSize int
+	// MaxBatchSize is the number of samples that triggers an export.
+	MaxBatchSize int
+	// BatchTimeout is how long a partial batch waits before it is exported.
+	BatchTimeout time.Duration
+
+	// MaxRetries is the number of retries for a batch that failed with a
+	// retryable status (429, 502, 503, 504) or a transport error.
+	MaxRetries int
+	// MinBackoff and MaxBackoff bound the delay between retries.
+	MinBackoff time.Duration
+	MaxBackoff time.Duration
+}
+
+func (c *Config) setDefaults() {
+	if c.Client == nil {
+		c.Client = &http.Client{Timeout: DefaultTimeout}
+	}
+	if c.Temporality != Delta {
+		c.Temporality = Cumulative
+	}
+	setDefault(&c.MaxQueueSize, DefaultMaxQueueSize)
+	setDefault(&c.MaxBatchSize, DefaultMaxBatchSize)
+	setDefault(&c.BatchTimeout, DefaultBatchTimeout)
+	setDefault(&c.MaxRetries, DefaultMaxRetries)
+	setDefault(&c.MinBackoff, DefaultMinBackoff)
+	setDefault(&c.MaxBackoff, DefaultMaxBackoff)
+}
+
+func setDefault[T int | time.Duration](v *T, def T) {
+	if *v <= 0 {
+		*v = def
+	}
+}
+
+// Stats are cumulative counters of an Exporter.
+type Stats struct {
+	// Exports is the number of successful requests.
+	Exports uint64
+	// SamplesExported were accepted by the collector. Counter samples that
+	// only set the baseline of a delta series are not counted.
+	SamplesExported uint64
+	// SamplesDropped were rejected because the queue was full.
+	SamplesDropped uint64
+	// SamplesFailed were part of batches given up after an error.
+	SamplesFailed uint64
+}
+
+// Exporter batches samples and exports them over OTLP/HTTP.
+type Exporter struct {
+	cfg   Config
+	queue chan metric.Sample
+
+	// Owned by the batch goroutine.
+	batch    []metric.Sample
+	req      *request
+	counters *counters
+
+	mu     sync.RWMutex // guards closed against concurrent Export
+	closed bool
+	cancel context.CancelFunc
+	done   chan struct{}
+
+	exports, exported, dropped, failed atomic.Uint64
+}
+
+// New starts an Exporter and its batch processor.
+func New(cfg Config) (*Exporter, error) {
+	if cfg.Endpoint == "" {
+		return nil, ErrNoEndpoint
+	}
+	cfg.setDefaults()
+
+	ctx, cancel := context.WithCancel(context.Background())
+	e := &Exporter{
+		cfg:      cfg,
+		queue:    make(chan metric.Sample, cfg.MaxQueueSize),
+		batch:    make([]metric.Sample, 0, cfg.MaxBatchSize),
+		req:      newRequest(cfg.Resource),
+		counters: newCounters(cfg.Temporality),
+		cancel:   cancel,
+		done:     make(chan struct{}),
+	}
+	go e.run(ctx)
+	return e, nil
+}
+
+// Export queues samples and returns how many were dropped because the queue
+// was full. It never blocks. The samples' label slices must not be modified
+// afterwards.
+func (e *Exporter) Export(samples ...metric.Sample) int {
+	e.mu.RLock()
+	defer e.mu.RUnlock()
+	if e.closed {
+		e.dropped.Add(uint64(len(samples)))
+		return len(samples)
+	}
+	dropped := 0
+	for i := range samples {
+		select {
+		case e.queue <- samples[i]:
+		default:
+			dropped++
+		}
+	}
+	e.dropped.Add(uint64(dropped))
+	return dropped
+}
+
+// Close stops accepting samples and exports what is queued. If ctx ends
+// first, the in-flight export is aborted and the remaining samples are lost.
+func (e *Exporter) Close(ctx context.Context) error {
+	e.mu.Lock()
+	if e.closed {
+		e.mu.Unlock()
+		return ErrClosed
+	}
+	e.closed = true
+	close(e.queue)
+	e.mu.Unlock()
+
+	select {
+	case <-e.done:
+		e.cancel()
+		return nil
+	case <-ctx.Done():
+		e.cancel()
+		<-e.done
+		return ctx.Err()
+	}
+}
+
+// Stats returns a snapshot of the exporter's counters.
+func (e *Exporter) Stats() Stats {
+	return Stats{
+		Exports:         e.exports.Load(),
+		SamplesExported: e.exported.Load(),
+		SamplesDropped:  e.dropped.Load(),
+		SamplesFailed:   e.failed.Load(),
+	}
+}
+
+func (e *Exporter) run(ctx context.Context) {
+	defer close(e.done)
+	ticker := time.NewTicker(e.cfg.BatchTimeout)
+	defer ticker.Stop()
+
+	for {
+		select {
+		case s, ok := <-e.queue:
+			if !ok {
+				e.flush(ctx)
+				return
+			}
+			e.batch = append(e.batch, s)
+			if len(e.batch) >= e.cfg.MaxBatchSize {
+				e.flush(ctx)
+				ticker.Reset(e.cfg.BatchTimeout)
+			}
+		case <-ticker.C:
+			e.flush(ctx)
+		}
+	}
+}
+
+func (e *Exporter) flush(ctx context.Context) {
+	if len(e.batch) == 0 {
+		return
+	}
+	points := e.req.points[:0]
+	for i := range e.batch {
+		points = e.counters.convert(points, &e.batch[i])
+	}
+	e.req.points = points
+
+	delivered := true
+	if len(points) > 0 {
+		n := uint64(len(points))
+		if err := e.sendWithRetry(ctx, e.req.encode(e.cfg.Temporality)); err != nil {
+			e.failed.Add(n)
+			delivered = false
+		} else {
+			e.exports.Add(1)
+			e.exported.Add(n)
+		}
+	}
+	e.counters.endExport(delivered)
+	// Drop references to the samples before the buffers are refilled.
+	clear(e.req.points)
+	clear(e.batch)
+	e.batch = e.batch[:0]
+}
+
+// retryableError marks failures the OTLP specification allows retrying.
+type retryableError struct{ err error }
+
+func (e retryableError) Error() string { return e.err.Error() }
+func (e retryableError) Unwrap() error { return e.err }
+
+func (e *Exporter) sendWithRetry(ctx context.Context, body []byte) error {
+	backoff := e.cfg.MinBackoff
+	for attempt := 0; ; attempt++ {
+		err := e.send(ctx, body)
+		var rerr retryableError
+		if err == nil || !errors.As(err, &rerr) || attempt >= e.cfg.MaxRetries {
+			return err
+		}
+		select {
+		case <-time.After(backoff):
+		case <-ctx.Done():
+			return ctx.Err()
+		}
+		backoff = min(2*backoff, e.cfg.MaxBackoff)
+	}
+}
+
+func (e *Exporter) send(ctx context.Context, body []byte) error {
+	req, err := http.NewRequestWithContext(ctx, http.MethodPost, e.cfg.Endpoint, bytes.NewReader(body))
+	if err != nil {
+		return err
+	}
+	req.Header.Set("Content-Type", "application/x-protobuf")
+	for k, v := range e.cfg.Headers {
+		req.Header.Set(k, v)
+	}
+
+	resp, err := e.cfg.Client.Do(req)
+	if err != nil {
+		if ctx.Err() != nil {
+			return err
+		}
+		return retryableError{err}
+	}
+	defer resp.Body.Close()
+	_, _ = io.Copy(io.Discard, resp.Body)
+
+	switch resp.StatusCode {
+	case http.StatusOK, http.StatusAccepted, http.StatusNoContent:
+		return nil
+	case http.StatusTooManyRequests, http.StatusBadGateway,
+		http.StatusServiceUnavailable, http.StatusGatewayTimeout:
+		return retryableError{fmt.Errorf("otlp: collector returned HTTP status %s", resp.Status)}
+	default:
+		return fmt.Errorf("otlp: collector returned HTTP status %s", resp.Status)
+	}
+}
@@ -0,0 +1,354 @@
+package otlp
+
+import (
+	"context"
+	"io"
+	"math"
+	"net/http"
+	"net/http/httptest"
+	"runtime"
+	"strconv"
+	"sync"
+	"testing"
+	"time"
+
+	"github.com/sm-moshi/dmetrics-go/internal/protowire"
+	"github.com/sm-moshi/dmetrics-go/metric"
+)
+
+// gotPoint is a data point as decoded by the test collector.
+type gotPoint struct {
+	metric      string
+	sum         bool
+	temporality uint64
+	monotonic   uint64
+	start, time uint64
+	value       float64
+	attrs       string
+}
+
+// collector is an in-process OTLP/HTTP receiver. It decodes every field
+// it is sent and fails the test on any field number or wire type the
+// exporter should not produce.
+type collector struct {
+	t        testing.TB
+	mu       sync.Mutex
+	resource []string
+	points   []gotPoint
+	// reject answers the request with this 1-based number with a
+	// non-retryable 400.
+	reject   int
+	requests int
+}
+
+func (c *collector) ServeHTTP(w http.ResponseWriter, r *http.Request) {
+	if ct := r.Header.Get("Content-Type"); ct != "application/x-protobuf" {
+		c.t.Errorf("Content-Type %q", ct)
+	}
+	body, err := io.ReadAll(r.Body)
+	if err != nil {
+		c.t.Error(err)
+		return
+	}
+	c.mu.Lock()
+	defer c.mu.Unlock()
+	if c.requests++; c.requests == c.reject {
+		w.WriteHeader(http.StatusBadRequest)
+		return
+	}
+	c.each(body, map[int]int{fieldRequestResourceMetrics: protowire.TypeBytes}, func(f protowire.Field) {
+		c.resourceMetrics(f.Bytes)
+	})
+}
+
+// each decodes the fields of msg, checking each against want (field
+// number to wire type), and calls fn for every one.
+func (c *collector) each(msg []byte, want map[int]int, fn func(protowire.Field)) {
+	for len(msg) > 0 {
+		f, rest, err := protowire.ConsumeField(msg)
+		if err != nil {
+			c.t.Fatal(err)
+		}
+		if typ, ok := want[f.Num]; !ok || typ != f.Type {
+			c.t.Fatalf("unexpected field %d of wire type %d", f.Num, f.Type)
+		}
+		msg = rest
+		fn(f)
+	}
+}
+
+func (c *collector) resourceMetrics(msg []byte) {
+	c.each(msg, map[int]int{fieldResourceMetricsResource: protowire.TypeBytes, fieldResourceMetricsScope: protowire.TypeBytes}, func(f protowire.Field) {
+		if f.Num == fieldResourceMetricsResource {
+			c.each(f.Bytes, map[int]int{fieldResourceAttributes: protowire.TypeBytes}, func(a protowire.Field) {
+				c.resource = append(c.resource, c.keyValue(a.Bytes))
+			})
+			return
+		}
+		c.each(f.Bytes, map[int]int{fieldScopeMetricsScope: protowire.TypeBytes, fieldScopeMetricsMetrics: protowire.TypeBytes}, func(m protowire.Field) {
+			if m.Num == fieldScopeMetricsMetrics {
+				c.metric(m.Bytes)
+			}
+		})
+	})
+}
+
+func (c *collector) metric(msg []byte) {
+	var name string
+	c.each(msg, map[int]int{fieldMetricName: protowire.TypeBytes, fieldMetricGauge: protowire.TypeBytes, fieldMetricSum: protowire.TypeBytes}, func(f protowire.Field) {
+		if f.Num == fieldMetricName {
+			name = string(f.Bytes)
+			return
+		}
+		first := len(c.points)
+		var temporality, monotonic uint64
+		c.each(f.Bytes, map[int]int{fieldDataPoints: protowire.TypeBytes, fieldSumTemporality: protowire.TypeVarint, fieldSumMonotonic: protowire.TypeVarint}, func(d protowire.Field) {
+			switch d.Num {
+			case fieldSumTemporality:
+				temporality = d.Value
+			case fieldSumMonotonic:
+				monotonic = d.Value
+			default:
+				c.points = append(c.points, c.point(d.Bytes, name, f.Num == fieldMetricSum))
+			}
+		})
+		for i := first; i < len(c.points); i++ {
+			c.points[i].temporality, c.points[i].monotonic = temporality, monotonic
+		}
+	})
+}
+
+func (c *collector) point(msg []byte, name string, sum bool) gotPoint {
+	p := gotPoint{metric: name, sum: sum}
+	c.each(msg, map[int]int{
+		fieldPointStartTime: protowire.TypeFixed64, fieldPointTime: protowire.TypeFixed64,
+		fieldPointAsDouble: protowire.TypeFixed64, fieldPointAttributes: protowire.TypeBytes,
+	}, func(f protowire.Field) {
+		switch f.Num {
+		case fieldPointStartTime:
+			p.start = f.Value
+		case fieldPointTime:
+			p.time = f.Value
+		case fieldPointAsDouble:
+			p.value = math.Float64frombits(f.Value)
+		default:
+			p.attrs += c.keyValue(f.Bytes) + ","
+		}
+	})
+	return p
+}
+
+func (c *collector) keyValue(msg []byte) string {
+	var key, value string
+	c.each(msg, map[int]int{fieldKeyValueKey: protowire.TypeBytes, fieldKeyValueValue: protowire.TypeBytes}, func(f protowire.Field) {
+		if f.Num == fieldKeyValueKey {
+			key = string(f.Bytes)
+			return
+		}
+		c.each(f.Bytes, map[int]int{fieldAnyValueStr: protowire.TypeBytes}, func(v protowire.Field) {
+			value = string(v.Bytes)
+		})
+	})
+	return key + "=" + value
+}
+
+// export sends each group of samples as its own batch and returns what the
+// collector received.
+func export(t *testing.T, cfg Config, groups ...[]metric.Sample) (*collector, Stats) {
+	t.Helper()
+	return exportTo(t, &collector{t: t}, cfg, groups...)
+}
+
+func exportTo(t *testing.T, c *collector, cfg Config, groups ...[]metric.Sample) (*collector, Stats) {
+	t.Helper()
+	srv := httptest.NewServer(c)
+	defer srv.Close()
+	cfg.Endpoint = srv.URL
+	cfg.MaxBatchSize = len(groups[0])
+	e, err := New(cfg)
+	if err != nil {
+		t.Fatal(err)
+	}
+	for _, g := range groups {
+		e.Export(g...)
+	}
+	if err := e.Close(context.Background()); err != nil {
+		t.Fatal(err)
+	}
+	return c, e.Stats()
+}
+
+const ms = uint64(time.Millisecond)
+
+func counterSeries(values ...float64) [][]metric.Sample {
+	var groups [][]metric.Sample
+	for i, v := range values {
+		groups = append(groups, []metric.Sample{{
+			Name: "rx_bytes", Kind: metric.Counter, Value: v,
+			Labels: metric.NewLabels("if", "en0"), Timestamp: int64(1000 * (i + 1)),
+		}})
+	}
+	return groups
+}
+
+func TestCumulative(t *testing.T) {
+	c, st := export(t, Config{Resource: metric.NewLabels("host.name", "a")}, counterSeries(10, 15, 12, 20)...)
+	if len(c.resource) == 0 || c.resource[0] != "host.name=a" {
+		t.Fatalf("resource %v", c.resource)
+	}
+	// 12 after 15 is a restart, which starts the series again.
+	want := []gotPoint{
+		{value: 10, start: 1000 * ms, time: 1000 * ms},
+		{value: 15, start: 1000 * ms, time: 2000 * ms},
+		{value: 12, start: 2000 * ms, time: 3000 * ms},
+		{value: 20, start: 2000 * ms, time: 4000 * ms},
+	}
+	checkPoints(t, c.points, want, uint64(Cumulative))
+	if st.SamplesExported != 4 || st.Exports != 4 {
+		t.Fatalf("stats %+v", st)
+	}
+}
+
+func TestDelta(t *testing.T) {
+	c, st := export(t, Config{Temporality: Delta}, counterSeries(10, 15, 12, 20)...)
+	// The first total only sets the baseline.
+	want := []gotPoint{
+		{value: 5, start: 1000 * ms, time: 2000 * ms},
+		{value: 12, start: 2000 * ms, time: 3000 * ms},
+		{value: 8, start: 3000 * ms, time: 4000 * ms},
+	}
+	checkPoints(t, c.points, want, uint64(Delta))
+	if st.SamplesExported != 3 {
+		t.Fatalf("stats %+v", st)
+	}
+}
+
+func TestDeltaSurvivesFailedExport(t *testing.T) {
+	// The first total is the baseline and sends nothing, so the export of
+	// 20 is the second request; its rejection must not lose 15 to 20.
+	c, st := exportTo(t, &collector{t: t, reject: 2}, Config{Temporality: Delta}, counterSeries(10, 15, 20, 26)...)
+	want := []gotPoint{
+		{value: 5, start: 1000 * ms, time: 2000 * ms},
+		{value: 11, start: 2000 * ms, time: 4000 * ms},
+	}
+	checkPoints(t, c.points, want, uint64(Delta))
+	if st.SamplesFailed != 1 || st.SamplesExported != 2 {
+		t.Fatalf("stats %+v", st)
+	}
+}
+
+func checkPoints(t *testing.T, got, want []gotPoint, temporality uint64) {
+	t.Helper()
+	if len(got) != len(want) {
+		t.Fatalf("got %d points, want %d: %+v", len(got), len(want), got)
+	}
+	for i, p := range got {
+		w := want[i]
+		if !p.sum || p.metric != "rx_bytes" || p.temporality != temporality || p.monotonic != 1 || p.attrs != "if=en0," {
+			t.Fatalf("point %d: %+v", i, p)
+		}
+		if p.value != w.value || p.start != w.start || p.time != w.time {
+			t.Fatalf("point %d = %v@%d from %d, want %v@%d from %d", i, p.value, p.time, p.start, w.value, w.time, w.start)
+		}
+	}
+}
+
+func TestGauges(t *testing.T) {
+	c, _ := export(t, Config{}, []metric.Sample{
+		{Name: "temp", Value: 41.5, Timestamp: 5, Labels: metric.NewLabels("sensor", "cpu")},
+		{Name: "temp", Value: 39, Timestamp: 5, Labels: metric.NewLabels("sensor", "gpu")},
+		{Name: "load", Value: 1.25, Timestamp: 5},
+	})
+	if len(c.points) != 3 {
+		t.Fatalf("points %+v", c.points)
+	}
+	for _, p := range c.points {
+		if p.sum || p.start != 0 || p.time != 5*ms || p.temporality != 0 {
+			t.Fatalf("gauge point %+v", p)
+		}
+	}
+	// Points of one metric share a Metric message, in export order.
+	if c.points[0].attrs != "sensor=cpu," || c.points[1].attrs != "sensor=gpu," || c.points[2].metric != "load" {
+		t.Fatalf("points %+v", c.points)
+	}
+}
+
+func TestStaleSeriesEvicted(t *testing.T) {
+	cs := newCounters(Delta)
+	s := metric.Sample{Name: "c", Kind: metric.Counter, Value: 1}
+	cs.convert(nil, &s)
+	for i := 0; i < staleExports; i++ {
+		cs.endExport(true)
+	}
+	if len(cs.series) != 1 {
+		t.Fatal("series evicted too early")
+	}
+	for i := 0; i < staleExports; i++ {
+		cs.endExport(true)
+	}
+	if len(cs.series) != 0 {
+		t.Fatalf("%d series kept after %d idle exports", len(cs.series), 2*staleExports)
+	}
+	// Coming back, it is a new series whose first total is a baseline.
+	s.Value = 50
+	if pts := cs.convert(nil, &s); len(pts) != 0 {
+		t.Fatalf("points %+v", pts)
+	}
+}
+
+func TestRetriesUnavailable(t *testing.T) {
+	var calls int
+	srv := httptest.NewServer(http.HandlerFunc(func(w http.ResponseWriter, _ *http.Request) {
+		calls++
+		if calls < 3 {
+			w.WriteHeader(http.StatusServiceUnavailable)
+		}
+	}))
+	defer srv.Close()
+	e, err := New(Config{Endpoint: srv.URL, MinBackoff: time.Millisecond, MaxBatchSize: 1})
+	if err != nil {
+		t.Fatal(err)
+	}
+	e.Export(metric.Sample{Name: "g", Value: 1})
+	if err := e.Close(context.Background()); err != nil {
+		t.Fatal(err)
+	}
+	if st := e.Stats(); calls != 3 || st.Exports != 1 || st.SamplesFailed != 0 {
+		t.Fatalf("%d calls, stats %+v", calls, st)
+	}
+}
+
+func BenchmarkExport(b *testing.B) {
+	srv := httptest.NewServer(http.HandlerFunc(func(w http.ResponseWriter, r *http.Request) {
+		_, _ = io.Copy(io.Discard, r.Body)
+	}))
+	defer srv.Close()
+	samples := make([]metric.Sample, 0, 4096)
+	for i := 0; i < cap(samples); i++ {
+		samples = append(samples, metric.Sample{
+			Name: "dmetrics_net_bytes_total", Kind: metric.Counter, Value: float64(i),
+			Labels: metric.NewLabels("if", "en"+strconv.Itoa(i%64), "dir", "rx"), Timestamp: int64(i),
+		})
+	}
+	e, err := New(Config{Endpoint: srv.URL, MaxBatchSize: len(samples), MaxQueueSize: len(samples)})
+	if err != nil {
+		b.Fatal(err)
+	}
+	b.ReportAllocs()
+	b.ResetTimer()
+	start := time.Now()
+	for i := 0; i < b.N; i++ {
+		if e.Export(samples...) != 0 {
+			b.Fatal("dropped")
+		}
+		// Export never blocks, so wait for the batch to be sent rather
+		// than measure how fast the queue fills.
+		for e.Stats().SamplesExported < uint64((i+1)*len(samples)) {
+			runtime.Gosched()
+		}
+	}
+	if err := e.Close(context.Background()); err != nil {
+		b.Fatal(err)
+	}
+	b.ReportMetric(float64(b.N*len(samples))/time.Since(start).Seconds(), "samples/s")
+}
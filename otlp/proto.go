@@ -0,0 +1,164 @@
+package otlp
+
+import (
+	"github.com/sm-moshi/dmetrics-go/internal/protowire"
+	"github.com/sm-moshi/dmetrics-go/metric"
+)
+
+// Field numbers from opentelemetry-proto (collector/metrics/v1,
+// metrics/v1, resource/v1, common/v1).
+const (
+	fieldRequestResourceMetrics = 1
+
+	fieldResourceMetricsResource = 1
+	fieldResourceMetricsScope    = 2
+	fieldResourceAttributes      = 1
+
+	fieldScopeMetricsScope   = 1
+	fieldScopeMetricsMetrics = 2
+	fieldScopeName           = 1
+
+	fieldMetricName  = 1
+	fieldMetricGauge = 5
+	fieldMetricSum   = 7
+
+	fieldDataPoints     = 1
+	fieldSumTemporality = 2
+	fieldSumMonotonic   = 3
+
+	fieldPointStartTime  = 2
+	fieldPointTime       = 3
+	fieldPointAsDouble   = 4
+	fieldPointAttributes = 7
+
+	fieldKeyValueKey   = 1
+	fieldKeyValueValue = 2
+	fieldAnyValueStr   = 1
+
+	scopeName   = "github.com/sm-moshi/dmetrics-go"
+	nanosPerMil = 1_000_000
+)
+
+// point is a sample after temporality conversion.
+type point struct {
+	sample *metric.Sample
+	value  float64
+	start  int64 // start_time_unix_nano, 0 for gauges
+}
+
+// request encodes batches into an ExportMetricsServiceRequest. Its buffers
+// play the role of reusable message objects: they keep their capacity
+// between exports, so a steady-state export does not allocate.
+type request struct {
+	buf      []byte
+	resource metric.Labels
+
+	points []point
+	index  map[metricKey]int32
+	heads  []int32 // per metric: first point
+	next   []int32 // per point: next point of the same metric, or -1
+	tails  []int32 // per metric: last point
+}
+
+type metricKey struct {
+	name string
+	kind metric.Kind
+}
+
+func newRequest(resource metric.Labels) *request {
+	return &request{resource: resource, index: make(map[metricKey]int32)}
+}
+
+// encode returns the marshalled request for r.points. The slice is only
+// valid until the next call.
+func (r *request) encode(temporality Temporality) []byte {
+	r.group()
+
+	b, rm := protowire.StartMessage(r.buf[:0], fieldRequestResourceMetrics)
+	if len(r.resource) > 0 {
+		var res int
+		b, res = protowire.StartMessage(b, fieldResourceMetricsResource)
+		for _, l := range r.resource {
+			b = appendKeyValue(b, fieldResourceAttributes, l)
+		}
+		b = protowire.EndMessage(b, res)
+	}
+
+	b, sm := protowire.StartMessage(b, fieldResourceMetricsScope)
+	b = protowire.AppendMessageHeader(b, fieldScopeMetricsScope, protowire.BytesFieldSize(fieldScopeName, len(scopeName)))
+	b = protowire.AppendBytesField(b, fieldScopeName, scopeName)
+	for _, head := range r.heads {
+		b = r.appendMetric(b, head, temporality)
+	}
+	b = protowire.EndMessage(b, sm)
+	b = protowire.EndMessage(b, rm)
+
+	r.buf = b
+	return b
+}
+
+// group links the points of every metric name into a list, in order.
+func (r *request) group() {
+	clear(r.index)
+	r.heads = r.heads[:0]
+	r.tails = r.tails[:0]
+	r.next = r.next[:0]
+	for i := range r.points {
+		s := r.points[i].sample
+		k := metricKey{s.Name, s.Kind}
+		r.next = append(r.next, -1)
+		if m, ok := r.index[k]; ok {
+			r.next[r.tails[m]] = int32(i)
+			r.tails[m] = int32(i)
+			continue
+		}
+		r.index[k] = int32(len(r.heads))
+		r.heads = append(r.heads, int32(i))
+		r.tails = append(r.tails, int32(i))
+	}
+}
+
+func (r *request) appendMetric(b []byte, head int32, temporality Temporality) []byte {
+	first := r.points[head].sample
+	b, m := protowire.StartMessage(b, fieldScopeMetricsMetrics)
+	b = protowire.AppendBytesField(b, fieldMetricName, first.Name)
+
+	var data int
+	if first.Kind == metric.Counter {
+		b, data = protowire.StartMessage(b, fieldMetricSum)
+	} else {
+		b, data = protowire.StartMessage(b, fieldMetricGauge)
+	}
+	for i := head; i >= 0; i = r.next[i] {
+		b = appendPoint(b, &r.points[i])
+	}
+	if first.Kind == metric.Counter {
+		b = protowire.AppendVarintField(b, fieldSumTemporality, uint64(temporality))
+		b = protowire.AppendVarintField(b, fieldSumMonotonic, 1)
+	}
+	b = protowire.EndMessage(b, data)
+	return protowire.EndMessage(b, m)
+}
+
+func appendPoint(b []byte, p *point) []byte {
+	b, dp := protowire.StartMessage(b, fieldDataPoints)
+	if p.start != 0 {
+		b = protowire.AppendFixed64Field(b, fieldPointStartTime, uint64(p.start))
+	}
+	b = protowire.AppendFixed64Field(b, fieldPointTime, uint64(p.sample.Timestamp*nanosPerMil))
+	b = protowire.AppendDoubleField(b, fieldPointAsDouble, p.value)
+	for _, l := range p.sample.Labels {
+		b = appendKeyValue(b, fieldPointAttributes, l)
+	}
+	return protowire.EndMessage(b, dp)
+}
+
+func appendKeyValue(b []byte, num int, l metric.Label) []byte {
+	valueSize := protowire.BytesFieldSize(fieldAnyValueStr, len(l.Value))
+	size := protowire.BytesFieldSize(fieldKeyValueKey, len(l.Name)) +
+		protowire.BytesFieldSize(fieldKeyValueValue, valueSize)
+	b = protowire.AppendMessageHeader(b, num, size)
+	b = protowire.AppendBytesField(b, fieldKeyValueKey, l.Name)
+	b = protowire.AppendMessageHeader(b, fieldKeyValueValue, valueSize)
+	return protowire.AppendBytesField(b, fieldAnyValueStr, l.Value)
+}
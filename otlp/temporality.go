@@ -0,0 +1,122 @@
+package otlp
+
+import "github.com/sm-moshi/dmetrics-go/metric"
+
+// Temporality selects how counters are reported. The values match
+// AggregationTemporality in the OTLP protocol.
+type Temporality uint8
+
+const (
+	// Cumulative reports counters as totals since a fixed start time.
+	Cumulative Temporality = 2
+	// Delta reports counters as the increase since the previous export.
+	Delta Temporality = 1
+)
+
+// staleExports is the number of exports a counter series may go unseen
+// before its state is forgotten.
+const staleExports = 10
+
+// counterPos is where a counter series stands: its start time and its last
+// total.
+type counterPos struct {
+	start int64 // ns
+	last  float64
+	lastT int64 // ns
+}
+
+type counterState struct {
+	// cur is the position as of the last delivered export; next is the
+	// position after the points of the export in progress, and only
+	// becomes cur once they are delivered, so a failed export's delta is
+	// carried into the next one instead of being lost.
+	cur, next counterPos
+	pending   bool
+	epoch     uint64
+}
+
+// counters converts cumulative metric.Counter samples into OTLP points of
+// the configured temporality. Gauges pass through unchanged.
+type counters struct {
+	temporality Temporality
+	series      map[uint64]*counterState
+	pending     []*counterState
+	epoch       uint64
+}
+
+func newCounters(t Temporality) *counters {
+	return &counters{temporality: t, series: make(map[uint64]*counterState)}
+}
+
+// convert appends the point for s to points. The first sample of a series
+// only establishes its baseline when reporting deltas.
+func (c *counters) convert(points []point, s *metric.Sample) []point {
+	if s.Kind != metric.Counter {
+		return append(points, point{sample: s, value: s.Value})
+	}
+
+	now := s.Timestamp * nanosPerMil
+	h := s.SeriesHash()
+	st, ok := c.series[h]
+	if !ok {
+		// The baseline sends nothing in delta mode, and a cumulative point
+		// carries its own total, so a new series' position needs no
+		// delivery to be committed.
+		pos := counterPos{start: now, last: s.Value, lastT: now}
+		c.series[h] = &counterState{cur: pos, next: pos, epoch: c.epoch}
+		if c.temporality == Delta {
+			return points
+		}
+		return append(points, point{sample: s, value: s.Value, start: now})
+	}
+
+	pos := st.cur
+	if st.pending {
+		pos = st.next
+	} else {
+		st.pending = true
+		c.pending = append(c.pending, st)
+	}
+	p := point{sample: s}
+	reset := s.Value < pos.last
+	switch {
+	case c.temporality == Cumulative && reset:
+		// The source restarted, so does the series.
+		pos.start = pos.lastT
+		p.value, p.start = s.Value, pos.start
+	case c.temporality == Cumulative:
+		p.value, p.start = s.Value, pos.start
+	case reset:
+		p.value, p.start = s.Value, pos.lastT
+	default:
+		p.value, p.start = s.Value-pos.last, pos.lastT
+	}
+	pos.last, pos.lastT = s.Value, now
+	st.next, st.epoch = pos, c.epoch
+	return append(points, p)
+}
+
+// endExport commits the positions of this export's points if they were
+// delivered and rolls them back otherwise. It then forgets series that
+// have not been seen for staleExports exports, so churning series (e.g.
+// short-lived processes) do not pile up.
+func (c *counters) endExport(delivered bool) {
+	for _, st := range c.pending {
+		if delivered {
+			st.cur = st.next
+		}
+		st.pending = false
+	}
+	clear(c.pending)
+	c.pending = c.pending[:0]
+
+	c.epoch++
+	if c.epoch%staleExports != 0 {
+		return
+	}
+	for h, st := range c.series {
+		if c.epoch-st.epoch > staleExports {
+			delete(c.series, h)
+		}
+	}
+}
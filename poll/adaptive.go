@@ -0,0 +1,132 @@
+// Package poll runs collectors on a schedule. Each collector can poll
+// adaptively: while its readings stay within a threshold of the previous
+// ones its interval stretches step by step up to a maximum, and the first
+// reading that moves snaps it back to the base rate. Idle hosts are then
+// polled rarely, and activity restores full resolution on the next poll.
+package poll
+
+import (
+	"math"
+	"time"
+
+	"github.com/sm-moshi/dmetrics-go/metric"
+)
+
+// Defaults of Adaptive.
+const (
+	DefaultBase      = time.Second
+	DefaultThreshold = 0.01
+	DefaultBackoff   = 2
+)
+
+// Adaptive decides a collector's next interval from its readings.
+type Adaptive struct {
+	// Base is the interval while readings change. Defaults to
+	// DefaultBase.
+	Base time.Duration
+	// Max is the longest interval while readings are stable. Zero or
+	// anything below Base disables adaptation: the interval stays at Base.
+	Max time.Duration
+	// Threshold is the relative change, 0.01 being 1%, below which a
+	// reading counts as unchanged. Gauges are compared by value and
+	// counters by rate. Defaults to DefaultThreshold.
+	Threshold float64
+	// Backoff multiplies the interval after each stable poll. Defaults to
+	// DefaultBackoff.
+	Backoff float64
+
+	interval time.Duration
+	prev     []point
+}
+
+type point struct {
+	hash  uint64
+	value float64
+	t     int64
+	rate  float64
+	rated bool
+}
+
+func (a *Adaptive) setDefaults() {
+	if a.Base <= 0 {
+		a.Base = DefaultBase
+	}
+	if a.Threshold <= 0 {
+		a.Threshold = DefaultThreshold
+	}
+	if a.Backoff <= 1 {
+		a.Backoff = DefaultBackoff
+	}
+}
+
+// Interval returns the current interval.
+func (a *Adaptive) Interval() time.Duration {
+	a.setDefaults()
+	if a.interval == 0 {
+		a.interval = a.Base
+	}
+	return a.interval
+}
+
+// Observe records a poll's samples and returns the interval until the next
+// poll. A change in the set of series counts as a change.
+func (a *Adaptive) Observe(samples []metric.Sample) time.Duration {
+	iv := a.Interval()
+	changed := a.compare(samples)
+	switch {
+	case a.Max < a.Base:
+		a.interval = a.Base
+	case changed:
+		a.interval = a.Base
+	default:
+		a.interval = min(time.Duration(float64(iv)*a.Backoff), a.Max)
+	}
+	return a.interval
+}
+
+// compare updates the previous readings with samples and reports whether
+// any moved by more than the threshold.
+func (a *Adaptive) compare(samples []metric.Sample) bool {
+	changed := len(samples) != len(a.prev)
+	if changed {
+		a.prev = append(a.prev[:0], make([]point, len(samples))...)
+	}
+	for i := range samples {
+		s := &samples[i]
+		h := s.SeriesHash()
+		p := &a.prev[i]
+		cur := point{hash: h, value: s.Value, t: s.Timestamp}
+		switch {
+		case p.hash != h:
+			changed = true
+		case s.Kind == metric.Counter:
+			dt := float64(s.Timestamp-p.t) / float64(time.Second/time.Millisecond)
+			if s.Value < p.value || dt <= 0 {
+				changed = true // reset or clock step
+				break
+			}
+			cur.rate, cur.rated = (s.Value-p.value)/dt, true
+			if p.rated && moved(p.rate, cur.rate, a.Threshold) {
+				changed = true
+			}
+		default:
+			if moved(p.value, s.Value, a.Threshold) {
+				changed = true
+			}
+		}
+		*p = cur
+	}
+	return changed
+}
+
+// moved reports whether b differs from a by more than threshold relative
+// to the larger of the two. Equal infinities and two NaNs, such as a
+// sensor that stays unreadable, count as unchanged; a NaN next to a
+// number counts as a change.
+func moved(a, b, threshold float64) bool {
+	if a == b || math.IsNaN(a) && math.IsNaN(b) {
+		return false
+	}
+	d := math.Abs(a - b)
+	return d > threshold*math.Max(math.Abs(a), math.Abs(b)) || math.IsInf(d, 0) || math.IsNaN(d)
+}
@@ -0,0 +1,133 @@
+package poll
+
+import (
+	"math"
+	"testing"
+	"time"
+
+	"github.com/sm-moshi/dmetrics-go/metric"
+)
+
+func gauge(name string, v float64, ts int64) metric.Sample {
+	return metric.Sample{Name: name, Kind: metric.Gauge, Value: v, Timestamp: ts}
+}
+
+func counter(name string, v float64, ts int64) metric.Sample {
+	return metric.Sample{Name: name, Kind: metric.Counter, Value: v, Timestamp: ts}
+}
+
+func TestBackoffAndSnapBack(t *testing.T) {
+	a := Adaptive{Base: time.Second, Max: 5 * time.Second}
+	if iv := a.Interval(); iv != time.Second {
+		t.Fatalf("initial interval %v", iv)
+	}
+	stable := []metric.Sample{gauge("g", 100, 0)}
+	// The first poll sets the series, which counts as a change.
+	for i, want := range []time.Duration{1, 2, 4, 5, 5} {
+		if iv := a.Observe(stable); iv != want*time.Second {
+			t.Fatalf("poll %d: %v, want %vs", i, iv, int(want))
+		}
+	}
+	if iv := a.Observe([]metric.Sample{gauge("g", 100.5, 0)}); iv != 5*time.Second {
+		t.Fatalf("a move within the threshold reset the interval to %v", iv)
+	}
+	if iv := a.Observe([]metric.Sample{gauge("g", 110, 0)}); iv != time.Second {
+		t.Fatalf("a move past the threshold left the interval at %v", iv)
+	}
+}
+
+func TestMaxBelowBaseDisablesAdaptation(t *testing.T) {
+	for _, maxIv := range []time.Duration{0, time.Second / 2} {
+		a := Adaptive{Base: time.Second, Max: maxIv}
+		for i := 0; i < 4; i++ {
+			if iv := a.Observe([]metric.Sample{gauge("g", 1, 0)}); iv != time.Second {
+				t.Fatalf("Max %v, poll %d: %v", maxIv, i, iv)
+			}
+		}
+	}
+}
+
+func TestCounterComparedByRate(t *testing.T) {
+	a := Adaptive{Base: time.Second, Max: time.Hour}
+	observe := func(v float64, ts int64) bool {
+		before := a.Interval()
+		return a.Observe([]metric.Sample{counter("c", v, ts)}) <= before
+	}
+	for i, c := range []struct {
+		v       float64
+		ts      int64
+		changed bool
+	}{
+		{0, 0, true},        // new series
+		{100, 1000, false},  // first rate, 100/s
+		{200, 2000, false},  // same rate although the value moved
+		{300, 3000, false},  // still 100/s
+		{600, 4000, true},   // 300/s
+		{900, 5000, false},  // 300/s again
+		{10, 6000, true},    // reset
+		{310, 7000, false},  // rate after the reset is the new baseline
+		{610, 7000, true},   // dt == 0
+		{910, 6000, true},   // clock stepped back
+		{1210, 7000, false}, // a new baseline rate after the steps
+		{1510, 8000, false}, // unchanged
+		{1813, 9000, false}, // 1% is within the threshold
+		{2200, 10000, true}, // 387/s
+	} {
+		if got := observe(c.v, c.ts); got != c.changed {
+			t.Fatalf("poll %d (%v at %d): changed %v, want %v", i, c.v, c.ts, got, c.changed)
+		}
+	}
+}
+
+func TestSeriesSetChange(t *testing.T) {
+	a := Adaptive{Base: time.Second, Max: time.Hour}
+	two := []metric.Sample{gauge("a", 1, 0), gauge("b", 2, 0)}
+	a.Observe(two)
+	if iv := a.Observe(two); iv != 2*time.Second {
+		t.Fatalf("stable poll: %v", iv)
+	}
+	for name, samples := range map[string][]metric.Sample{
+		"added":   {gauge("a", 1, 0), gauge("b", 2, 0), gauge("c", 3, 0)},
+		"removed": {gauge("a", 1, 0)},
+		"renamed": {gauge("a", 1, 0), gauge("x", 2, 0)},
+		"labels":  {gauge("a", 1, 0), {Name: "b", Labels: metric.Labels{{Name: "k", Value: "v"}}, Value: 2}},
+	} {
+		a.Observe(two)
+		a.Observe(two)
+		if iv := a.Observe(samples); iv != time.Second {
+			t.Errorf("%s: %v", name, iv)
+		}
+	}
+}
+
+func TestMoved(t *testing.T) {
+	nan, inf := math.NaN(), math.Inf(1)
+	for _, c := range []struct {
+		a, b float64
+		want bool
+	}{
+		{1, 1, false},
+		{100, 100.5, false},
+		{100, 102, true},
+		{0, 0.001, true},
+		{-100, -100.5, false},
+		{nan, nan, false},
+		{nan, 1, true},
+		{1, nan, true},
+		{inf, inf, false},
+		{inf, -inf, true},
+		{inf, 1, true},
+	} {
+		if got := moved(c.a, c.b, DefaultThreshold); got != c.want {
+			t.Errorf("moved(%v, %v) = %v, want %v", c.a, c.b, got, c.want)
+		}
+	}
+}
+
+func TestNaNGaugeBacksOff(t *testing.T) {
+	a := Adaptive{Base: time.Second, Max: time.Hour}
+	a.Observe([]metric.Sample{gauge("g", math.NaN(), 0)})
+	if iv := a.Observe([]metric.Sample{gauge("g", math.NaN(), 0)}); iv != 2*time.Second {
+		t.Fatalf("NaN to NaN reset the interval to %v", iv)
+	}
+}
@@ -0,0 +1,99 @@
+package poll
+
+import (
+	"context"
+	"errors"
+	"sync"
+	"time"
+
+	"github.com/sm-moshi/dmetrics-go/instrument"
+	"github.com/sm-moshi/dmetrics-go/metric"
+)
+
+// RateName is the metric carrying each collector's effective poll rate in
+// polls per second, labelled with the collector's name.
+const RateName = "dmetrics_collector_poll_rate_hertz"
+
+// ErrNoCollect is returned by Run for a Job without a Collect function.
+var ErrNoCollect = errors.New("poll: job has no collect function")
+
+// Job is a collector run by a Scheduler.
+type Job struct {
+	// Name identifies the collector in the rate metric, and its polls in
+	// the instrument.Poll module's traces and profiler labels.
+	Name string
+	// Collect appends the collector's samples to dst.
+	Collect func(ctx context.Context, dst []metric.Sample) ([]metric.Sample, error)
+	// Adaptive sets the job's interval. Leave Max zero to poll at a fixed
+	// rate.
+	Adaptive Adaptive
+}
+
+// Scheduler polls jobs and hands each successful poll to a sink.
+type Scheduler struct {
+	sink func([]metric.Sample)
+}
+
+// NewScheduler returns a Scheduler delivering to sink. The sink is called
+// from one goroutine per job, so it must be safe for concurrent use, and
+// it must not keep the slice, which is reused by the next poll.
+func NewScheduler(sink func([]metric.Sample)) *Scheduler {
+	return &Scheduler{sink: sink}
+}
+
+// Run polls every job until ctx is done, each in its own goroutine. Each
+// poll's samples are followed by a RateName sample for the job. A failed
+// poll delivers nothing and the job retries at its base interval.
+func (s *Scheduler) Run(ctx context.Context, jobs ...Job) error {
+	for i := range jobs {
+		if jobs[i].Collect == nil {
+			return ErrNoCollect
+		}
+	}
+	var wg sync.WaitGroup
+	for i := range jobs {
+		wg.Add(1)
+		go func(j *Job) {
+			defer wg.Done()
+			s.run(ctx, j)
+		}(&jobs[i])
+	}
+	wg.Wait()
+	return ctx.Err()
+}
+
+func (s *Scheduler) run(ctx context.Context, j *Job) {
+	var buf []metric.Sample
+	labels := metric.Labels{{Name: "collector", Value: j.Name}}
+	j.Adaptive.Interval() // applies the defaults
+	timer := time.NewTimer(0)
+	defer timer.Stop()
+	for {
+		select {
+		case <-ctx.Done():
+			return
+		case <-timer.C:
+		}
+		// Collectors record their own module's stats, so the poll is
+		// recorded under a module of its own to avoid counting it twice.
+		err := instrument.Do(ctx, instrument.Poll, j.Name, func(ctx context.Context) error {
+			var err error
+			buf, err = j.Collect(ctx, buf[:0])
+			return err
+		})
+		if err != nil {
+			timer.Reset(j.Adaptive.Base)
+			continue
+		}
+		next := j.Adaptive.Observe(buf)
+		buf = append(buf, metric.Sample{
+			Name:      RateName,
+			Labels:    labels,
+			Kind:      metric.Gauge,
+			Value:     float64(time.Second) / float64(next),
+			Timestamp: time.Now().UnixMilli(),
+		})
+		s.sink(buf)
+		timer.Reset(next)
+	}
+}
@@ -0,0 +1,50 @@
+package poll
+
+import (
+	"context"
+	"errors"
+	"sync"
+	"testing"
+	"time"
+
+	"github.com/sm-moshi/dmetrics-go/metric"
+)
+
+func TestRunReportsRate(t *testing.T) {
+	ctx, cancel := context.WithTimeout(context.Background(), 10*time.Second)
+	defer cancel()
+	var mu sync.Mutex
+	var rates []float64
+	s := NewScheduler(func(samples []metric.Sample) {
+		last := samples[len(samples)-1]
+		if last.Name != RateName || last.Labels.Get("collector") != "stable" {
+			t.Errorf("last sample %+v", last)
+		}
+		mu.Lock()
+		defer mu.Unlock()
+		if rates = append(rates, last.Value); len(rates) == 3 {
+			cancel()
+		}
+	})
+	err := s.Run(ctx, Job{
+		Name: "stable",
+		Collect: func(_ context.Context, dst []metric.Sample) ([]metric.Sample, error) {
+			return append(dst, metric.Sample{Name: "g", Kind: metric.Gauge, Value: 1}), nil
+		},
+		Adaptive: Adaptive{Base: time.Millisecond, Max: 4 * time.Millisecond},
+	})
+	if !errors.Is(err, context.Canceled) {
+		t.Fatalf("Run: %v", err)
+	}
+	mu.Lock()
+	defer mu.Unlock()
+	if len(rates) < 3 || rates[0] != 1000 || rates[1] != 500 || rates[2] != 250 {
+		t.Fatalf("rates %v, want 1000, 500, 250 polls per second", rates)
+	}
+}
+
+func TestRunWithoutCollect(t *testing.T) {
+	if err := NewScheduler(func([]metric.Sample) {}).Run(context.Background(), Job{Name: "x"}); !errors.Is(err, ErrNoCollect) {
+		t.Fatalf("Run: %v", err)
+	}
+}
@@ -0,0 +1,106 @@
+// Package process reports per-process and per-thread activity.
+package process
+
+import (
+	"errors"
+	"time"
+
+	"github.com/sm-moshi/dmetrics-go/coalesce"
+	"github.com/sm-moshi/dmetrics-go/instrument"
+	"github.com/sm-moshi/dmetrics-go/internal/intern"
+)
+
+// names interns command and thread names, which repeat in every sample.
+var names = intern.New(intern.DefaultCapacity)
+
+// ErrUnsupported is returned on platforms without a thread source.
+var ErrUnsupported = errors.New("process: not supported on this platform")
+
+// Thread is the state of one thread of a process.
+type Thread struct {
+	TID  int
+	Name string
+	// State is the scheduler state letter: R running, S sleeping,
+	// D uninterruptible wait, T stopped, Z zombie and so on.
+	State    byte
+	Priority int
+	Nice     int
+	User     time.Duration
+	System   time.Duration
+	// CPU is the share of one core the thread used since the previous
+	// sample, 1 being a fully busy core. It is zero on the first sample
+	// of a thread.
+	CPU float64
+}
+
+// threadPrev is what a ThreadSampler keeps of a thread between samples.
+type threadPrev struct {
+	cpu  time.Duration
+	seen uint64
+}
+
+// ThreadSampler samples the threads of one process repeatedly, reusing its
+// buffers and computing CPU shares from the previous sample. It is not
+// safe for concurrent use.
+type ThreadSampler struct {
+	pid   int
+	prev  map[int]threadPrev
+	at    time.Time
+	round uint64
+	stats *instrument.Stats
+	threadSource
+}
+
+// NewThreadSampler returns a sampler for the threads of pid.
+func NewThreadSampler(pid int) *ThreadSampler {
+	return &ThreadSampler{
+		pid:   pid,
+		prev:  make(map[int]threadPrev),
+		stats: instrument.For(instrument.Process),
+	}
+}
+
+// Sample appends the current state of every thread of the process to dst.
+func (s *ThreadSampler) Sample(dst []Thread) ([]Thread, error) {
+	sp := s.stats.Start()
+	now := time.Now()
+	start := len(dst)
+	dst, calls, err := s.read(s.pid, dst)
+	s.stats.AddCalls(instrument.Sysctl, calls)
+	sp.End(err)
+	if err != nil {
+		return dst[:start], err
+	}
+
+	s.round++
+	elapsed := now.Sub(s.at)
+	for i := range dst[start:] {
+		t := &dst[start+i]
+		cpu := t.User + t.System
+		if p, ok := s.prev[t.TID]; ok && elapsed > 0 && cpu >= p.cpu {
+			t.CPU = float64(cpu-p.cpu) / float64(elapsed)
+		}
+		s.prev[t.TID] = threadPrev{cpu: cpu, seen: s.round}
+	}
+	for tid, p := range s.prev {
+		if p.seen != s.round {
+			delete(s.prev, tid)
+		}
+	}
+	s.at = now
+	return dst, nil
+}
+
+// threads shares reads of the same process between concurrent Threads
+// callers.
+var threads coalesce.Group[int, []Thread]
+
+// Threads appends the current state of every thread of pid to dst. CPU is
+// zero; use a ThreadSampler to follow a process over time. Concurrent calls
+// for the same pid share one read of the kernel's thread list.
+func Threads(pid int, dst []Thread) ([]Thread, error) {
+	ts, err := threads.Do(pid, func() ([]Thread, error) {
+		return NewThreadSampler(pid).Sample(nil)
+	})
+	return append(dst, ts...), err
+}
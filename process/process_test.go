@@ -0,0 +1,95 @@
+package process
+
+import (
+	"errors"
+	"os"
+	"runtime"
+	"sync"
+	"testing"
+	"time"
+)
+
+func tids(ts []Thread) map[int]bool {
+	m := make(map[int]bool, len(ts))
+	for _, t := range ts {
+		m[t.TID] = true
+	}
+	return m
+}
+
+// TestExitedThreadDropped ends OS threads while sampling and checks that
+// they leave the listing and the sampler's state.
+func TestExitedThreadDropped(t *testing.T) {
+	s := NewThreadSampler(os.Getpid())
+	if _, err := s.Sample(nil); errors.Is(err, ErrUnsupported) {
+		t.Skip(err)
+	}
+
+	const locked = 4
+	var started, exited sync.WaitGroup
+	stop := make(chan struct{})
+	started.Add(locked)
+	exited.Add(locked)
+	for i := 0; i < locked; i++ {
+		go func() {
+			defer exited.Done()
+			// Returning while locked ends the thread.
+			runtime.LockOSThread()
+			started.Done()
+			<-stop
+		}()
+	}
+	started.Wait()
+	during, err := s.Sample(nil)
+	if err != nil {
+		t.Fatal(err)
+	}
+	if len(during) < locked || s.prev[during[0].TID].seen == 0 {
+		t.Fatalf("own threads: %+v", during)
+	}
+	close(stop)
+	exited.Wait()
+
+	for deadline := time.Now().Add(5 * time.Second); ; {
+		after, err := s.Sample(nil)
+		if err != nil {
+			t.Fatal(err)
+		}
+		now, gone := tids(after), 0
+		for _, th := range during {
+			if now[th.TID] {
+				continue
+			}
+			gone++
+			if _, ok := s.prev[th.TID]; ok {
+				t.Fatalf("exited thread %d kept by the sampler", th.TID)
+			}
+		}
+		if gone > 0 {
+			return
+		}
+		if time.Now().After(deadline) {
+			t.Fatal("no thread exited")
+		}
+		time.Sleep(10 * time.Millisecond)
+	}
+}
+
+// BenchmarkThreadSample samples the threads of the test process itself.
+func BenchmarkThreadSample(b *testing.B) {
+	s := NewThreadSampler(os.Getpid())
+	dst, err := s.Sample(nil)
+	if errors.Is(err, ErrUnsupported) {
+		b.Skip(err)
+	}
+	if err != nil {
+		b.Fatal(err)
+	}
+	b.ReportAllocs()
+	b.ResetTimer()
+	for i := 0; i < b.N; i++ {
+		if dst, err = s.Sample(dst[:0]); err != nil {
+			b.Fatal(err)
+		}
+	}
+}
@@ -0,0 +1,152 @@
+//go:build darwin && cgo
+
+package process
+
+/*
+#include <errno.h>
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/resource.h>
+#include <mach/mach.h>
+
+typedef struct {
+	uint64_t tid;
+	uint64_t user_ns, system_ns;
+	int32_t  run_state, priority, nice;
+	char     name[MAXTHREADNAMESIZE];
+} dm_thread;
+
+// dm_threads stores up to cap threads of pid in out and returns how many
+// there are, which may exceed cap, or -1 with *kr set. Threads that exit
+// between the listing and their thread_info are left out. The process's
+// own task needs no rights; any other needs task_for_pid, which only root
+// or a debugger entitlement is granted.
+static int dm_threads(int pid, dm_thread *out, int cap, uint64_t *calls, kern_return_t *kr) {
+	mach_port_t self = mach_task_self();
+	task_t task = self;
+	if (pid != getpid()) {
+		(*calls)++;
+		if ((*kr = task_for_pid(self, pid, &task)) != KERN_SUCCESS) {
+			return -1;
+		}
+	}
+	errno = 0;
+	int nice = getpriority(PRIO_PROCESS, pid);
+	(*calls)++;
+	if (errno != 0) {
+		nice = 0;
+	}
+
+	thread_act_array_t list;
+	mach_msg_type_number_t count;
+	(*calls)++;
+	if ((*kr = task_threads(task, &list, &count)) != KERN_SUCCESS) {
+		if (task != self) {
+			mach_port_deallocate(self, task);
+		}
+		return -1;
+	}
+	int n = 0;
+	for (mach_msg_type_number_t i = 0; i < count; i++) {
+		thread_identifier_info_data_t id;
+		thread_extended_info_data_t ext;
+		mach_msg_type_number_t idCount = THREAD_IDENTIFIER_INFO_COUNT, extCount = THREAD_EXTENDED_INFO_COUNT;
+		*calls += 3;
+		if (thread_info(list[i], THREAD_IDENTIFIER_INFO, (thread_info_t)&id, &idCount) == KERN_SUCCESS &&
+			thread_info(list[i], THREAD_EXTENDED_INFO, (thread_info_t)&ext, &extCount) == KERN_SUCCESS) {
+			if (n < cap) {
+				dm_thread *t = &out[n];
+				t->tid = id.thread_id;
+				t->user_ns = ext.pth_user_time;
+				t->system_ns = ext.pth_system_time;
+				t->run_state = ext.pth_run_state;
+				t->priority = ext.pth_curpri;
+				t->nice = nice;
+				memcpy(t->name, ext.pth_name, sizeof t->name);
+				t->name[sizeof t->name - 1] = 0;
+			}
+			n++;
+		}
+		mach_port_deallocate(self, list[i]);
+	}
+	vm_deallocate(self, (vm_address_t)list, count * sizeof(thread_act_t));
+	if (task != self) {
+		mach_port_deallocate(self, task);
+	}
+	return n;
+}
+*/
+import "C"
+
+import (
+	"bytes"
+	"fmt"
+	"time"
+	"unsafe"
+)
+
+const (
+	initialThreads = 64
+	// spareThreads is headroom for threads started between sizing the
+	// buffer and filling it.
+	spareThreads = 16
+)
+
+// states maps Mach run states to the Linux state letters.
+var states = [...]byte{
+	C.TH_STATE_RUNNING:         'R',
+	C.TH_STATE_STOPPED:         'T',
+	C.TH_STATE_WAITING:         'S',
+	C.TH_STATE_UNINTERRUPTIBLE: 'D',
+	C.TH_STATE_HALTED:          'Z',
+}
+
+// threadSource lists the threads of a task with task_threads and reads
+// each with thread_info, all in one cgo call per sample into a buffer kept
+// across samples. TID is the system-wide thread ID, as on Linux.
+type threadSource struct {
+	buf []C.dm_thread
+}
+
+func (s *threadSource) read(pid int, dst []Thread) ([]Thread, uint64, error) {
+	if s.buf == nil {
+		s.buf = make([]C.dm_thread, initialThreads)
+	}
+	var (
+		calls C.uint64_t
+		kr    C.kern_return_t
+		n     int
+	)
+	for {
+		n = int(C.dm_threads(C.int(pid), &s.buf[0], C.int(len(s.buf)), &calls, &kr))
+		if n < 0 {
+			return dst, uint64(calls), fmt.Errorf("process: threads of %d: kern_return_t %d", pid, kr)
+		}
+		if n <= len(s.buf) {
+			break
+		}
+		s.buf = make([]C.dm_thread, n+spareThreads)
+	}
+	for i := range s.buf[:n] {
+		ct := &s.buf[i]
+		name := unsafe.Slice((*byte)(unsafe.Pointer(&ct.name[0])), len(ct.name))
+		if j := bytes.IndexByte(name, 0); j >= 0 {
+			name = name[:j]
+		}
+		t := Thread{
+			TID:      int(ct.tid),
+			Name:     names.Bytes(name),
+			State:    '?',
+			Priority: int(ct.priority),
+			Nice:     int(ct.nice),
+			User:     time.Duration(ct.user_ns),
+			System:   time.Duration(ct.system_ns),
+		}
+		if st := int(ct.run_state); st < len(states) && states[st] != 0 {
+			t.State = states[st]
+		}
+		dst = append(dst, t)
+	}
+	return dst, uint64(calls), nil
+}
@@ -0,0 +1,177 @@
+//go:build linux
+
+package process
+
+import (
+	"bytes"
+	"encoding/binary"
+	"errors"
+	"os"
+	"strconv"
+	"syscall"
+	"time"
+
+	"github.com/sm-moshi/dmetrics-go/internal/procfs"
+)
+
+// userHZ is the unit of the tick counters in /proc stat files. The kernel
+// fixes it at 100 for user space on every architecture Go supports.
+const userHZ = 100
+
+const (
+	initialDirentBuf = 8192
+	initialStatBuf   = 512
+	decimalBase      = 10
+)
+
+// Offsets of the stat fields after the parenthesised command name, which
+// is field 2; the state letter is field 3.
+const (
+	statState    = 0
+	statUtime    = 11
+	statStime    = 12
+	statPriority = 15
+	statNice     = 16
+	statFields   = 17
+)
+
+// linux_dirent64 layout: ino, off, reclen, type, name.
+const (
+	direntReclen = 16
+	direntName   = 19
+)
+
+var errMalformed = errors.New("process: malformed thread stat")
+
+type threadSource struct {
+	dirent []byte
+	stat   []byte
+	path   []byte
+}
+
+// read lists /proc/<pid>/task and parses each thread's stat file. File
+// reads are not counted as calls.
+func (s *threadSource) read(pid int, dst []Thread) ([]Thread, uint64, error) {
+	if s.dirent == nil {
+		s.dirent = make([]byte, initialDirentBuf)
+		s.stat = make([]byte, initialStatBuf)
+	}
+	s.path = strconv.AppendInt(append(s.path[:0], "/proc/"...), int64(pid), decimalBase)
+	s.path = append(s.path, "/task/"...)
+	base := len(s.path)
+
+	fd, err := syscall.Open(string(s.path), syscall.O_RDONLY|syscall.O_DIRECTORY|syscall.O_CLOEXEC, 0)
+	if err != nil {
+		return dst, 0, &os.PathError{Op: "open", Path: string(s.path), Err: err}
+	}
+	defer syscall.Close(fd)
+
+	for {
+		n, err := syscall.ReadDirent(fd, s.dirent)
+		if err != nil {
+			return dst, 0, err
+		}
+		if n == 0 {
+			return dst, 0, nil
+		}
+		for b := s.dirent[:n]; len(b) >= direntName; {
+			reclen := int(binary.NativeEndian.Uint16(b[direntReclen:]))
+			if reclen == 0 || reclen > len(b) {
+				break
+			}
+			name := b[direntName:reclen]
+			if i := bytes.IndexByte(name, 0); i >= 0 {
+				name = name[:i]
+			}
+			b = b[reclen:]
+			tid, ok := procfs.ParseUint(name)
+			if !ok {
+				continue // "." and ".."
+			}
+			s.path = append(append(s.path[:base], name...), "/stat"...)
+			t, err := s.thread(int(tid))
+			if errors.Is(err, syscall.ENOENT) || errors.Is(err, syscall.ESRCH) {
+				continue // the thread exited since the listing
+			}
+			if err != nil {
+				return dst, 0, err
+			}
+			dst = append(dst, t)
+		}
+	}
+}
+
+func (s *threadSource) thread(tid int) (Thread, error) {
+	data, err := s.readStat()
+	if err != nil {
+		return Thread{}, err
+	}
+	open, end := bytes.IndexByte(data, '('), bytes.LastIndexByte(data, ')')
+	if open < 0 || end < open {
+		return Thread{}, errMalformed
+	}
+	t := Thread{TID: tid, Name: names.Bytes(data[open+1 : end])}
+
+	var f [statFields]int64
+	rest := data[end+1:]
+	for i := 0; i < statFields; i++ {
+		rest = bytes.TrimLeft(rest, " ")
+		tok := rest
+		if j := bytes.IndexByte(rest, ' '); j >= 0 {
+			tok, rest = rest[:j], rest[j:]
+		} else {
+			rest = nil
+		}
+		if len(tok) == 0 {
+			return Thread{}, errMalformed
+		}
+		if i == statState {
+			t.State = tok[0]
+			continue
+		}
+		v, ok := procfs.ParseUint(bytes.TrimPrefix(tok, []byte{'-'}))
+		if !ok {
+			return Thread{}, errMalformed
+		}
+		f[i] = int64(v)
+		if tok[0] == '-' {
+			f[i] = -f[i]
+		}
+	}
+	t.User = ticks(f[statUtime])
+	t.System = ticks(f[statStime])
+	t.Priority = int(f[statPriority])
+	t.Nice = int(f[statNice])
+	return t, nil
+}
+
+// readStat reads the file at s.path with raw system calls, which unlike
+// os.File allocate nothing beyond the path.
+func (s *threadSource) readStat() ([]byte, error) {
+	fd, err := syscall.Open(string(s.path), syscall.O_RDONLY|syscall.O_CLOEXEC, 0)
+	if err != nil {
+		return nil, err
+	}
+	defer syscall.Close(fd)
+	n := 0
+	for {
+		if n == len(s.stat) {
+			s.stat = append(s.stat, make([]byte, len(s.stat))...)
+		}
+		m, err := syscall.Read(fd, s.stat[n:])
+		if errors.Is(err, syscall.EINTR) {
+			continue
+		}
+		if err != nil {
+			return nil, err
+		}
+		if m == 0 {
+			return s.stat[:n], nil
+		}
+		n += m
+	}
+}
+
+func ticks(n int64) time.Duration {
+	return time.Duration(n) * time.Second / userHZ
+}
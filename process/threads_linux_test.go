@@ -0,0 +1,85 @@
+package process
+
+import (
+	"os"
+	"runtime"
+	"strconv"
+	"strings"
+	"syscall"
+	"testing"
+	"time"
+)
+
+func taskDir(t *testing.T) map[int]bool {
+	t.Helper()
+	entries, err := os.ReadDir("/proc/self/task")
+	if err != nil {
+		t.Fatal(err)
+	}
+	m := make(map[int]bool, len(entries))
+	for _, e := range entries {
+		tid, err := strconv.Atoi(e.Name())
+		if err != nil {
+			t.Fatal(err)
+		}
+		m[tid] = true
+	}
+	return m
+}
+
+func TestThreadsMatchTaskDir(t *testing.T) {
+	tidc := make(chan int)
+	stop := make(chan struct{})
+	defer close(stop)
+	go func() {
+		runtime.LockOSThread()
+		defer runtime.UnlockOSThread()
+		tidc <- syscall.Gettid()
+		for {
+			select {
+			case <-stop:
+				return
+			default:
+			}
+		}
+	}()
+	busy := <-tidc
+
+	s := NewThreadSampler(os.Getpid())
+	if _, err := s.Sample(nil); err != nil {
+		t.Fatal(err)
+	}
+	time.Sleep(100 * time.Millisecond)
+
+	pre := taskDir(t)
+	got, err := s.Sample(nil)
+	if err != nil {
+		t.Fatal(err)
+	}
+	post := taskDir(t)
+
+	listed := tids(got)
+	for tid := range pre {
+		if post[tid] && !listed[tid] {
+			t.Errorf("thread %d in /proc/self/task is missing", tid)
+		}
+	}
+	for _, th := range got {
+		if !pre[th.TID] && !post[th.TID] {
+			t.Errorf("thread %d is not in /proc/self/task", th.TID)
+		}
+		if th.TID != busy {
+			continue
+		}
+		comm, err := os.ReadFile("/proc/self/task/" + strconv.Itoa(busy) + "/comm")
+		if err != nil {
+			t.Fatal(err)
+		}
+		if th.Name != strings.TrimSuffix(string(comm), "\n") || th.State != 'R' || th.User+th.System == 0 || th.CPU <= 0 {
+			t.Errorf("spinning thread %+v", th)
+		}
+	}
+	if !listed[busy] {
+		t.Errorf("spinning thread %d not listed", busy)
+	}
+}
@@ -0,0 +1,11 @@
+//go:build !linux && !(darwin && cgo)
+
+package process
+
+// threadSource fails on platforms without a thread source. On darwin the
+// per-thread times come from Mach calls, which need cgo.
+type threadSource struct{}
+
+func (threadSource) read(_ int, dst []Thread) ([]Thread, uint64, error) {
+	return dst, 0, ErrUnsupported
+}
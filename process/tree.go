@@ -0,0 +1,293 @@
+package process
+
+import "slices"
+
+// Aggregate sums a value over a process subtree.
+type Aggregate struct {
+	// Count is the number of processes, the root of the subtree included.
+	Count int
+	CPU   float64
+	RSS   uint64
+}
+
+const none = -1
+
+// root is the slot of the sentinel under which processes without a known
+// parent hang.
+const root = 0
+
+// node is one process. Links are slot indices into Tree.nodes, so the
+// tree is a single flat slice the garbage collector never scans.
+type node struct {
+	pid, ppid   int32
+	parent      int32
+	first, last int32 // children
+	prev, next  int32 // siblings
+	cpu         float64
+	rss         uint64
+	sub         Aggregate
+}
+
+// Tree is the process hierarchy with subtree totals of CPU and RSS. It is
+// maintained incrementally: a scanner reports processes that appeared or
+// changed with Set and those that exited with Remove, and each call only
+// touches the process and its ancestors. Subtree totals are then read in
+// constant time. It is not safe for concurrent use.
+type Tree struct {
+	nodes []node
+	slots map[int]int32
+	free  []int32
+	// cycles holds the slots kept at the top level because their parent
+	// is their own descendant. It is almost always empty.
+	cycles []int32
+}
+
+// NewTree returns an empty tree.
+func NewTree() *Tree {
+	t := &Tree{slots: make(map[int]int32)}
+	t.nodes = append(t.nodes, node{pid: none, ppid: none, parent: none, first: none, last: none, prev: none, next: none})
+	return t
+}
+
+// Len returns the number of processes in the tree.
+func (t *Tree) Len() int {
+	return len(t.slots)
+}
+
+// Set records a process that appeared or whose parent, CPU or RSS
+// changed. A process whose parent is not in the tree, or is its own
+// descendant after pid reuse, is kept at the top level and moved under its
+// parent once that appears or the loop is broken.
+func (t *Tree) Set(pid, ppid int, cpu float64, rss uint64) {
+	s, ok := t.slots[pid]
+	if !ok {
+		s = t.alloc(pid)
+		t.adoptOrphans(pid, s)
+	}
+	n := &t.nodes[s]
+	// RSS deltas wrap when it shrinks; the unsigned sums wrap back.
+	d := Aggregate{CPU: cpu - n.cpu, RSS: rss - n.rss}
+	n.cpu, n.rss = cpu, rss
+	t.propagate(s, d)
+	if !ok || int(n.ppid) != ppid {
+		n.ppid = int32(ppid)
+		t.place(s)
+		t.retryCycles()
+	}
+}
+
+// Remove drops an exited process. Its children stay in the tree at the top
+// level until Set reports their new parent.
+func (t *Tree) Remove(pid int) {
+	s, ok := t.slots[pid]
+	if !ok {
+		return
+	}
+	for c := t.nodes[s].first; c != none; c = t.nodes[s].first {
+		t.move(c, root)
+	}
+	t.move(s, none)
+	t.dropCycle(s)
+	delete(t.slots, pid)
+	t.free = append(t.free, s)
+	t.retryCycles()
+}
+
+// Parent returns the parent of pid, or false if pid is unknown or its
+// parent is not in the tree.
+func (t *Tree) Parent(pid int) (int, bool) {
+	s, ok := t.slots[pid]
+	if !ok || t.nodes[s].parent == root {
+		return 0, false
+	}
+	return int(t.nodes[t.nodes[s].parent].pid), true
+}
+
+// Children appends the children of pid to dst.
+func (t *Tree) Children(pid int, dst []int) []int {
+	s, ok := t.slots[pid]
+	if !ok {
+		return dst
+	}
+	for c := t.nodes[s].first; c != none; c = t.nodes[c].next {
+		dst = append(dst, int(t.nodes[c].pid))
+	}
+	return dst
+}
+
+// Subtree returns the totals of pid and all its descendants.
+func (t *Tree) Subtree(pid int) (Aggregate, bool) {
+	s, ok := t.slots[pid]
+	if !ok {
+		return Aggregate{}, false
+	}
+	return t.nodes[s].sub, true
+}
+
+// Walk calls fn for pid and its descendants in depth-first order, with the
+// depth below pid, until fn returns false. pid 0 is a process like any
+// other, darwin's kernel_task; use WalkAll for the whole tree.
+func (t *Tree) Walk(pid int, fn func(pid, depth int) bool) {
+	s, ok := t.slots[pid]
+	if !ok || !fn(pid, 0) {
+		return
+	}
+	t.walk(s, 1, fn)
+}
+
+// WalkAll calls fn for every process in depth-first order, starting with
+// the top-level processes at depth 0, until fn returns false.
+func (t *Tree) WalkAll(fn func(pid, depth int) bool) {
+	t.walk(root, 0, fn)
+}
+
+// walk calls fn for the descendants of slot start, its children being at
+// depth first.
+func (t *Tree) walk(start int32, first int, fn func(pid, depth int) bool) {
+	depth := first - 1
+	for c := t.nodes[start].first; c != none; {
+		depth++
+		if !fn(int(t.nodes[c].pid), depth) {
+			return
+		}
+		if t.nodes[c].first != none {
+			c = t.nodes[c].first
+			continue
+		}
+		// Climb until a node with a next sibling, stopping at the start.
+		for t.nodes[c].next == none {
+			c = t.nodes[c].parent
+			depth--
+			if c == start {
+				return
+			}
+		}
+		c = t.nodes[c].next
+		depth--
+	}
+}
+
+func (t *Tree) alloc(pid int) int32 {
+	n := node{pid: int32(pid), ppid: none, parent: none, first: none, last: none, prev: none, next: none, sub: Aggregate{Count: 1}}
+	var s int32
+	if k := len(t.free); k > 0 {
+		s = t.free[k-1]
+		t.free = t.free[:k-1]
+		t.nodes[s] = n
+	} else {
+		s = int32(len(t.nodes))
+		t.nodes = append(t.nodes, n)
+	}
+	t.slots[pid] = s
+	return s
+}
+
+// parentSlot returns the slot to hang s under for ppid: the parent's, or
+// the root if the parent is unknown or would make a cycle (pid reuse can
+// briefly report a descendant as the parent), in which case cycle is set.
+func (t *Tree) parentSlot(s int32, ppid int) (p int32, cycle bool) {
+	p, ok := t.slots[ppid]
+	if !ok {
+		return root, false
+	}
+	for a := p; a != none; a = t.nodes[a].parent {
+		if a == s {
+			return root, true
+		}
+	}
+	return p, false
+}
+
+// place moves s under the parent it reports, remembering it in t.cycles
+// if that parent is its descendant.
+func (t *Tree) place(s int32) {
+	t.dropCycle(s)
+	p, cycle := t.parentSlot(s, int(t.nodes[s].ppid))
+	if cycle {
+		t.cycles = append(t.cycles, s)
+	}
+	if p != t.nodes[s].parent {
+		t.move(s, p)
+	}
+}
+
+// retryCycles places the processes of t.cycles whose parent is no longer
+// their descendant, after a move or removal that may have broken the loop.
+func (t *Tree) retryCycles() {
+	for i := 0; i < len(t.cycles); {
+		s := t.cycles[i]
+		p, cycle := t.parentSlot(s, int(t.nodes[s].ppid))
+		if cycle {
+			i++
+			continue
+		}
+		t.cycles = slices.Delete(t.cycles, i, i+1)
+		if p != t.nodes[s].parent {
+			t.move(s, p)
+		}
+		// Moving s may have broken another loop: start over.
+		i = 0
+	}
+}
+
+func (t *Tree) dropCycle(s int32) {
+	if i := slices.Index(t.cycles, s); i >= 0 {
+		t.cycles = slices.Delete(t.cycles, i, i+1)
+	}
+}
+
+// adoptOrphans moves the top-level processes waiting for pid under s.
+func (t *Tree) adoptOrphans(pid int, s int32) {
+	for c := t.nodes[root].first; c != none; {
+		next := t.nodes[c].next
+		if int(t.nodes[c].ppid) == pid && c != s {
+			t.move(c, s)
+		}
+		c = next
+	}
+}
+
+// move detaches s from its parent, if any, and attaches it under p unless
+// p is none, keeping the subtree totals of both ancestries in step.
+func (t *Tree) move(s, p int32) {
+	n := &t.nodes[s]
+	if old := n.parent; old != none {
+		if n.prev != none {
+			t.nodes[n.prev].next = n.next
+		} else {
+			t.nodes[old].first = n.next
+		}
+		if n.next != none {
+			t.nodes[n.next].prev = n.prev
+		} else {
+			t.nodes[old].last = n.prev
+		}
+		t.propagate(old, negate(n.sub))
+	}
+	n.parent, n.prev, n.next = p, none, none
+	if p == none {
+		return
+	}
+	if l := t.nodes[p].last; l != none {
+		t.nodes[l].next = s
+		n.prev = l
+	} else {
+		t.nodes[p].first = s
+	}
+	t.nodes[p].last = s
+	t.propagate(p, n.sub)
+}
+
+// propagate adds d to the subtree totals of s and its ancestors.
+func (t *Tree) propagate(s int32, d Aggregate) {
+	for ; s != none; s = t.nodes[s].parent {
+		a := &t.nodes[s].sub
+		a.Count += d.Count
+		a.CPU += d.CPU
+		a.RSS += d.RSS
+	}
+}
+
+func negate(a Aggregate) Aggregate {
+	return Aggregate{Count: -a.Count, CPU: -a.CPU, RSS: -a.RSS}
+}
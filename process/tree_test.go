@@ -0,0 +1,236 @@
+package process
+
+import (
+	"math"
+	"math/rand"
+	"slices"
+	"testing"
+)
+
+type visit struct{ pid, depth int }
+
+func walkAll(tr *Tree) []visit {
+	var out []visit
+	tr.WalkAll(func(pid, depth int) bool {
+		out = append(out, visit{pid, depth})
+		return true
+	})
+	return out
+}
+
+func walk(tr *Tree, pid int) []visit {
+	var out []visit
+	tr.Walk(pid, func(pid, depth int) bool {
+		out = append(out, visit{pid, depth})
+		return true
+	})
+	return out
+}
+
+type proc struct {
+	ppid int
+	cpu  float64
+	rss  uint64
+}
+
+// checkTree compares the tree with the processes it was given, recomputing
+// every link and total from scratch.
+func checkTree(t *testing.T, tr *Tree, procs map[int]proc) {
+	t.Helper()
+	if tr.Len() != len(procs) {
+		t.Fatalf("Len %d, want %d", tr.Len(), len(procs))
+	}
+	parent := make(map[int]int)
+	for pid, p := range procs {
+		pp, ok := tr.Parent(pid)
+		if ok {
+			if pp != p.ppid {
+				t.Fatalf("parent of %d is %d, reported %d", pid, pp, p.ppid)
+			}
+			parent[pid] = pp
+			continue
+		}
+		// Only a cycle keeps a process from a parent in the tree.
+		if _, known := procs[p.ppid]; known && p.ppid != pid && !isAncestor(tr, pid, p.ppid) {
+			t.Fatalf("%d not under its parent %d", pid, p.ppid)
+		}
+	}
+	for pid, p := range procs {
+		var want []int
+		for c, pp := range parent {
+			if pp == pid {
+				want = append(want, c)
+			}
+		}
+		got := tr.Children(pid, nil)
+		slices.Sort(got)
+		slices.Sort(want)
+		if !slices.Equal(got, want) {
+			t.Fatalf("children of %d: %v, want %v", pid, got, want)
+		}
+
+		sum := Aggregate{Count: 1, CPU: p.cpu, RSS: p.rss}
+		sub := walk(tr, pid)
+		for _, v := range sub[1:] {
+			q := procs[v.pid]
+			sum.Count++
+			sum.CPU += q.cpu
+			sum.RSS += q.rss
+		}
+		agg, ok := tr.Subtree(pid)
+		if !ok || agg.Count != sum.Count || agg.RSS != sum.RSS || math.Abs(agg.CPU-sum.CPU) > 1e-9 {
+			t.Fatalf("subtree of %d: %+v, want %+v", pid, agg, sum)
+		}
+	}
+
+	// Depth-first: each process comes straight after its parent's subtree
+	// started, one level deeper, and every process comes once.
+	depth := make(map[int]int)
+	var path []int
+	for _, v := range walkAll(tr) {
+		if _, dup := depth[v.pid]; dup {
+			t.Fatalf("%d walked twice", v.pid)
+		}
+		if v.depth > len(path) {
+			t.Fatalf("%d at depth %d below a path of %d", v.pid, v.depth, len(path))
+		}
+		path = path[:v.depth]
+		if pp, ok := parent[v.pid]; ok != (v.depth > 0) || ok && path[v.depth-1] != pp {
+			t.Fatalf("%d at depth %d under %v", v.pid, v.depth, path)
+		}
+		path = append(path, v.pid)
+		depth[v.pid] = v.depth
+	}
+	if len(depth) != len(procs) {
+		t.Fatalf("walked %d of %d", len(depth), len(procs))
+	}
+}
+
+// isAncestor reports whether a is an ancestor of pid in the tree.
+func isAncestor(tr *Tree, a, pid int) bool {
+	for p, ok := tr.Parent(pid); ok; p, ok = tr.Parent(p) {
+		if p == a {
+			return true
+		}
+	}
+	return false
+}
+
+func TestTreeRandom(t *testing.T) {
+	r := rand.New(rand.NewSource(1))
+	tr := NewTree()
+	procs := make(map[int]proc)
+	const pids = 60
+	for i := 0; i < 5000; i++ {
+		pid := 1 + r.Intn(pids)
+		switch p, ok := procs[pid]; {
+		case r.Intn(4) == 0:
+			delete(procs, pid)
+			tr.Remove(pid)
+		case ok && r.Intn(2) == 0:
+			// Only the figures change.
+			p.cpu, p.rss = r.Float64(), uint64(r.Intn(1000))
+			procs[pid] = p
+			tr.Set(pid, p.ppid, p.cpu, p.rss)
+		default:
+			// A new process, or a reparented one.
+			p = proc{ppid: r.Intn(pids + 1), cpu: r.Float64(), rss: uint64(r.Intn(1000))}
+			procs[pid] = p
+			tr.Set(pid, p.ppid, p.cpu, p.rss)
+		}
+		if i%5 == 0 {
+			checkTree(t, tr, procs)
+		}
+	}
+}
+
+func TestOrphansAdopted(t *testing.T) {
+	tr := NewTree()
+	tr.Set(5, 3, 1, 10)
+	tr.Set(6, 3, 2, 20)
+	tr.Set(7, 5, 4, 40)
+	if _, ok := tr.Parent(5); ok {
+		t.Fatal("5 has a parent before 3 appears")
+	}
+	tr.Set(3, 1, 8, 80)
+	if p, _ := tr.Parent(5); p != 3 {
+		t.Fatalf("5 under %d", p)
+	}
+	if a, _ := tr.Subtree(3); a != (Aggregate{Count: 4, CPU: 15, RSS: 150}) {
+		t.Fatalf("subtree %+v", a)
+	}
+
+	// Children of an exited process wait at the top level for a new
+	// parent.
+	tr.Remove(3)
+	if _, ok := tr.Parent(5); ok {
+		t.Fatal("5 kept its exited parent")
+	}
+	if a, _ := tr.Subtree(5); a.Count != 2 {
+		t.Fatalf("subtree of 5 %+v", a)
+	}
+	tr.Set(5, 1, 1, 10)
+	tr.Set(1, 0, 0, 0)
+	if got, want := walkAll(tr), []visit{{6, 0}, {1, 0}, {5, 1}, {7, 2}}; !slices.Equal(got, want) {
+		t.Fatalf("walk %v, want %v", got, want)
+	}
+}
+
+func TestReusedPIDCycle(t *testing.T) {
+	tr := NewTree()
+	tr.Set(1, 0, 1, 1)
+	tr.Set(2, 1, 1, 1)
+	tr.Set(3, 2, 1, 1)
+	// pid 1 was reused and the new process reports its old grandchild as
+	// parent: it goes to the top level rather than closing a loop.
+	tr.Set(1, 3, 1, 1)
+	if _, ok := tr.Parent(1); ok {
+		t.Fatal("cycle closed")
+	}
+	if got, want := walkAll(tr), []visit{{1, 0}, {2, 1}, {3, 2}}; !slices.Equal(got, want) {
+		t.Fatalf("walk %v, want %v", got, want)
+	}
+	// Once 3 leaves 1's subtree the loop is broken and 1 goes under it.
+	tr.Set(3, 0, 1, 1)
+	if p, _ := tr.Parent(1); p != 3 {
+		t.Fatalf("1 under %d", p)
+	}
+	if got, want := walkAll(tr), []visit{{3, 0}, {1, 1}, {2, 2}}; !slices.Equal(got, want) {
+		t.Fatalf("walk %v, want %v", got, want)
+	}
+	if a, _ := tr.Subtree(3); a.Count != 3 || len(tr.cycles) != 0 {
+		t.Fatalf("subtree %+v, cycles %v", a, tr.cycles)
+	}
+}
+
+func TestWalk(t *testing.T) {
+	tr := NewTree()
+	// darwin's kernel_task is pid 0 and launchd's parent.
+	for _, p := range [][2]int{{0, 0}, {1, 0}, {10, 1}, {11, 10}, {12, 10}, {20, 1}, {21, 20}, {99, 98}} {
+		tr.Set(p[0], p[1], 0, 0)
+	}
+	if got, want := walkAll(tr), []visit{{0, 0}, {1, 1}, {10, 2}, {11, 3}, {12, 3}, {20, 2}, {21, 3}, {99, 0}}; !slices.Equal(got, want) {
+		t.Fatalf("WalkAll %v, want %v", got, want)
+	}
+	if got, want := walk(tr, 0), []visit{{0, 0}, {1, 1}, {10, 2}, {11, 3}, {12, 3}, {20, 2}, {21, 3}}; !slices.Equal(got, want) {
+		t.Fatalf("Walk(0) %v, want %v", got, want)
+	}
+	if got, want := walk(tr, 10), []visit{{10, 0}, {11, 1}, {12, 1}}; !slices.Equal(got, want) {
+		t.Fatalf("Walk(10) %v, want %v", got, want)
+	}
+	if got := walk(tr, 12); !slices.Equal(got, []visit{{12, 0}}) {
+		t.Fatalf("Walk of a leaf %v", got)
+	}
+	if got := walk(tr, 42); got != nil {
+		t.Fatalf("Walk of an unknown pid %v", got)
+	}
+
+	var seen []int
+	tr.Walk(1, func(pid, _ int) bool {
+		seen = append(seen, pid)
+		return pid != 11
+	})
+	if !slices.Equal(seen, []int{1, 10, 11}) {
+		t.Fatalf("stopped walk %v", seen)
+	}
+}
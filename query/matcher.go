@@ -0,0 +1,88 @@
+package query
+
+import (
+	"fmt"
+	"regexp"
+)
+
+// MatchType is the comparison a Matcher applies to a label value.
+type MatchType uint8
+
+const (
+	// MatchEqual selects series whose label equals the value.
+	MatchEqual MatchType = iota
+	// MatchNotEqual selects series whose label differs from the value.
+	MatchNotEqual
+	// MatchRegexp selects series whose label fully matches the regexp.
+	MatchRegexp
+	// MatchNotRegexp selects series whose label does not match the regexp.
+	MatchNotRegexp
+)
+
+// String returns the PromQL operator of the match type.
+func (t MatchType) String() string {
+	switch t {
+	case MatchEqual:
+		return "="
+	case MatchNotEqual:
+		return "!="
+	case MatchRegexp:
+		return "=~"
+	case MatchNotRegexp:
+		return "!~"
+	default:
+		return "?"
+	}
+}
+
+// Matcher selects series by one label. A series without the label is
+// treated as having it set to "", as in PromQL.
+type Matcher struct {
+	Type  MatchType
+	Name  string
+	Value string
+	re    *regexp.Regexp
+}
+
+// NewMatcher returns a matcher; regexps are anchored at both ends.
+func NewMatcher(t MatchType, name, value string) (*Matcher, error) {
+	m := &Matcher{Type: t, Name: name, Value: value}
+	if t == MatchRegexp || t == MatchNotRegexp {
+		re, err := regexp.Compile("^(?:" + value + ")$")
+		if err != nil {
+			return nil, fmt.Errorf("query: matcher %s: %w", m, err)
+		}
+		m.re = re
+	}
+	return m, nil
+}
+
+// MustMatcher is NewMatcher for constant expressions; it panics on error.
+func MustMatcher(t MatchType, name, value string) *Matcher {
+	m, err := NewMatcher(t, name, value)
+	if err != nil {
+		panic(err)
+	}
+	return m
+}
+
+// Matches reports whether the label value v is selected.
+func (m *Matcher) Matches(v string) bool {
+	switch m.Type {
+	case MatchEqual:
+		return v == m.Value
+	case MatchNotEqual:
+		return v != m.Value
+	case MatchRegexp:
+		return m.re.MatchString(v)
+	case MatchNotRegexp:
+		return !m.re.MatchString(v)
+	default:
+		return false
+	}
+}
+
+// String formats the matcher as in PromQL.
+func (m *Matcher) String() string {
+	return fmt.Sprintf("%s%s%q", m.Name, m.Type, m.Value)
+}
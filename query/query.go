@@ -0,0 +1,205 @@
+// Package query evaluates range queries over the metric history: select
+// series by name and label matchers, then evaluate a function over a
+// sliding window at every step between Start and End, as a PromQL range
+// query of rate(x[r]) or avg_over_time(x[r]) would.
+package query
+
+import (
+	"errors"
+	"math"
+	"slices"
+	"time"
+
+	"github.com/sm-moshi/dmetrics-go/history"
+	"github.com/sm-moshi/dmetrics-go/metric"
+)
+
+// Func is the function evaluated over each step's window.
+type Func uint8
+
+const (
+	// FuncLast returns the newest sample in the window, like a plain PromQL
+	// selector with Range as lookback.
+	FuncLast Func = iota
+	// FuncRate returns the per-second increase of a counter, allowing for
+	// resets.
+	FuncRate
+	// FuncAvg returns the mean of the window.
+	FuncAvg
+	// FuncMin returns the minimum of the window.
+	FuncMin
+	// FuncMax returns the maximum of the window.
+	FuncMax
+	// FuncQuantile returns the Query.Quantile of the window.
+	FuncQuantile
+)
+
+// DefaultLookback is the window of FuncLast queries without a Range.
+const DefaultLookback = 5 * time.Minute
+
+// minRateSamples is the number of samples a window needs for a rate.
+const minRateSamples = 2
+
+var (
+	// ErrBadRange is returned for queries whose End precedes Start.
+	ErrBadRange = errors.New("query: end before start")
+	// ErrBadQuantile is returned for quantiles outside [0, 1].
+	ErrBadQuantile = errors.New("query: quantile must be within [0, 1]")
+)
+
+// Query is a range query.
+type Query struct {
+	Matchers []*Matcher
+	// Start and End bound the evaluation steps, in milliseconds since the
+	// Unix epoch.
+	Start, End int64
+	// Step is the distance between evaluations. Zero evaluates only at End.
+	Step time.Duration
+	// Range is the window each evaluation covers, ending at the step. It
+	// defaults to Step, or DefaultLookback for FuncLast.
+	Range    time.Duration
+	Func     Func
+	Quantile float64
+}
+
+// Series is the result for one selected series.
+type Series struct {
+	Name   string
+	Labels metric.Labels
+	Points []history.Point
+}
+
+// Exec runs the query against the store. Series without a value at any step
+// are left out.
+func Exec(st *history.Store, q *Query) ([]Series, error) {
+	if q.End < q.Start {
+		return nil, ErrBadRange
+	}
+	if q.Func == FuncQuantile && (q.Quantile < 0 || q.Quantile > 1) {
+		return nil, ErrBadQuantile
+	}
+	selected, err := Select(st, q.Matchers...)
+	if err != nil {
+		return nil, err
+	}
+
+	step, window := q.Step.Milliseconds(), q.Range.Milliseconds()
+	if window <= 0 {
+		window = step
+		if q.Func == FuncLast || window <= 0 {
+			window = DefaultLookback.Milliseconds()
+		}
+	}
+	start := q.Start
+	if step <= 0 {
+		start, step = q.End, 1
+	}
+	// Align steps to multiples of the step so repeated dashboard queries
+	// see stable buckets. Round up, so no step falls before Start.
+	start += (step - start%step) % step
+
+	var ev evaluator
+	var out []Series
+	for _, s := range selected {
+		ev.points, err = st.Range(s.Name(), s.Labels(), start-window+1, q.End, ev.points[:0])
+		if err != nil {
+			return nil, err
+		}
+		if pts := ev.run(q, start, step, window); len(pts) > 0 {
+			out = append(out, Series{Name: s.Name(), Labels: s.Labels(), Points: pts})
+		}
+	}
+	return out, nil
+}
+
+// evaluator slides the window over one series' points; its buffers are
+// reused across series.
+type evaluator struct {
+	points  []history.Point
+	scratch []float64
+}
+
+func (ev *evaluator) run(q *Query, start, step, window int64) []history.Point {
+	var out []history.Point
+	lo, hi := 0, 0
+	for t := start; t <= q.End; t += step {
+		// Window is (t-window, t].
+		for hi < len(ev.points) && ev.points[hi].T <= t {
+			hi++
+		}
+		for lo < hi && ev.points[lo].T <= t-window {
+			lo++
+		}
+		if v, ok := ev.eval(q, ev.points[lo:hi]); ok {
+			out = append(out, history.Point{T: t, V: v})
+		}
+	}
+	return out
+}
+
+func (ev *evaluator) eval(q *Query, w []history.Point) (float64, bool) {
+	if len(w) == 0 {
+		return 0, false
+	}
+	switch q.Func {
+	case FuncRate:
+		return rate(w)
+	case FuncAvg:
+		var sum float64
+		for _, p := range w {
+			sum += p.V
+		}
+		return sum / float64(len(w)), true
+	case FuncMin:
+		v := w[0].V
+		for _, p := range w[1:] {
+			v = math.Min(v, p.V)
+		}
+		return v, true
+	case FuncMax:
+		v := w[0].V
+		for _, p := range w[1:] {
+			v = math.Max(v, p.V)
+		}
+		return v, true
+	case FuncQuantile:
+		return ev.quantile(q.Quantile, w), true
+	default:
+		return w[len(w)-1].V, true
+	}
+}
+
+// rate returns the per-second increase over the window, treating any drop
+// as a counter reset.
+func rate(w []history.Point) (float64, bool) {
+	if len(w) < minRateSamples {
+		return 0, false
+	}
+	var inc float64
+	for i := 1; i < len(w); i++ {
+		if d := w[i].V - w[i-1].V; d >= 0 {
+			inc += d
+		} else {
+			inc += w[i].V
+		}
+	}
+	secs := float64(w[len(w)-1].T-w[0].T) / float64(time.Second/time.Millisecond)
+	return inc / secs, true
+}
+
+// quantile interpolates between the closest ranks, as PromQL's
+// quantile_over_time does.
+func (ev *evaluator) quantile(q float64, w []history.Point) float64 {
+	vals := ev.scratch[:0]
+	for _, p := range w {
+		vals = append(vals, p.V)
+	}
+	ev.scratch = vals
+	slices.Sort(vals)
+
+	rank := q * float64(len(vals)-1)
+	lower := int(math.Floor(rank))
+	upper := min(lower+1, len(vals)-1)
+	frac := rank - float64(lower)
+	return vals[lower]*(1-frac) + vals[upper]*frac
+}
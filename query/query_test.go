@@ -0,0 +1,253 @@
+package query
+
+import (
+	"errors"
+	"math"
+	"strconv"
+	"testing"
+	"time"
+
+	"github.com/sm-moshi/dmetrics-go/history"
+	"github.com/sm-moshi/dmetrics-go/metric"
+)
+
+// store returns a store with one sample a second over [0, 60s] for the
+// series of a few processes.
+func store() *history.Store {
+	st := history.New(history.Options{})
+	procs := []metric.Labels{
+		metric.NewLabels("pid", "1", "comm", "launchd"),
+		metric.NewLabels("pid", "2", "comm", "kernel_task"),
+		metric.NewLabels("pid", "3", "comm", "WindowServer", "user", "me"),
+		metric.NewLabels("pid", "4", "comm", "", "user", "me"),
+	}
+	for ts := int64(0); ts <= 60_000; ts += 1000 {
+		for i, ls := range procs {
+			st.Append(metric.Sample{Name: "cpu_seconds", Labels: ls, Timestamp: ts, Value: float64(ts/1000) * float64(i+1)})
+		}
+		st.Append(metric.Sample{Name: "load", Timestamp: ts, Value: 1})
+	}
+	return st
+}
+
+func pids(t *testing.T, series []*history.Series, err error) string {
+	t.Helper()
+	if err != nil {
+		t.Fatal(err)
+	}
+	var s string
+	for _, x := range series {
+		s += x.Labels().Get("pid") + ","
+	}
+	return s
+}
+
+func TestSelect(t *testing.T) {
+	st := store()
+	name := MustMatcher(MatchEqual, history.NameLabel, "cpu_seconds")
+	for _, tc := range []struct {
+		m    *Matcher
+		want string
+	}{
+		{MustMatcher(MatchEqual, "comm", "launchd"), "1,"},
+		{MustMatcher(MatchNotEqual, "comm", "launchd"), "2,3,4,"},
+		{MustMatcher(MatchRegexp, "comm", "k.*|Window.*"), "2,3,"},
+		// Regexps are anchored.
+		{MustMatcher(MatchRegexp, "comm", "aunch"), ""},
+		{MustMatcher(MatchNotRegexp, "comm", "k.*"), "1,3,4,"},
+		// A missing label reads as empty, so these select on absence.
+		{MustMatcher(MatchEqual, "user", ""), "1,2,"},
+		{MustMatcher(MatchEqual, "comm", ""), "4,"},
+		{MustMatcher(MatchNotEqual, "user", ""), "3,4,"},
+		{MustMatcher(MatchRegexp, "user", "me|"), "1,2,3,4,"},
+	} {
+		got, err := Select(st, name, tc.m)
+		if s := pids(t, got, err); s != tc.want {
+			t.Errorf("%s: got pids %q, want %q", tc.m, s, tc.want)
+		}
+	}
+
+	// Without the name, a selecting label matcher alone is enough.
+	got, err := Select(st, MustMatcher(MatchEqual, "user", "me"))
+	if s := pids(t, got, err); s != "3,4," {
+		t.Errorf("user=me: %q", s)
+	}
+	for _, ms := range [][]*Matcher{
+		nil,
+		{MustMatcher(MatchNotEqual, "comm", "launchd")},
+		{MustMatcher(MatchRegexp, "comm", ".*"), MustMatcher(MatchEqual, "user", "")},
+	} {
+		if _, err := Select(st, ms...); !errors.Is(err, ErrNoSelectingMatcher) {
+			t.Errorf("%v: %v", ms, err)
+		}
+	}
+	if _, err := NewMatcher(MatchRegexp, "comm", "("); err == nil {
+		t.Error("bad regexp accepted")
+	}
+}
+
+func exec(t *testing.T, st *history.Store, q *Query) []history.Point {
+	t.Helper()
+	if q.Matchers == nil {
+		q.Matchers = []*Matcher{MustMatcher(MatchEqual, history.NameLabel, "load")}
+	}
+	res, err := Exec(st, q)
+	if err != nil {
+		t.Fatal(err)
+	}
+	if len(res) != 1 {
+		t.Fatalf("%d series", len(res))
+	}
+	return res[0].Points
+}
+
+func times(pts []history.Point) []int64 {
+	ts := make([]int64, len(pts))
+	for i, p := range pts {
+		ts[i] = p.T
+	}
+	return ts
+}
+
+func TestStepAlignment(t *testing.T) {
+	st := store()
+	for _, tc := range []struct {
+		start, end int64
+		step       time.Duration
+		want       []int64
+	}{
+		// Steps sit on multiples of Step, never before Start.
+		{1001, 25_000, 10 * time.Second, []int64{10_000, 20_000}},
+		{10_000, 30_000, 10 * time.Second, []int64{10_000, 20_000, 30_000}},
+		// -1000 is a step too, but without samples in its window.
+		{-1500, 1000, time.Second, []int64{0, 1000}},
+		// Zero and negative steps evaluate at End only.
+		{0, 30_500, 0, []int64{30_500}},
+		{0, 30_500, -time.Second, []int64{30_500}},
+	} {
+		got := times(exec(t, st, &Query{Start: tc.start, End: tc.end, Step: tc.step, Range: time.Minute}))
+		if !equal(got, tc.want) {
+			t.Errorf("[%d, %d] step %v: %v, want %v", tc.start, tc.end, tc.step, got, tc.want)
+		}
+	}
+	if _, err := Exec(st, &Query{Start: 2, End: 1}); !errors.Is(err, ErrBadRange) {
+		t.Errorf("end before start: %v", err)
+	}
+}
+
+func equal(a, b []int64) bool {
+	if len(a) != len(b) {
+		return false
+	}
+	for i := range a {
+		if a[i] != b[i] {
+			return false
+		}
+	}
+	return true
+}
+
+func TestRateAcrossReset(t *testing.T) {
+	st := history.New(history.Options{})
+	// +10/s, then a restart at 30 s to 5, then +10/s again.
+	for ts := int64(0); ts <= 60_000; ts += 1000 {
+		v := float64(ts / 100)
+		if ts >= 30_000 {
+			v = 5 + float64((ts-30_000)/100)
+		}
+		st.Append(metric.Sample{Name: "bytes", Kind: metric.Counter, Timestamp: ts, Value: v})
+	}
+	pts := exec(t, st, &Query{
+		Matchers: []*Matcher{MustMatcher(MatchEqual, history.NameLabel, "bytes")},
+		Start:    20_000, End: 40_000, Step: 10 * time.Second, Range: 10 * time.Second, Func: FuncRate,
+	})
+	// The window (20 s, 30 s] holds samples from 21 s on: eight increases
+	// of 10, then the reset to 5, which counts as an increase of 5.
+	want := []float64{10, (8*10 + 5) / 9.0, 10}
+	if len(pts) != len(want) {
+		t.Fatalf("points %v", pts)
+	}
+	for i, p := range pts {
+		if math.Abs(p.V-want[i]) > 1e-9 {
+			t.Errorf("rate at %d = %v, want %v", p.T, p.V, want[i])
+		}
+	}
+}
+
+func TestQuantile(t *testing.T) {
+	st := history.New(history.Options{})
+	for i, v := range []float64{4, 1, 3, 2} {
+		st.Append(metric.Sample{Name: "temp", Timestamp: int64(i+1) * 1000, Value: v})
+	}
+	m := []*Matcher{MustMatcher(MatchEqual, history.NameLabel, "temp")}
+	for q, want := range map[float64]float64{0: 1, 0.5: 2.5, 0.9: 3.7, 1: 4} {
+		pts := exec(t, st, &Query{Matchers: m, End: 4000, Range: 10 * time.Second, Func: FuncQuantile, Quantile: q})
+		if math.Abs(pts[0].V-want) > 1e-9 {
+			t.Errorf("q%v = %v, want %v", q, pts[0].V, want)
+		}
+	}
+	if _, err := Exec(st, &Query{Matchers: m, Func: FuncQuantile, Quantile: 1.5}); !errors.Is(err, ErrBadQuantile) {
+		t.Errorf("quantile 1.5: %v", err)
+	}
+}
+
+// benchStore holds 50k process series with ten minutes of 10 s samples,
+// the size the latency target is set for. Each comm value is shared by 20
+// of them.
+func benchStore() *history.Store {
+	const series = 50_000
+	st := history.New(history.Options{})
+	batch := make([]metric.Sample, series)
+	for p := range batch {
+		batch[p] = metric.Sample{
+			Name: "dmetrics_process_cpu_seconds_total", Kind: metric.Counter,
+			Labels: metric.NewLabels("comm", "c"+strconv.Itoa(p%2500), "pid", strconv.Itoa(p)),
+		}
+	}
+	for i := int64(0); i < 60; i++ {
+		for p := range batch {
+			batch[p].Timestamp = i * 10_000
+			batch[p].Value = float64(i) * float64(p%7)
+		}
+		st.Append(batch...)
+	}
+	return st
+}
+
+func BenchmarkSelect(b *testing.B) {
+	st := benchStore()
+	ms := []*Matcher{
+		MustMatcher(MatchEqual, history.NameLabel, "dmetrics_process_cpu_seconds_total"),
+		MustMatcher(MatchRegexp, "comm", "c4[0-9]"),
+		MustMatcher(MatchNotEqual, "pid", "40"),
+	}
+	b.ResetTimer()
+	for i := 0; i < b.N; i++ {
+		if _, err := Select(st, ms...); err != nil {
+			b.Fatal(err)
+		}
+	}
+}
+
+// BenchmarkExec selects 20 of the 50k series and evaluates a rate at 21
+// steps, the dashboard query the 10 ms latency target is set for.
+func BenchmarkExec(b *testing.B) {
+	st := benchStore()
+	q := &Query{
+		Matchers: []*Matcher{
+			MustMatcher(MatchEqual, history.NameLabel, "dmetrics_process_cpu_seconds_total"),
+			MustMatcher(MatchEqual, "comm", "c42"),
+		},
+		Start: 0, End: 600_000, Step: 30 * time.Second, Range: time.Minute, Func: FuncRate,
+	}
+	b.ResetTimer()
+	var n int
+	for i := 0; i < b.N; i++ {
+		res, err := Exec(st, q)
+		if err != nil {
+			b.Fatal(err)
+		}
+		n = len(res)
+	}
+	b.ReportMetric(float64(n), "series")
+}
@@ -0,0 +1,99 @@
+package query
+
+import (
+	"errors"
+	"slices"
+	"sort"
+
+	"github.com/sm-moshi/dmetrics-go/history"
+)
+
+// ErrNoSelectingMatcher is returned for matcher sets that would select every
+// series, i.e. where each matcher also matches the empty value.
+var ErrNoSelectingMatcher = errors.New("query: at least one matcher must not match the empty value")
+
+// Select returns the series of the store matching all matchers. Matchers
+// that cannot match an absent label are resolved through the store's
+// postings index; only the candidates left are checked against the rest.
+func Select(st *history.Store, matchers ...*Matcher) ([]*history.Series, error) {
+	var lists [][]uint32
+	var filters []*Matcher
+	for _, m := range matchers {
+		if m.Matches("") {
+			filters = append(filters, m)
+			continue
+		}
+		lists = append(lists, postings(st, m))
+	}
+	if len(lists) == 0 {
+		return nil, ErrNoSelectingMatcher
+	}
+
+	// Intersect starting from the shortest list, which bounds the work.
+	sort.Slice(lists, func(i, j int) bool { return len(lists[i]) < len(lists[j]) })
+	ids := lists[0]
+	for _, l := range lists[1:] {
+		if len(ids) == 0 {
+			break
+		}
+		ids = intersect(ids, l)
+	}
+
+	out := make([]*history.Series, 0, len(ids))
+	for _, id := range ids {
+		s := st.SeriesByID(id)
+		if s != nil && matchesAll(s, filters) {
+			out = append(out, s)
+		}
+	}
+	return out, nil
+}
+
+// postings returns the sorted ids of the series selected by a matcher that
+// does not match the empty value.
+func postings(st *history.Store, m *Matcher) []uint32 {
+	if m.Type == MatchEqual {
+		return st.Postings(m.Name, m.Value)
+	}
+	var ids []uint32
+	st.LabelValues(m.Name, func(v string, l []uint32) bool {
+		if m.Matches(v) {
+			ids = append(ids, l...)
+		}
+		return true
+	})
+	slices.Sort(ids)
+	return slices.Compact(ids)
+}
+
+// intersect returns the ids in both sorted lists. The result never aliases
+// b, which may belong to the store.
+func intersect(a, b []uint32) []uint32 {
+	out := make([]uint32, 0, min(len(a), len(b)))
+	for i, j := 0, 0; i < len(a) && j < len(b); {
+		switch {
+		case a[i] < b[j]:
+			i++
+		case a[i] > b[j]:
+			j++
+		default:
+			out = append(out, a[i])
+			i++
+			j++
+		}
+	}
+	return out
+}
+
+func matchesAll(s *history.Series, ms []*Matcher) bool {
+	for _, m := range ms {
+		v := s.Labels().Get(m.Name)
+		if m.Name == history.NameLabel {
+			v = s.Name()
+		}
+		if !m.Matches(v) {
+			return false
+		}
+	}
+	return true
+}
@@ -0,0 +1,161 @@
+package remotewrite
+
+import (
+	"github.com/sm-moshi/dmetrics-go/internal/protowire"
+	"github.com/sm-moshi/dmetrics-go/metric"
+)
+
+// Field numbers from prometheus/prompb (remote.proto, types.proto).
+const (
+	fieldWriteRequestTimeseries = 1
+	fieldTimeSeriesLabels       = 1
+	fieldTimeSeriesSamples      = 2
+	fieldLabelName              = 1
+	fieldLabelValue             = 2
+	fieldSampleValue            = 1
+	fieldSampleTimestamp        = 2
+
+	nameLabel = "__name__"
+)
+
+// writeRequest encodes batches of samples into a prompb.WriteRequest. Samples
+// of the same series are grouped into one TimeSeries, keeping their order.
+// All state is reused between batches.
+type writeRequest struct {
+	buf []byte
+
+	index  map[uint64]int32
+	first  []int32 // per series: index of its first sample in the batch
+	ids    []int32 // per sample: series id
+	starts []int32 // per series: offset of its samples in order, plus end
+	cursor []int32
+	order  []int32 // sample indices grouped by series
+}
+
+func newWriteRequest() *writeRequest {
+	return &writeRequest{index: make(map[uint64]int32)}
+}
+
+// encode returns the marshalled request. The slice is only valid until the
+// next call.
+func (w *writeRequest) encode(batch []metric.Sample) []byte {
+	w.group(batch)
+
+	b := w.buf[:0]
+	for sid := range w.first {
+		samples := w.order[w.starts[sid]:w.starts[sid+1]]
+		head := &batch[samples[0]]
+
+		size := labelsSize(head.Name, head.Labels)
+		for _, i := range samples {
+			size += protowire.BytesFieldSize(fieldTimeSeriesSamples, sampleSize(&batch[i]))
+		}
+		b = protowire.AppendMessageHeader(b, fieldWriteRequestTimeseries, size)
+		b = appendLabels(b, head.Name, head.Labels)
+		for _, i := range samples {
+			s := &batch[i]
+			b = protowire.AppendMessageHeader(b, fieldTimeSeriesSamples, sampleSize(s))
+			b = protowire.AppendDoubleField(b, fieldSampleValue, s.Value)
+			b = protowire.AppendVarintField(b, fieldSampleTimestamp, uint64(s.Timestamp))
+		}
+	}
+	w.buf = b
+	return b
+}
+
+// group assigns every sample a series id and lays the sample indices out
+// series by series in w.order, with w.starts holding the offsets.
+func (w *writeRequest) group(batch []metric.Sample) {
+	clear(w.index)
+	w.first = w.first[:0]
+	w.ids = w.ids[:0]
+
+	for i := range batch {
+		s := &batch[i]
+		h := s.SeriesHash()
+		sid, ok := w.index[h]
+		if ok {
+			f := &batch[w.first[sid]]
+			ok = f.Name == s.Name && f.Labels.Equal(s.Labels)
+		}
+		if !ok {
+			// New series, or a hash collision which simply gets its own
+			// TimeSeries entry.
+			sid = int32(len(w.first))
+			w.first = append(w.first, int32(i))
+			w.index[h] = sid
+		}
+		w.ids = append(w.ids, sid)
+	}
+
+	// Counting sort by series id, stable so timestamps stay in order.
+	n := len(w.first)
+	w.starts = resize(w.starts, n+1)
+	clear(w.starts)
+	for _, sid := range w.ids {
+		w.starts[sid+1]++
+	}
+	for i := 1; i <= n; i++ {
+		w.starts[i] += w.starts[i-1]
+	}
+	w.cursor = append(resize(w.cursor, 0), w.starts[:n]...)
+	w.order = resize(w.order, len(batch))
+	for i, sid := range w.ids {
+		w.order[w.cursor[sid]] = int32(i)
+		w.cursor[sid]++
+	}
+}
+
+func resize(s []int32, n int) []int32 {
+	if cap(s) < n {
+		return make([]int32, n)
+	}
+	return s[:n]
+}
+
+func labelSize(name, value string) int {
+	return protowire.BytesFieldSize(fieldLabelName, len(name)) +
+		protowire.BytesFieldSize(fieldLabelValue, len(value))
+}
+
+func labelsSize(name string, ls metric.Labels) int {
+	size := protowire.BytesFieldSize(fieldTimeSeriesLabels, labelSize(nameLabel, name))
+	for _, l := range ls {
+		if l.Name == nameLabel {
+			continue
+		}
+		size += protowire.BytesFieldSize(fieldTimeSeriesLabels, labelSize(l.Name, l.Value))
+	}
+	return size
+}
+
+// appendLabels writes the series labels with __name__ merged in at its
+// sorted position, as receivers require label names in order.
+func appendLabels(b []byte, name string, ls metric.Labels) []byte {
+	named := false
+	for _, l := range ls {
+		if l.Name == nameLabel {
+			continue
+		}
+		if !named && l.Name > nameLabel {
+			b = appendLabel(b, nameLabel, name)
+			named = true
+		}
+		b = appendLabel(b, l.Name, l.Value)
+	}
+	if !named {
+		b = appendLabel(b, nameLabel, name)
+	}
+	return b
+}
+
+func appendLabel(b []byte, name, value string) []byte {
+	b = protowire.AppendMessageHeader(b, fieldTimeSeriesLabels, labelSize(name, value))
+	b = protowire.AppendBytesField(b, fieldLabelName, name)
+	return protowire.AppendBytesField(b, fieldLabelValue, value)
+}
+
+func sampleSize(s *metric.Sample) int {
+	return protowire.DoubleFieldSize(fieldSampleValue) +
+		protowire.VarintFieldSize(fieldSampleTimestamp, uint64(s.Timestamp))
+}
@@ -0,0 +1,202 @@
+// Package remotewrite pushes collected samples to a Prometheus remote_write
+// endpoint, for hosts that cannot be scraped (e.g. behind NAT).
+//
+// Samples are spread over a fixed number of shards by series, so each series
+// stays in order. Every shard owns a bounded in-memory queue and a sender
+// that batches samples into snappy-compressed protobuf WriteRequests and
+// retries recoverable failures with exponential backoff.
+package remotewrite
+
+import (
+	"context"
+	"errors"
+	"net/http"
+	"sync"
+	"sync/atomic"
+	"time"
+
+	"github.com/sm-moshi/dmetrics-go/metric"
+)
+
+// Defaults applied by New to zero Config fields.
+const (
+	DefaultShards            = 4
+	DefaultQueueCapacity     = 10_000
+	DefaultMaxSamplesPerSend = 2_000
+	DefaultBatchSendDeadline = 5 * time.Second
+	DefaultMinBackoff        = 30 * time.Millisecond
+	DefaultMaxBackoff        = 5 * time.Second
+	DefaultMaxRetries        = 10
+	DefaultTimeout           = 30 * time.Second
+)
+
+var (
+	// ErrNoURL is returned by New when Config.URL is empty.
+	ErrNoURL = errors.New("remotewrite: no URL configured")
+	// ErrClosed is returned by Close when the exporter was already closed.
+	ErrClosed = errors.New("remotewrite: exporter closed")
+)
+
+// Config configures an Exporter. Zero fields take the Default* values.
+type Config struct {
+	// URL is the remote_write endpoint, e.g. http://host:9090/api/v1/write.
+	URL string
+	// Client sends the requests. Defaults to a client with DefaultTimeout.
+	Client *http.Client
+	// Headers are added to every request, e.g. for authentication.
+	Headers map[string]string
+
+	// Shards is the number of parallel senders.
+	Shards int
+	// QueueCapacity bounds the samples buffered per shard. Samples appended
+	// to a full shard are dropped and counted in Stats.
+	QueueCapacity int
+	// MaxSamplesPerSend caps the samples in one WriteRequest.
+	MaxSamplesPerSend int
+	// BatchSendDeadline is how long a partial batch waits before it is sent.
+	BatchSendDeadline time.Duration
+
+	// MinBackoff and MaxBackoff bound the delay between retries, which
+	// doubles after every failed attempt.
+	MinBackoff time.Duration
+	MaxBackoff time.Duration
+	// MaxRetries is the number of retries before a batch is given up.
+	MaxRetries int
+}
+
+func (c *Config) setDefaults() {
+	if c.Client == nil {
+		c.Client = &http.Client{Timeout: DefaultTimeout}
+	}
+	setDefault(&c.Shards, DefaultShards)
+	setDefault(&c.QueueCapacity, DefaultQueueCapacity)
+	setDefault(&c.MaxSamplesPerSend, DefaultMaxSamplesPerSend)
+	setDefault(&c.BatchSendDeadline, DefaultBatchSendDeadline)
+	setDefault(&c.MinBackoff, DefaultMinBackoff)
+	setDefault(&c.MaxBackoff, DefaultMaxBackoff)
+	setDefault(&c.MaxRetries, DefaultMaxRetries)
+}
+
+func setDefault[T int | time.Duration](v *T, def T) {
+	if *v <= 0 {
+		*v = def
+	}
+}
+
+// Stats are cumulative counters of an Exporter.
+type Stats struct {
+	// SamplesSent were accepted by the receiver.
+	SamplesSent uint64
+	// SamplesDropped were rejected by Append because their shard was full.
+	SamplesDropped uint64
+	// SamplesFailed were given up after a non-recoverable error or after
+	// MaxRetries.
+	SamplesFailed uint64
+	// Retries counts resent requests.
+	Retries uint64
+}
+
+type stats struct {
+	sent, dropped, failed, retries atomic.Uint64
+}
+
+// Exporter queues samples and ships them to a remote_write endpoint.
+type Exporter struct {
+	cfg    Config
+	shards []*shard
+	stats  stats
+
+	mu     sync.RWMutex // guards closed against concurrent Append
+	closed bool
+
+	cancel context.CancelFunc
+	wg     sync.WaitGroup
+}
+
+// New starts an Exporter and its shard senders.
+func New(cfg Config) (*Exporter, error) {
+	if cfg.URL == "" {
+		return nil, ErrNoURL
+	}
+	cfg.setDefaults()
+
+	ctx, cancel := context.WithCancel(context.Background())
+	e := &Exporter{cfg: cfg, cancel: cancel}
+	e.shards = make([]*shard, cfg.Shards)
+	for i := range e.shards {
+		e.shards[i] = newShard(e)
+	}
+	e.wg.Add(len(e.shards))
+	for _, s := range e.shards {
+		go func(s *shard) {
+			defer e.wg.Done()
+			s.run(ctx)
+		}(s)
+	}
+	return e, nil
+}
+
+// Append queues samples for sending and returns how many were dropped
+// because their shard queue was full. It never blocks. The samples' label
+// slices must not be modified afterwards.
+func (e *Exporter) Append(samples ...metric.Sample) int {
+	e.mu.RLock()
+	defer e.mu.RUnlock()
+	if e.closed {
+		e.stats.dropped.Add(uint64(len(samples)))
+		return len(samples)
+	}
+
+	dropped := 0
+	n := uint64(len(e.shards))
+	for i := range samples {
+		s := e.shards[samples[i].SeriesHash()%n]
+		select {
+		case s.queue <- samples[i]:
+		default:
+			dropped++
+		}
+	}
+	e.stats.dropped.Add(uint64(dropped))
+	return dropped
+}
+
+// Close stops accepting samples and flushes what is queued. If ctx ends
+// first, in-flight sends are aborted and the remaining samples are lost.
+func (e *Exporter) Close(ctx context.Context) error {
+	e.mu.Lock()
+	if e.closed {
+		e.mu.Unlock()
+		return ErrClosed
+	}
+	e.closed = true
+	for _, s := range e.shards {
+		close(s.queue)
+	}
+	e.mu.Unlock()
+
+	done := make(chan struct{})
+	go func() {
+		e.wg.Wait()
+		close(done)
+	}()
+	select {
+	case <-done:
+		e.cancel()
+		return nil
+	case <-ctx.Done():
+		e.cancel()
+		<-done
+		return ctx.Err()
+	}
+}
+
+// Stats returns a snapshot of the exporter's counters.
+func (e *Exporter) Stats() Stats {
+	return Stats{
+		SamplesSent:    e.stats.sent.Load(),
+		SamplesDropped: e.stats.dropped.Load(),
+		SamplesFailed:  e.stats.failed.Load(),
+		Retries:        e.stats.retries.Load(),
+	}
+}
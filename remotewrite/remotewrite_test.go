@@ -0,0 +1,285 @@
+package remotewrite
+
+import (
+	"context"
+	"errors"
+	"io"
+	"math"
+	"net/http"
+	"net/http/httptest"
+	"strconv"
+	"sync"
+	"sync/atomic"
+	"testing"
+	"time"
+
+	"github.com/sm-moshi/dmetrics-go/internal/protowire"
+	"github.com/sm-moshi/dmetrics-go/internal/snappy"
+	"github.com/sm-moshi/dmetrics-go/metric"
+)
+
+// receivedSample is one sample as decoded by the test receiver, with the
+// series rendered as name{labels} for comparison.
+type receivedSample struct {
+	series string
+	value  float64
+	ts     int64
+}
+
+// decodeWriteRequest snappy-decodes and proto-decodes a WriteRequest body.
+func decodeWriteRequest(t testing.TB, body []byte) []receivedSample {
+	t.Helper()
+	raw, err := snappy.Decode(body)
+	if err != nil {
+		t.Fatalf("snappy: %v", err)
+	}
+	var out []receivedSample
+	for b := raw; len(b) > 0; {
+		f, rest, err := protowire.ConsumeField(b)
+		if err != nil || f.Num != fieldWriteRequestTimeseries || f.Type != protowire.TypeBytes {
+			t.Fatalf("WriteRequest field %+v: %v", f, err)
+		}
+		b = rest
+		out = append(out, decodeTimeSeries(t, f.Bytes)...)
+	}
+	return out
+}
+
+func decodeTimeSeries(t testing.TB, b []byte) []receivedSample {
+	var (
+		series  string
+		prev    string
+		samples []receivedSample
+	)
+	for len(b) > 0 {
+		f, rest, err := protowire.ConsumeField(b)
+		if err != nil {
+			t.Fatal(err)
+		}
+		b = rest
+		switch f.Num {
+		case fieldTimeSeriesLabels:
+			name, value := decodePair(t, f.Bytes, fieldLabelName, fieldLabelValue)
+			if name <= prev {
+				t.Fatalf("label %q not after %q", name, prev)
+			}
+			prev = name
+			series += name + "=" + value + ","
+		case fieldTimeSeriesSamples:
+			var s receivedSample
+			for sb := f.Bytes; len(sb) > 0; {
+				sf, srest, err := protowire.ConsumeField(sb)
+				if err != nil {
+					t.Fatal(err)
+				}
+				sb = srest
+				switch sf.Num {
+				case fieldSampleValue:
+					s.value = math.Float64frombits(sf.Value)
+				case fieldSampleTimestamp:
+					s.ts = int64(sf.Value)
+				}
+			}
+			samples = append(samples, s)
+		default:
+			t.Fatalf("unexpected TimeSeries field %d", f.Num)
+		}
+	}
+	for i := range samples {
+		samples[i].series = series
+	}
+	return samples
+}
+
+func decodePair(t testing.TB, b []byte, nameField, valueField int) (name, value string) {
+	for len(b) > 0 {
+		f, rest, err := protowire.ConsumeField(b)
+		if err != nil {
+			t.Fatal(err)
+		}
+		b = rest
+		switch f.Num {
+		case nameField:
+			name = string(f.Bytes)
+		case valueField:
+			value = string(f.Bytes)
+		}
+	}
+	return name, value
+}
+
+// receiver is an in-process remote_write endpoint.
+type receiver struct {
+	t        testing.TB
+	mu       sync.Mutex
+	samples  []receivedSample
+	requests atomic.Int32
+	// failFirst answers the first n requests with 503.
+	failFirst int32
+}
+
+func (r *receiver) ServeHTTP(w http.ResponseWriter, req *http.Request) {
+	n := r.requests.Add(1)
+	if req.Header.Get("Content-Encoding") != "snappy" || req.Header.Get("Content-Type") != "application/x-protobuf" {
+		r.t.Errorf("headers %v", req.Header)
+	}
+	if n <= r.failFirst {
+		w.WriteHeader(http.StatusServiceUnavailable)
+		return
+	}
+	body, err := io.ReadAll(req.Body)
+	if err != nil {
+		r.t.Error(err)
+		return
+	}
+	got := decodeWriteRequest(r.t, body)
+	r.mu.Lock()
+	r.samples = append(r.samples, got...)
+	r.mu.Unlock()
+	w.WriteHeader(http.StatusNoContent)
+}
+
+func testSamples(series, perSeries int) []metric.Sample {
+	out := make([]metric.Sample, 0, series*perSeries)
+	for i := 0; i < perSeries; i++ {
+		for s := 0; s < series; s++ {
+			out = append(out, metric.Sample{
+				Name:      "dmetrics_test",
+				Labels:    metric.NewLabels("core", strconv.Itoa(s), "host", "a"),
+				Value:     float64(s*perSeries + i),
+				Timestamp: int64(1000 + i),
+			})
+		}
+	}
+	return out
+}
+
+func TestExporterDelivers(t *testing.T) {
+	rcv := &receiver{t: t, failFirst: 2}
+	srv := httptest.NewServer(rcv)
+	defer srv.Close()
+
+	e, err := New(Config{
+		URL:               srv.URL,
+		Shards:            3,
+		MaxSamplesPerSend: 50,
+		BatchSendDeadline: 10 * time.Millisecond,
+		MinBackoff:        time.Millisecond,
+	})
+	if err != nil {
+		t.Fatal(err)
+	}
+	in := testSamples(20, 30)
+	if dropped := e.Append(in...); dropped != 0 {
+		t.Fatalf("dropped %d", dropped)
+	}
+	if err := e.Close(context.Background()); err != nil {
+		t.Fatal(err)
+	}
+
+	st := e.Stats()
+	if st.SamplesSent != uint64(len(in)) || st.SamplesFailed != 0 || st.Retries < 2 {
+		t.Fatalf("stats %+v", st)
+	}
+	if len(rcv.samples) != len(in) {
+		t.Fatalf("received %d samples, want %d", len(rcv.samples), len(in))
+	}
+	// Every series arrives complete and in timestamp order, with __name__
+	// merged in at its sorted position.
+	last := make(map[string]int64)
+	for _, s := range rcv.samples {
+		if s.ts <= last[s.series] {
+			t.Fatalf("series %s out of order at %d", s.series, s.ts)
+		}
+		last[s.series] = s.ts
+	}
+	if len(last) != 20 {
+		t.Fatalf("got %d series", len(last))
+	}
+	for series := range last {
+		if want := "__name__=dmetrics_test,core="; series[:len(want)] != want {
+			t.Fatalf("series %q", series)
+		}
+	}
+}
+
+func TestExporterSendsPartialBatchAtDeadline(t *testing.T) {
+	rcv := &receiver{t: t}
+	srv := httptest.NewServer(rcv)
+	defer srv.Close()
+
+	e, err := New(Config{URL: srv.URL, Shards: 1, MaxSamplesPerSend: 4, BatchSendDeadline: 20 * time.Millisecond})
+	if err != nil {
+		t.Fatal(err)
+	}
+	defer func() { _ = e.Close(context.Background()) }()
+	// Two full batches go out by size, the last sample by deadline, and
+	// then one more after the shard went idle.
+	e.Append(testSamples(1, 9)...)
+	waitSent(t, e, 9)
+	e.Append(testSamples(1, 1)...)
+	waitSent(t, e, 10)
+	if n := rcv.requests.Load(); n != 4 {
+		t.Fatalf("%d requests, want 4", n)
+	}
+}
+
+// waitSent waits for the exporter to have sent n samples without Close.
+func waitSent(t *testing.T, e *Exporter, n uint64) {
+	t.Helper()
+	deadline := time.Now().Add(5 * time.Second)
+	for e.Stats().SamplesSent < n {
+		if time.Now().After(deadline) {
+			t.Fatalf("sent %d of %d samples", e.Stats().SamplesSent, n)
+		}
+		time.Sleep(time.Millisecond)
+	}
+}
+
+func TestExporterGivesUpOnClientError(t *testing.T) {
+	srv := httptest.NewServer(http.HandlerFunc(func(w http.ResponseWriter, _ *http.Request) {
+		w.WriteHeader(http.StatusBadRequest)
+	}))
+	defer srv.Close()
+	e, err := New(Config{URL: srv.URL, Shards: 1, BatchSendDeadline: time.Millisecond})
+	if err != nil {
+		t.Fatal(err)
+	}
+	e.Append(testSamples(1, 5)...)
+	if err := e.Close(context.Background()); err != nil {
+		t.Fatal(err)
+	}
+	if st := e.Stats(); st.SamplesFailed != 5 || st.Retries != 0 {
+		t.Fatalf("stats %+v", st)
+	}
+	if err := e.Close(context.Background()); !errors.Is(err, ErrClosed) {
+		t.Fatalf("second Close: %v", err)
+	}
+}
+
+func BenchmarkSend(b *testing.B) {
+	srv := httptest.NewServer(http.HandlerFunc(func(w http.ResponseWriter, r *http.Request) {
+		_, _ = io.Copy(io.Discard, r.Body)
+		w.WriteHeader(http.StatusNoContent)
+	}))
+	defer srv.Close()
+	samples := testSamples(100, 100)
+	b.ReportAllocs()
+	b.ResetTimer()
+	start := time.Now()
+	for i := 0; i < b.N; i++ {
+		e, err := New(Config{URL: srv.URL, BatchSendDeadline: time.Millisecond})
+		if err != nil {
+			b.Fatal(err)
+		}
+		for off := 0; off < len(samples); off += 1000 {
+			if e.Append(samples[off:off+1000]...) != 0 {
+				b.Fatal("dropped")
+			}
+		}
+		if err := e.Close(context.Background()); err != nil {
+			b.Fatal(err)
+		}
+	}
+	b.ReportMetric(float64(b.N*len(samples))/time.Since(start).Seconds(), "samples/s")
+}
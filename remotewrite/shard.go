@@ -0,0 +1,147 @@
+package remotewrite
+
+import (
+	"bytes"
+	"context"
+	"errors"
+	"fmt"
+	"io"
+	"net/http"
+	"time"
+
+	"github.com/sm-moshi/dmetrics-go/internal/snappy"
+	"github.com/sm-moshi/dmetrics-go/metric"
+)
+
+const userAgent = "dmetrics-go/remotewrite"
+
+// recoverableError marks failures worth retrying: transport errors, 5xx and
+// 429 responses.
+type recoverableError struct{ err error }
+
+func (e recoverableError) Error() string { return e.err.Error() }
+func (e recoverableError) Unwrap() error { return e.err }
+
+// shard batches and sends the samples of a subset of series. Its buffers are
+// reused for every batch.
+type shard struct {
+	e     *Exporter
+	queue chan metric.Sample
+	batch []metric.Sample
+	req   *writeRequest
+	enc   snappy.Encoder
+}
+
+func newShard(e *Exporter) *shard {
+	return &shard{
+		e:     e,
+		queue: make(chan metric.Sample, e.cfg.QueueCapacity),
+		batch: make([]metric.Sample, 0, e.cfg.MaxSamplesPerSend),
+		req:   newWriteRequest(),
+	}
+}
+
+// run sends a batch whenever it is full or BatchSendDeadline has passed
+// since its first sample, until the queue is closed and drained.
+func (s *shard) run(ctx context.Context) {
+	// The timer is only ever Reset, never stopped and drained, which is
+	// fragile across timer implementations. A fire left over from a batch
+	// already sent by size is told apart by the deadline.
+	timer := time.NewTimer(s.e.cfg.BatchSendDeadline)
+	defer timer.Stop()
+	var deadline time.Time
+
+	for {
+		select {
+		case sample, ok := <-s.queue:
+			if !ok {
+				s.flush(ctx)
+				return
+			}
+			if len(s.batch) == 0 {
+				deadline = time.Now().Add(s.e.cfg.BatchSendDeadline)
+				timer.Reset(s.e.cfg.BatchSendDeadline)
+			}
+			s.batch = append(s.batch, sample)
+			if len(s.batch) >= s.e.cfg.MaxSamplesPerSend {
+				s.flush(ctx)
+			}
+		case now := <-timer.C:
+			switch {
+			case len(s.batch) == 0:
+			case now.Before(deadline):
+				timer.Reset(deadline.Sub(now))
+			default:
+				s.flush(ctx)
+			}
+		}
+	}
+}
+
+func (s *shard) flush(ctx context.Context) {
+	if len(s.batch) == 0 {
+		return
+	}
+	n := uint64(len(s.batch))
+	if err := s.sendWithRetry(ctx, s.enc.Encode(s.req.encode(s.batch))); err != nil {
+		s.e.stats.failed.Add(n)
+	} else {
+		s.e.stats.sent.Add(n)
+	}
+	// Drop references to the label slices before the batch is refilled.
+	clear(s.batch)
+	s.batch = s.batch[:0]
+}
+
+func (s *shard) sendWithRetry(ctx context.Context, body []byte) error {
+	backoff := s.e.cfg.MinBackoff
+	for attempt := 0; ; attempt++ {
+		err := s.send(ctx, body)
+		var rerr recoverableError
+		if err == nil || !errors.As(err, &rerr) || attempt >= s.e.cfg.MaxRetries {
+			return err
+		}
+
+		s.e.stats.retries.Add(1)
+		select {
+		case <-time.After(backoff):
+		case <-ctx.Done():
+			return ctx.Err()
+		}
+		backoff = min(2*backoff, s.e.cfg.MaxBackoff)
+	}
+}
+
+func (s *shard) send(ctx context.Context, body []byte) error {
+	req, err := http.NewRequestWithContext(ctx, http.MethodPost, s.e.cfg.URL, bytes.NewReader(body))
+	if err != nil {
+		return err
+	}
+	req.Header.Set("Content-Encoding", "snappy")
+	req.Header.Set("Content-Type", "application/x-protobuf")
+	req.Header.Set("User-Agent", userAgent)
+	req.Header.Set("X-Prometheus-Remote-Write-Version", "0.1.0")
+	for k, v := range s.e.cfg.Headers {
+		req.Header.Set(k, v)
+	}
+
+	resp, err := s.e.cfg.Client.Do(req)
+	if err != nil {
+		if ctx.Err() != nil {
+			return err
+		}
+		return recoverableError{err}
+	}
+	defer resp.Body.Close()
+	// Drain so the connection can be reused.
+	_, _ = io.Copy(io.Discard, resp.Body)
+
+	if resp.StatusCode >= http.StatusOK && resp.StatusCode < http.StatusMultipleChoices {
+		return nil
+	}
+	err = fmt.Errorf("remotewrite: server returned HTTP status %s", resp.Status)
+	if resp.StatusCode >= http.StatusInternalServerError || resp.StatusCode == http.StatusTooManyRequests {
+		return recoverableError{err}
+	}
+	return err
+}
@@ -0,0 +1,132 @@
+package rollup
+
+import (
+	"math"
+	"sync"
+
+	"github.com/sm-moshi/dmetrics-go/metric"
+)
+
+// Set keeps an Aggregator per series and is fed collector samples directly.
+// Series idle for Options.Idle are dropped, so the series of exited
+// processes do not accumulate. It is safe for concurrent use.
+type Set struct {
+	opts Options
+
+	mu     sync.Mutex
+	series map[uint64][]*entry
+	// newest is the latest sample time seen, in ms; sweepAt is when idle
+	// series are next looked for, at most once per window.
+	newest, sweepAt int64
+}
+
+type entry struct {
+	name   string
+	labels metric.Labels
+	agg    *Aggregator
+	lastT  int64 // ms
+}
+
+// NewSet returns an empty Set whose aggregators use opts.
+func NewSet(opts Options) *Set {
+	opts.setDefaults()
+	return &Set{opts: opts, series: make(map[uint64][]*entry)}
+}
+
+// Add updates the aggregators of the samples' series.
+func (s *Set) Add(samples ...metric.Sample) {
+	s.mu.Lock()
+	defer s.mu.Unlock()
+	for i := range samples {
+		sm := &samples[i]
+		e := s.get(sm.SeriesHash(), sm.Name, sm.Labels, true)
+		e.agg.Add(sm.Timestamp, sm.Value)
+		e.lastT = max(e.lastT, sm.Timestamp)
+		s.newest = max(s.newest, sm.Timestamp)
+	}
+	if s.newest >= s.sweepAt {
+		s.sweep()
+	}
+}
+
+// sweep drops the series without samples for Options.Idle.
+func (s *Set) sweep() {
+	idle := s.opts.Idle.Milliseconds()
+	for h, bucket := range s.series {
+		kept := bucket[:0]
+		for _, e := range bucket {
+			if s.newest-e.lastT <= idle {
+				kept = append(kept, e)
+			}
+		}
+		if len(kept) == 0 {
+			delete(s.series, h)
+		} else {
+			clear(bucket[len(kept):])
+			s.series[h] = kept
+		}
+	}
+	s.sweepAt = s.newest + s.opts.Window.Milliseconds()
+}
+
+func (s *Set) get(h uint64, name string, ls metric.Labels, create bool) *entry {
+	for _, e := range s.series[h] {
+		if e.name == name && e.labels.Equal(ls) {
+			return e
+		}
+	}
+	if !create {
+		return nil
+	}
+	e := &entry{name: name, labels: append(metric.Labels(nil), ls...), agg: NewAggregator(s.opts), lastT: math.MinInt64}
+	s.series[h] = append(s.series[h], e)
+	return e
+}
+
+// Latest copies the most recent completed window of the series into dst and
+// reports whether there was one.
+func (s *Set) Latest(name string, ls metric.Labels, dst *Window) bool {
+	s.mu.Lock()
+	defer s.mu.Unlock()
+	e := s.get(metric.SeriesHash(name, ls), name, ls, false)
+	if e == nil {
+		return false
+	}
+	w := e.agg.Completed(0)
+	if w == nil {
+		return false
+	}
+	dst.CopyFrom(w)
+	return true
+}
+
+// Merged folds the retained windows of the series starting within
+// [mint, maxt] into dst and reports whether the series exists.
+func (s *Set) Merged(name string, ls metric.Labels, mint, maxt int64, dst *Window) (bool, error) {
+	s.mu.Lock()
+	defer s.mu.Unlock()
+	e := s.get(metric.SeriesHash(name, ls), name, ls, false)
+	if e == nil {
+		return false, nil
+	}
+	return true, e.agg.Merged(mint, maxt, dst)
+}
+
+// Remove forgets the series, e.g. once its process has exited.
+func (s *Set) Remove(name string, ls metric.Labels) {
+	s.mu.Lock()
+	defer s.mu.Unlock()
+	h := metric.SeriesHash(name, ls)
+	bucket := s.series[h]
+	for i, e := range bucket {
+		if e.name == name && e.labels.Equal(ls) {
+			bucket = append(bucket[:i], bucket[i+1:]...)
+			break
+		}
+	}
+	if len(bucket) == 0 {
+		delete(s.series, h)
+	} else {
+		s.series[h] = bucket
+	}
+}
@@ -0,0 +1,30 @@
+package rollup
+
+import (
+	"testing"
+	"time"
+
+	"github.com/sm-moshi/dmetrics-go/metric"
+)
+
+func TestSetExpiresIdleSeries(t *testing.T) {
+	s := NewSet(Options{Window: time.Second, Keep: 2})
+	live, gone := metric.NewLabels("pid", "1"), metric.NewLabels("pid", "2")
+	s.Add(metric.Sample{Name: "cpu", Labels: live, Value: 1}, metric.Sample{Name: "cpu", Labels: gone, Value: 1})
+	for ts := int64(500); ts <= 10_000; ts += 500 {
+		s.Add(metric.Sample{Name: "cpu", Labels: live, Value: float64(ts), Timestamp: ts})
+		// Idle defaults to the three seconds the windows span, and idle
+		// series are looked for once per window.
+		ok, _ := s.Merged("cpu", gone, 0, ts, &Window{})
+		if ts <= 3000 && !ok || ts >= 4000 && ok {
+			t.Fatalf("at %d ms the idle series exists: %v", ts, ok)
+		}
+	}
+	var w Window
+	if !s.Latest("cpu", live, &w) || w.Start != 9000 || w.Count != 2 {
+		t.Fatalf("live series window %+v", w)
+	}
+	if n := len(s.series); n != 1 {
+		t.Fatalf("%d series kept", n)
+	}
+}
@@ -0,0 +1,226 @@
+// Package rollup summarises series into fixed-length windows holding min,
+// max, sum, count and a mergeable quantile sketch, so p95/p99 alerting over
+// minutes of samples needs neither the raw samples nor their memory.
+package rollup
+
+import (
+	"encoding/binary"
+	"errors"
+	"math"
+)
+
+// Defaults for NewSketch arguments that are out of range.
+const (
+	DefaultAccuracy = 0.01
+	DefaultMaxBins  = 2048
+)
+
+// accuracySize is the size of the encoded accuracy that leads AppendBinary
+// output.
+const accuracySize = 8
+
+// minIndexable is the smallest magnitude with a bucket of its own; anything
+// closer to zero is counted as zero.
+const minIndexable = 1e-9
+
+var (
+	// ErrIncompatible is returned when merging sketches of different
+	// accuracy.
+	ErrIncompatible = errors.New("rollup: sketches have different accuracy")
+	// ErrCorrupt is returned by UnmarshalBinary for malformed input.
+	ErrCorrupt = errors.New("rollup: corrupt sketch encoding")
+)
+
+// Sketch is a DDSketch (Masson et al., VLDB 2019): a quantile sketch with a
+// relative-error guarantee that can be merged losslessly with any other
+// sketch of the same accuracy. Values are counted in logarithmically sized
+// buckets, so an accuracy of 1% needs only a few hundred buckets to cover
+// everything from millidegrees to gigabytes.
+//
+// A Sketch is not safe for concurrent use.
+type Sketch struct {
+	accuracy float64
+	gamma    float64
+	logGamma float64
+	pos, neg store
+	zero     uint64
+}
+
+// NewSketch returns a sketch whose quantiles are within accuracy of the
+// true value, relative to it, using at most maxBins buckets per sign. Memory
+// grows with the range of values actually seen; at 1% accuracy 2048 buckets
+// span sixteen orders of magnitude before the lowest buckets are folded.
+func NewSketch(accuracy float64, maxBins int) *Sketch {
+	s := &Sketch{}
+	s.init(accuracy, maxBins)
+	return s
+}
+
+func (s *Sketch) init(accuracy float64, maxBins int) {
+	if accuracy <= 0 || accuracy >= 1 {
+		accuracy = DefaultAccuracy
+	}
+	if maxBins <= 0 {
+		maxBins = DefaultMaxBins
+	}
+	s.accuracy = accuracy
+	s.gamma = (1 + accuracy) / (1 - accuracy)
+	s.logGamma = math.Log(s.gamma)
+	s.pos.maxBins = maxBins
+	s.neg.maxBins = maxBins
+}
+
+func (s *Sketch) key(v float64) int {
+	return int(math.Ceil(math.Log(v) / s.logGamma))
+}
+
+// value returns the representative of a bucket, which is within accuracy of
+// every value in it.
+func (s *Sketch) value(key int) float64 {
+	return 2 * math.Pow(s.gamma, float64(key)) / (s.gamma + 1)
+}
+
+// Add records one value. NaN is ignored.
+func (s *Sketch) Add(v float64) {
+	switch {
+	case math.IsNaN(v):
+	case v > minIndexable:
+		s.pos.add(s.key(v), 1)
+	case v < -minIndexable:
+		s.neg.add(s.key(-v), 1)
+	default:
+		s.zero++
+	}
+}
+
+// Count returns the number of values recorded.
+func (s *Sketch) Count() uint64 {
+	return s.pos.count + s.neg.count + s.zero
+}
+
+// Quantile returns an estimate of the q-quantile, 0 <= q <= 1, or NaN if the
+// sketch is empty.
+func (s *Sketch) Quantile(q float64) float64 {
+	n := s.Count()
+	if n == 0 || q < 0 || q > 1 {
+		return math.NaN()
+	}
+	rank := q * float64(n-1)
+	if neg := float64(s.neg.count); rank < neg {
+		// Negative values are stored by magnitude, so walk them from the top.
+		return -s.value(s.neg.keyAtRank(neg - 1 - rank))
+	}
+	rank -= float64(s.neg.count)
+	if rank < float64(s.zero) {
+		return 0
+	}
+	return s.value(s.pos.keyAtRank(rank - float64(s.zero)))
+}
+
+// Merge adds the values recorded by o. A zero Sketch takes on the accuracy
+// of o.
+func (s *Sketch) Merge(o *Sketch) error {
+	if s.accuracy == 0 && s.Count() == 0 {
+		s.init(o.accuracy, o.pos.maxBins)
+	}
+	if s.accuracy != o.accuracy {
+		return ErrIncompatible
+	}
+	s.pos.merge(&o.pos)
+	s.neg.merge(&o.neg)
+	s.zero += o.zero
+	return nil
+}
+
+// Reset empties the sketch, keeping its memory.
+func (s *Sketch) Reset() {
+	s.pos.reset()
+	s.neg.reset()
+	s.zero = 0
+}
+
+// CopyFrom makes s an exact copy of o, reusing the memory of s.
+func (s *Sketch) CopyFrom(o *Sketch) {
+	s.accuracy, s.gamma, s.logGamma = o.accuracy, o.gamma, o.logGamma
+	s.pos.copyFrom(&o.pos)
+	s.neg.copyFrom(&o.neg)
+	s.zero = o.zero
+}
+
+// AppendBinary appends a compact encoding of the sketch to b, for merging
+// sketches from other hosts.
+func (s *Sketch) AppendBinary(b []byte) []byte {
+	b = binary.LittleEndian.AppendUint64(b, math.Float64bits(s.accuracy))
+	b = binary.AppendUvarint(b, uint64(s.pos.maxBins))
+	b = binary.AppendUvarint(b, s.zero)
+	b = appendStore(b, &s.pos)
+	return appendStore(b, &s.neg)
+}
+
+func appendStore(b []byte, st *store) []byte {
+	b = binary.AppendVarint(b, int64(st.offset))
+	b = binary.AppendUvarint(b, uint64(len(st.bins)))
+	for _, c := range st.bins {
+		b = binary.AppendUvarint(b, c)
+	}
+	return b
+}
+
+// UnmarshalBinary replaces the contents of s with the decoding of data,
+// as produced by AppendBinary.
+func (s *Sketch) UnmarshalBinary(data []byte) error {
+	if len(data) < accuracySize {
+		return ErrCorrupt
+	}
+	accuracy := math.Float64frombits(binary.LittleEndian.Uint64(data))
+	d := decoder{b: data[accuracySize:]}
+	maxBins := int(d.uvarint())
+	zero := d.uvarint()
+	if d.err != nil || accuracy <= 0 || accuracy >= 1 || maxBins <= 0 {
+		return ErrCorrupt
+	}
+	s.init(accuracy, maxBins)
+	s.zero = zero
+	d.store(&s.pos)
+	d.store(&s.neg)
+	if d.err != nil || len(d.b) != 0 {
+		return ErrCorrupt
+	}
+	return nil
+}
+
+type decoder struct {
+	b   []byte
+	err error
+}
+
+func (d *decoder) uvarint() uint64 {
+	v, k := binary.Uvarint(d.b)
+	if k <= 0 {
+		d.err = ErrCorrupt
+		return 0
+	}
+	d.b = d.b[k:]
+	return v
+}
+
+func (d *decoder) store(st *store) {
+	offset, k := binary.Varint(d.b)
+	if k <= 0 {
+		d.err = ErrCorrupt
+		return
+	}
+	d.b = d.b[k:]
+	n := d.uvarint()
+	if d.err != nil || n > uint64(st.maxBins) || n > uint64(len(d.b)) {
+		d.err = ErrCorrupt
+		return
+	}
+	st.offset = int(offset)
+	st.bins = make([]uint64, n)
+	st.count = 0
+	for i := range st.bins {
+		st.bins[i] = d.uvarint()
+		st.count += st.bins[i]
+	}
+}
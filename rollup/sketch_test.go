@@ -0,0 +1,198 @@
+package rollup
+
+import (
+	"errors"
+	"math"
+	"math/rand"
+	"sort"
+	"testing"
+)
+
+var quantiles = []float64{0, 0.01, 0.25, 0.5, 0.75, 0.9, 0.95, 0.99, 0.999, 1}
+
+// distributions are the value shapes checked for the accuracy guarantee.
+var distributions = map[string]func(r *rand.Rand) float64{
+	"uniform":     func(r *rand.Rand) float64 { return r.Float64() * 100 },
+	"exponential": func(r *rand.Rand) float64 { return r.ExpFloat64() },
+	"lognormal":   func(r *rand.Rand) float64 { return math.Exp(r.NormFloat64() * 4) },
+	"mixed sign":  func(r *rand.Rand) float64 { return r.NormFloat64() * 1e3 },
+	"with zeros": func(r *rand.Rand) float64 {
+		if r.Intn(4) == 0 {
+			return 0
+		}
+		return r.Float64() * 50
+	},
+}
+
+// checkAccuracy compares every quantile of s with the exact one of values,
+// which it sorts.
+func checkAccuracy(t *testing.T, s *Sketch, values []float64, accuracy float64) {
+	t.Helper()
+	sort.Float64s(values)
+	for _, q := range quantiles {
+		want := values[int(q*float64(len(values)-1))]
+		got := s.Quantile(q)
+		if math.Abs(got-want) > accuracy*math.Abs(want)*(1+1e-9) {
+			t.Errorf("q%v = %v, want %v within %v", q, got, want, accuracy)
+		}
+	}
+}
+
+func TestSketchAccuracy(t *testing.T) {
+	for name, gen := range distributions {
+		for _, accuracy := range []float64{0.01, 0.05} {
+			r := rand.New(rand.NewSource(1))
+			s := NewSketch(accuracy, 0)
+			values := make([]float64, 20000)
+			for i := range values {
+				values[i] = gen(r)
+				s.Add(values[i])
+			}
+			if s.Count() != uint64(len(values)) {
+				t.Fatalf("%s: count %d", name, s.Count())
+			}
+			t.Run(name, func(t *testing.T) { checkAccuracy(t, s, values, accuracy) })
+		}
+	}
+}
+
+func TestSketchMerge(t *testing.T) {
+	// Sketches merged from several hosts answer as one fed everything.
+	r := rand.New(rand.NewSource(2))
+	var merged Sketch
+	var values []float64
+	for host := 0; host < 8; host++ {
+		s := NewSketch(DefaultAccuracy, 0)
+		scale := math.Pow(10, float64(host))
+		for i := 0; i < 1000; i++ {
+			v := r.ExpFloat64() * scale
+			values = append(values, v)
+			s.Add(v)
+		}
+		if err := merged.Merge(s); err != nil {
+			t.Fatal(err)
+		}
+	}
+	checkAccuracy(t, &merged, values, DefaultAccuracy)
+
+	if err := merged.Merge(NewSketch(0.02, 0)); !errors.Is(err, ErrIncompatible) {
+		t.Fatalf("merge of different accuracy: %v", err)
+	}
+}
+
+func TestSketchBoundedBins(t *testing.T) {
+	// Folding the lowest buckets keeps the upper quantiles accurate.
+	const maxBins = 64
+	s := NewSketch(DefaultAccuracy, maxBins)
+	var values []float64
+	for v := 1e-6; v < 1e6; v *= 1.001 {
+		values = append(values, v)
+		s.Add(v)
+	}
+	if n := len(s.pos.bins); n > maxBins {
+		t.Fatalf("%d bins, limit %d", n, maxBins)
+	}
+	sort.Float64s(values)
+	for _, q := range []float64{0.99, 0.999, 1} {
+		want := values[int(q*float64(len(values)-1))]
+		if got := s.Quantile(q); math.Abs(got-want) > DefaultAccuracy*want*(1+1e-9) {
+			t.Errorf("q%v = %v, want %v", q, got, want)
+		}
+	}
+}
+
+func TestSketchBinary(t *testing.T) {
+	r := rand.New(rand.NewSource(3))
+	s := NewSketch(0.02, 512)
+	for i := 0; i < 5000; i++ {
+		s.Add(r.NormFloat64() * 10)
+	}
+	s.Add(0)
+	b := s.AppendBinary(nil)
+	var got Sketch
+	if err := got.UnmarshalBinary(b); err != nil {
+		t.Fatal(err)
+	}
+	for _, q := range quantiles {
+		if got.Quantile(q) != s.Quantile(q) {
+			t.Fatalf("q%v = %v after decoding, want %v", q, got.Quantile(q), s.Quantile(q))
+		}
+	}
+	for _, bad := range [][]byte{nil, b[:accuracySize], b[:len(b)-1], append(b[:len(b):len(b)], 0)} {
+		if err := got.UnmarshalBinary(bad); !errors.Is(err, ErrCorrupt) {
+			t.Fatalf("decoding %d bytes: %v", len(bad), err)
+		}
+	}
+}
+
+func TestSketchEmpty(t *testing.T) {
+	s := NewSketch(0, 0)
+	s.Add(math.NaN())
+	if s.Count() != 0 || !math.IsNaN(s.Quantile(0.5)) {
+		t.Fatalf("count %d, median %v", s.Count(), s.Quantile(0.5))
+	}
+}
+
+func BenchmarkSketchAdd(b *testing.B) {
+	r := rand.New(rand.NewSource(4))
+	values := make([]float64, 4096)
+	for i := range values {
+		values[i] = 40 + r.NormFloat64()*5
+	}
+	s := NewSketch(DefaultAccuracy, 0)
+	b.ReportAllocs()
+	b.ResetTimer()
+	for i := 0; i < b.N; i++ {
+		s.Add(values[i%len(values)])
+	}
+}
+
+func BenchmarkAggregatorAdd(b *testing.B) {
+	r := rand.New(rand.NewSource(5))
+	values := make([]float64, 4096)
+	for i := range values {
+		values[i] = 40 + r.NormFloat64()*5
+	}
+	a := NewAggregator(Options{})
+	b.ReportAllocs()
+	b.ResetTimer()
+	for i := 0; i < b.N; i++ {
+		// One sample a second moves the window every five minutes.
+		a.Add(int64(i)*1000, values[i%len(values)])
+	}
+}
+
+func BenchmarkSketchMerge(b *testing.B) {
+	r := rand.New(rand.NewSource(6))
+	src := NewSketch(DefaultAccuracy, 0)
+	for i := 0; i < 300; i++ {
+		src.Add(math.Exp(r.NormFloat64()))
+	}
+	var dst Sketch
+	dst.CopyFrom(src)
+	b.ReportAllocs()
+	b.ResetTimer()
+	for i := 0; i < b.N; i++ {
+		if err := dst.Merge(src); err != nil {
+			b.Fatal(err)
+		}
+	}
+	b.ReportMetric(float64(len(src.pos.bins)), "bins")
+}
+
+func BenchmarkWindowMerge(b *testing.B) {
+	// Merging a retained hour of 5-minute windows, as an alert query does.
+	a := NewAggregator(Options{})
+	r := rand.New(rand.NewSource(7))
+	for t := int64(0); t < 3600_000; t += 1000 {
+		a.Add(t, 40+r.NormFloat64()*5)
+	}
+	var dst Window
+	b.ReportAllocs()
+	b.ResetTimer()
+	for i := 0; i < b.N; i++ {
+		if err := a.Merged(0, math.MaxInt64, &dst); err != nil {
+			b.Fatal(err)
+		}
+	}
+}
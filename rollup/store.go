@@ -0,0 +1,91 @@
+package rollup
+
+// store is a dense array of bucket counts covering a contiguous key range.
+// When the range would exceed maxBins, the lowest buckets are folded into
+// one, so memory stays bounded and only the accuracy of the lowest
+// quantiles suffers.
+type store struct {
+	bins    []uint64
+	offset  int // key of bins[0]
+	count   uint64
+	maxBins int
+}
+
+func (s *store) add(key int, n uint64) {
+	if n == 0 {
+		return
+	}
+	s.count += n
+	if len(s.bins) == 0 {
+		s.bins = append(s.bins, n)
+		s.offset = key
+		return
+	}
+
+	lo, hi := s.offset, s.offset+len(s.bins)-1
+	switch {
+	case key > hi:
+		newLo := max(lo, key-s.maxBins+1)
+		s.rebin(newLo, key)
+	case key < lo:
+		// Keys below what the bin budget allows go to the lowest bucket.
+		key = max(key, hi-s.maxBins+1)
+		if key < lo {
+			s.rebin(key, hi)
+		}
+	}
+	s.bins[key-s.offset] += n
+}
+
+// rebin changes the covered key range to [lo, hi], folding buckets below lo
+// into lo. hi is never below the current highest key.
+func (s *store) rebin(lo, hi int) {
+	n := hi - lo + 1
+	var bins []uint64
+	if lo <= s.offset && n <= cap(s.bins) {
+		// Growing in place: move the counts up, then clear what they left.
+		bins = s.bins[:n]
+		shift := s.offset - lo
+		copy(bins[shift:], s.bins)
+		clear(bins[:shift])
+		clear(bins[shift+len(s.bins):])
+	} else {
+		bins = make([]uint64, n, min(2*n, s.maxBins))
+		for i, c := range s.bins {
+			k := max(s.offset+i, lo)
+			bins[k-lo] += c
+		}
+	}
+	s.bins, s.offset = bins, lo
+}
+
+// keyAtRank returns the key of the bucket holding the sample of the given
+// rank, counting from the lowest key.
+func (s *store) keyAtRank(rank float64) int {
+	var n uint64
+	for i, c := range s.bins {
+		n += c
+		if float64(n) > rank {
+			return s.offset + i
+		}
+	}
+	return s.offset + len(s.bins) - 1
+}
+
+func (s *store) merge(o *store) {
+	for i, c := range o.bins {
+		s.add(o.offset+i, c)
+	}
+}
+
+// reset clears the counts but keeps the key range and its memory, as the
+// next window usually covers similar values.
+func (s *store) reset() {
+	clear(s.bins)
+	s.count = 0
+}
+
+func (s *store) copyFrom(o *store) {
+	s.bins = append(s.bins[:0], o.bins...)
+	s.offset, s.count, s.maxBins = o.offset, o.count, o.maxBins
+}
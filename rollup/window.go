@@ -0,0 +1,199 @@
+package rollup
+
+import (
+	"math"
+	"time"
+)
+
+// Window summarises the samples of one time window.
+type Window struct {
+	// Start is the window's start in milliseconds since the Unix epoch;
+	// the window covers [Start, Start+length).
+	Start  int64
+	Count  uint64
+	Sum    float64
+	Min    float64
+	Max    float64
+	Sketch Sketch
+}
+
+// Mean returns the average of the window's samples, or NaN if it is empty.
+func (w *Window) Mean() float64 {
+	if w.Count == 0 {
+		return math.NaN()
+	}
+	return w.Sum / float64(w.Count)
+}
+
+// Quantile returns an estimate of the q-quantile of the window's samples.
+func (w *Window) Quantile(q float64) float64 {
+	return w.Sketch.Quantile(q)
+}
+
+func (w *Window) add(v float64) {
+	if math.IsNaN(v) {
+		return
+	}
+	if w.Count == 0 || v < w.Min {
+		w.Min = v
+	}
+	if w.Count == 0 || v > w.Max {
+		w.Max = v
+	}
+	w.Count++
+	w.Sum += v
+	w.Sketch.Add(v)
+}
+
+// Merge folds o into w, e.g. consecutive windows into a longer one or the
+// same window from several hosts. Start becomes the earlier of the two.
+func (w *Window) Merge(o *Window) error {
+	if err := w.Sketch.Merge(&o.Sketch); err != nil {
+		return err
+	}
+	if o.Count == 0 {
+		return nil
+	}
+	if w.Count == 0 {
+		w.Start, w.Min, w.Max = o.Start, o.Min, o.Max
+	} else {
+		w.Start = min(w.Start, o.Start)
+		w.Min = min(w.Min, o.Min)
+		w.Max = max(w.Max, o.Max)
+	}
+	w.Count += o.Count
+	w.Sum += o.Sum
+	return nil
+}
+
+// CopyFrom makes w an exact copy of o, reusing the memory of w.
+func (w *Window) CopyFrom(o *Window) {
+	w.Start, w.Count, w.Sum, w.Min, w.Max = o.Start, o.Count, o.Sum, o.Min, o.Max
+	w.Sketch.CopyFrom(&o.Sketch)
+}
+
+func (w *Window) reset(start int64) {
+	w.Start, w.Count, w.Sum, w.Min, w.Max = start, 0, 0, 0, 0
+	w.Sketch.Reset()
+}
+
+// Options configures an Aggregator.
+type Options struct {
+	// Window is the length of a window. Defaults to 5 minutes.
+	Window time.Duration
+	// Keep is the number of completed windows retained. Defaults to 12.
+	Keep int
+	// Accuracy is the relative accuracy of the quantile sketches.
+	Accuracy float64
+	// MaxBins bounds the buckets per sketch, and with Keep the memory per
+	// series.
+	MaxBins int
+	// Idle is how long a Set keeps a series that receives no samples,
+	// measured against the newest sample of any series. Defaults to the
+	// span of the retained windows, Window*(Keep+1).
+	Idle time.Duration
+}
+
+// Defaults applied to zero Options fields.
+const (
+	DefaultWindow = 5 * time.Minute
+	DefaultKeep   = 12
+)
+
+func (o *Options) setDefaults() {
+	if o.Window <= 0 {
+		o.Window = DefaultWindow
+	}
+	if o.Keep <= 0 {
+		o.Keep = DefaultKeep
+	}
+	if o.Idle <= 0 {
+		o.Idle = o.Window * time.Duration(o.Keep+1)
+	}
+}
+
+// Aggregator rolls the samples of one series up into consecutive, aligned
+// windows. The window being filled and the Keep most recent completed ones
+// live in a ring whose sketches are reused, so memory stays fixed once the
+// ring is warm.
+//
+// An Aggregator is not safe for concurrent use; Set wraps it for that.
+type Aggregator struct {
+	length int64 // ms
+	ring   []Window
+	cur    int // index of the window being filled
+	filled int // completed windows in the ring
+}
+
+// NewAggregator returns an empty Aggregator.
+func NewAggregator(opts Options) *Aggregator {
+	opts.setDefaults()
+	a := &Aggregator{
+		length: opts.Window.Milliseconds(),
+		ring:   make([]Window, opts.Keep+1),
+		cur:    -1,
+	}
+	for i := range a.ring {
+		a.ring[i].Sketch.init(opts.Accuracy, opts.MaxBins)
+	}
+	return a
+}
+
+// Add records a sample taken at t, in milliseconds since the Unix epoch.
+// Samples older than the window being filled are ignored.
+func (a *Aggregator) Add(t int64, v float64) {
+	start := t - t%a.length
+	if t < 0 && t%a.length != 0 {
+		start -= a.length
+	}
+	switch {
+	case a.cur < 0:
+		a.cur = 0
+		a.ring[0].reset(start)
+	case start < a.ring[a.cur].Start:
+		return
+	case start > a.ring[a.cur].Start:
+		a.cur = (a.cur + 1) % len(a.ring)
+		a.filled = min(a.filled+1, len(a.ring)-1)
+		a.ring[a.cur].reset(start)
+	}
+	a.ring[a.cur].add(v)
+}
+
+// Current returns the window being filled, or nil before the first sample.
+// It is only valid until the next Add.
+func (a *Aggregator) Current() *Window {
+	if a.cur < 0 {
+		return nil
+	}
+	return &a.ring[a.cur]
+}
+
+// Completed returns the i-th most recent completed window, 0 being the
+// latest, or nil if there is no such window. It is only valid until the
+// next Add.
+func (a *Aggregator) Completed(i int) *Window {
+	if i < 0 || i >= a.filled {
+		return nil
+	}
+	return &a.ring[(a.cur-1-i+len(a.ring))%len(a.ring)]
+}
+
+// Merged folds every retained window, completed or not, that starts within
+// [mint, maxt] into dst, which is reset first.
+func (a *Aggregator) Merged(mint, maxt int64, dst *Window) error {
+	dst.reset(0)
+	if a.cur < 0 {
+		return nil
+	}
+	for i := 0; i <= a.filled; i++ {
+		w := &a.ring[(a.cur-i+len(a.ring))%len(a.ring)]
+		if w.Start < mint || w.Start > maxt {
+			continue
+		}
+		if err := dst.Merge(w); err != nil {
+			return err
+		}
+	}
+	return nil
+}
@@ -0,0 +1,307 @@
+// Package statsd sends samples to a StatsD or DogStatsD agent over UDP.
+//
+// Lines are serialised straight into a reusable packet buffer and as many
+// as fit the configured MTU share one datagram, so a full snapshot costs a
+// handful of WriteTo calls rather than one per metric.
+package statsd
+
+import (
+	"errors"
+	"math"
+	"net"
+	"strconv"
+	"sync"
+	"sync/atomic"
+
+	"github.com/sm-moshi/dmetrics-go/metric"
+)
+
+// DefaultMTU is the payload size that fits an Ethernet frame once IP and UDP
+// headers (and some tunnelling overhead) are accounted for, the same default
+// DogStatsD clients use.
+const DefaultMTU = 1432
+
+// TagFormat selects how labels are rendered.
+type TagFormat uint8
+
+const (
+	// TagsDogStatsD appends labels as "|#name:value,...".
+	TagsDogStatsD TagFormat = iota
+	// TagsNone drops labels, for plain StatsD servers.
+	TagsNone
+)
+
+var (
+	// ErrNoAddr is returned by New when Config.Addr is empty.
+	ErrNoAddr = errors.New("statsd: no address configured")
+	// ErrClosed is returned by Send and Close after Close.
+	ErrClosed = errors.New("statsd: exporter closed")
+)
+
+// Config configures an Exporter.
+type Config struct {
+	// Addr is the agent's host:port.
+	Addr string
+	// MTU caps the size of every datagram. Defaults to DefaultMTU.
+	MTU int
+	// Prefix is prepended, followed by a dot, to every metric name.
+	Prefix string
+	// Tags are constant "name:value" tags added to every line.
+	Tags []string
+	// TagFormat selects how labels and Tags are rendered.
+	TagFormat TagFormat
+}
+
+// Stats are cumulative counters of an Exporter.
+type Stats struct {
+	// Packets is the number of datagrams written.
+	Packets uint64
+	// Lines is the number of metric lines written.
+	Lines uint64
+	// Oversized counts lines dropped because they alone exceed the MTU.
+	Oversized uint64
+	// Errors counts failed writes; their lines are lost.
+	Errors uint64
+	// Invalid counts samples dropped for a NaN or infinite value, which
+	// StatsD has no syntax for.
+	Invalid uint64
+}
+
+// staleSends is the number of sends a counter series may go unseen before
+// its baseline is forgotten.
+const staleSends = 10
+
+// baseline is the previous total of a counter series.
+type baseline struct {
+	value float64
+	send  uint64
+}
+
+// Exporter serialises samples into StatsD lines. It is safe for concurrent
+// use; Send calls are serialised.
+type Exporter struct {
+	cfg  Config
+	conn net.PacketConn
+	addr net.Addr
+
+	mu     sync.Mutex
+	packet []byte
+	line   []byte
+	// last holds the previous value of every counter series, as StatsD
+	// counters are increments while metric.Counter samples are totals.
+	last   map[uint64]baseline
+	sends  uint64
+	closed bool
+
+	packets, lines, oversized, errs, invalid atomic.Uint64
+}
+
+// New resolves the agent address and opens the sending socket.
+func New(cfg Config) (*Exporter, error) {
+	if cfg.Addr == "" {
+		return nil, ErrNoAddr
+	}
+	if cfg.MTU <= 0 {
+		cfg.MTU = DefaultMTU
+	}
+	addr, err := net.ResolveUDPAddr("udp", cfg.Addr)
+	if err != nil {
+		return nil, err
+	}
+	conn, err := net.ListenPacket("udp", ":0")
+	if err != nil {
+		return nil, err
+	}
+	return &Exporter{
+		cfg:    cfg,
+		conn:   conn,
+		addr:   addr,
+		packet: make([]byte, 0, cfg.MTU),
+		last:   make(map[uint64]baseline),
+	}, nil
+}
+
+// Send writes the samples, packing lines into as few datagrams as the MTU
+// allows. The first sample of a counter series only records its baseline.
+// Write errors are counted in Stats and the first one is returned.
+func (e *Exporter) Send(samples []metric.Sample) error {
+	e.mu.Lock()
+	defer e.mu.Unlock()
+	if e.closed {
+		return ErrClosed
+	}
+
+	var firstErr error
+	keep := func(err error) {
+		if err != nil && firstErr == nil {
+			firstErr = err
+		}
+	}
+	for i := range samples {
+		s := &samples[i]
+		value, ok := e.value(s)
+		if !ok {
+			continue
+		}
+		e.line = e.appendLine(e.line[:0], s, value)
+		if len(e.line) > e.cfg.MTU {
+			e.oversized.Add(1)
+			continue
+		}
+		// One byte for the newline separating it from the previous line.
+		if len(e.packet) > 0 && len(e.packet)+1+len(e.line) > e.cfg.MTU {
+			keep(e.flush())
+		}
+		if len(e.packet) > 0 {
+			e.packet = append(e.packet, '\n')
+		}
+		e.packet = append(e.packet, e.line...)
+		e.lines.Add(1)
+	}
+	keep(e.flush())
+	e.endSend()
+	return firstErr
+}
+
+// endSend forgets counter baselines not seen for staleSends sends, so
+// churning series (short-lived processes, unmounted filesystems) do not
+// pile up.
+func (e *Exporter) endSend() {
+	e.sends++
+	if e.sends%staleSends != 0 {
+		return
+	}
+	for h, b := range e.last {
+		if e.sends-b.send > staleSends {
+			delete(e.last, h)
+		}
+	}
+}
+
+// value returns what to send for s: gauges as-is, counters as the increase
+// since the previous sample of the series. Non-finite values are dropped.
+func (e *Exporter) value(s *metric.Sample) (float64, bool) {
+	if math.IsNaN(s.Value) || math.IsInf(s.Value, 0) {
+		e.invalid.Add(1)
+		return 0, false
+	}
+	if s.Kind != metric.Counter {
+		return s.Value, true
+	}
+	h := s.SeriesHash()
+	prev, seen := e.last[h]
+	e.last[h] = baseline{value: s.Value, send: e.sends}
+	switch {
+	case !seen:
+		return 0, false
+	case s.Value < prev.value:
+		// The source restarted; everything since then is new.
+		return s.Value, true
+	default:
+		return s.Value - prev.value, true
+	}
+}
+
+func (e *Exporter) flush() error {
+	if len(e.packet) == 0 {
+		return nil
+	}
+	_, err := e.conn.WriteTo(e.packet, e.addr)
+	e.packet = e.packet[:0]
+	if err != nil {
+		e.errs.Add(1)
+		return err
+	}
+	e.packets.Add(1)
+	return nil
+}
+
+// appendLine appends "prefix.name:value|type|#tags" to b.
+func (e *Exporter) appendLine(b []byte, s *metric.Sample, value float64) []byte {
+	if e.cfg.Prefix != "" {
+		b = appendName(b, e.cfg.Prefix)
+		b = append(b, '.')
+	}
+	b = appendName(b, s.Name)
+	b = append(b, ':')
+	b = strconv.AppendFloat(b, value, 'f', -1, 64)
+	if s.Kind == metric.Counter {
+		b = append(b, "|c"...)
+	} else {
+		b = append(b, "|g"...)
+	}
+
+	if e.cfg.TagFormat != TagsDogStatsD || len(s.Labels)+len(e.cfg.Tags) == 0 {
+		return b
+	}
+	b = append(b, "|#"...)
+	sep := false
+	for _, t := range e.cfg.Tags {
+		if sep {
+			b = append(b, ',')
+		}
+		b = appendSanitised(b, t)
+		sep = true
+	}
+	for _, l := range s.Labels {
+		if sep {
+			b = append(b, ',')
+		}
+		b = appendName(b, l.Name)
+		b = append(b, ':')
+		b = appendSanitised(b, l.Value)
+		sep = true
+	}
+	return b
+}
+
+// appendSanitised appends a tag or label value with the characters that
+// delimit StatsD fields replaced by underscores. Colons are allowed, as the
+// agent splits tags on the first one only.
+func appendSanitised(b []byte, s string) []byte {
+	for i := 0; i < len(s); i++ {
+		switch c := s[i]; c {
+		case '|', '@', '#', ',', '\n':
+			b = append(b, '_')
+		default:
+			b = append(b, c)
+		}
+	}
+	return b
+}
+
+// appendName is appendSanitised for metric and label names, which must not
+// contain colons either.
+func appendName(b []byte, s string) []byte {
+	for i := 0; i < len(s); i++ {
+		switch c := s[i]; c {
+		case ':', '|', '@', '#', ',', '\n':
+			b = append(b, '_')
+		default:
+			b = append(b, c)
+		}
+	}
+	return b
+}
+
+// Stats returns a snapshot of the exporter's counters.
+func (e *Exporter) Stats() Stats {
+	return Stats{
+		Packets:   e.packets.Load(),
+		Lines:     e.lines.Load(),
+		Oversized: e.oversized.Load(),
+		Errors:    e.errs.Load(),
+		Invalid:   e.invalid.Load(),
+	}
+}
+
+// Close releases the socket.
+func (e *Exporter) Close() error {
+	e.mu.Lock()
+	defer e.mu.Unlock()
+	if e.closed {
+		return ErrClosed
+	}
+	e.closed = true
+	return e.conn.Close()
+}
@@ -0,0 +1,193 @@
+package statsd
+
+import (
+	"errors"
+	"math"
+	"net"
+	"strconv"
+	"strings"
+	"testing"
+	"time"
+
+	"github.com/sm-moshi/dmetrics-go/metric"
+)
+
+// listener is a local StatsD agent collecting datagrams.
+type listener struct {
+	conn net.PacketConn
+}
+
+func listen(t testing.TB) *listener {
+	t.Helper()
+	conn, err := net.ListenPacket("udp", "127.0.0.1:0")
+	if err != nil {
+		t.Fatal(err)
+	}
+	t.Cleanup(func() { conn.Close() })
+	return &listener{conn: conn}
+}
+
+// packets reads datagrams until none arrives for a short while.
+func (l *listener) packets(t *testing.T) []string {
+	t.Helper()
+	var out []string
+	buf := make([]byte, 1<<16)
+	for {
+		if err := l.conn.SetReadDeadline(time.Now().Add(100 * time.Millisecond)); err != nil {
+			t.Fatal(err)
+		}
+		n, _, err := l.conn.ReadFrom(buf)
+		if err != nil {
+			return out
+		}
+		out = append(out, string(buf[:n]))
+	}
+}
+
+func lines(packets []string) []string {
+	var out []string
+	for _, p := range packets {
+		out = append(out, strings.Split(p, "\n")...)
+	}
+	return out
+}
+
+func newExporter(t testing.TB, l *listener, cfg Config) *Exporter {
+	t.Helper()
+	cfg.Addr = l.conn.LocalAddr().String()
+	e, err := New(cfg)
+	if err != nil {
+		t.Fatal(err)
+	}
+	t.Cleanup(func() { e.Close() })
+	return e
+}
+
+func TestLinesAndTags(t *testing.T) {
+	l := listen(t)
+	e := newExporter(t, l, Config{Prefix: "host", Tags: []string{"env:prod|x"}})
+	err := e.Send([]metric.Sample{
+		{Name: "cpu.usage", Value: 12.5, Labels: metric.NewLabels("core", "0")},
+		{Name: "odd:name", Value: 1, Labels: metric.NewLabels("path", "/a,b|c#d", "x:y", "v")},
+	})
+	if err != nil {
+		t.Fatal(err)
+	}
+	got := lines(l.packets(t))
+	want := []string{
+		"host.cpu.usage:12.5|g|#env:prod_x,core:0",
+		"host.odd_name:1|g|#env:prod_x,path:/a_b_c_d,x_y:v",
+	}
+	if strings.Join(got, "\n") != strings.Join(want, "\n") {
+		t.Fatalf("got %q\nwant %q", got, want)
+	}
+}
+
+func TestCounterDeltas(t *testing.T) {
+	l := listen(t)
+	e := newExporter(t, l, Config{TagFormat: TagsNone})
+	for _, v := range []float64{100, 130, 130, 5} {
+		if err := e.Send([]metric.Sample{{Name: "rx", Kind: metric.Counter, Value: v}}); err != nil {
+			t.Fatal(err)
+		}
+	}
+	// The first total is only a baseline; 5 after 130 is a restart.
+	want := []string{"rx:30|c", "rx:0|c", "rx:5|c"}
+	if got := lines(l.packets(t)); strings.Join(got, " ") != strings.Join(want, " ") {
+		t.Fatalf("got %q, want %q", got, want)
+	}
+}
+
+func TestPacketsFitMTU(t *testing.T) {
+	const mtu = 200
+	l := listen(t)
+	e := newExporter(t, l, Config{MTU: mtu})
+	var samples []metric.Sample
+	for i := 0; i < 300; i++ {
+		samples = append(samples, metric.Sample{Name: "m" + strconv.Itoa(i), Value: float64(i)})
+	}
+	samples = append(samples, metric.Sample{Name: strings.Repeat("x", mtu), Value: 1})
+	if err := e.Send(samples); err != nil {
+		t.Fatal(err)
+	}
+	packets := l.packets(t)
+	for _, p := range packets {
+		if len(p) > mtu {
+			t.Fatalf("packet of %d bytes exceeds MTU", len(p))
+		}
+	}
+	if got := lines(packets); len(got) != 300 {
+		t.Fatalf("got %d lines, want 300", len(got))
+	}
+	st := e.Stats()
+	if st.Oversized != 1 || st.Lines != 300 || st.Packets != uint64(len(packets)) || st.Packets < 300*6/mtu {
+		t.Fatalf("stats %+v, %d packets", st, len(packets))
+	}
+}
+
+func TestNonFiniteDropped(t *testing.T) {
+	l := listen(t)
+	e := newExporter(t, l, Config{})
+	err := e.Send([]metric.Sample{
+		{Name: "a", Value: math.NaN()},
+		{Name: "b", Value: math.Inf(1)},
+		{Name: "c", Kind: metric.Counter, Value: math.Inf(-1)},
+		{Name: "d", Value: 2},
+	})
+	if err != nil {
+		t.Fatal(err)
+	}
+	if got := lines(l.packets(t)); len(got) != 1 || got[0] != "d:2|g" {
+		t.Fatalf("got %q", got)
+	}
+	if st := e.Stats(); st.Invalid != 3 {
+		t.Fatalf("stats %+v", st)
+	}
+}
+
+func TestStaleBaselinesEvicted(t *testing.T) {
+	l := listen(t)
+	e := newExporter(t, l, Config{})
+	for i := 0; i < 50; i++ {
+		// A new counter series every send, as with short-lived processes.
+		s := metric.Sample{Name: "p", Kind: metric.Counter, Value: 1, Labels: metric.NewLabels("pid", strconv.Itoa(i))}
+		if err := e.Send([]metric.Sample{s}); err != nil {
+			t.Fatal(err)
+		}
+	}
+	if n := len(e.last); n > 2*staleSends {
+		t.Fatalf("%d baselines kept", n)
+	}
+}
+
+func TestClosed(t *testing.T) {
+	l := listen(t)
+	e := newExporter(t, l, Config{})
+	if err := e.Close(); err != nil {
+		t.Fatal(err)
+	}
+	if err := e.Send(nil); !errors.Is(err, ErrClosed) {
+		t.Fatalf("Send after Close: %v", err)
+	}
+}
+
+// BenchmarkSend formats and sends a poll of a thousand gauges and counters.
+func BenchmarkSend(b *testing.B) {
+	e := newExporter(b, listen(b), Config{Prefix: "host"})
+	samples := make([]metric.Sample, 1000)
+	for i := range samples {
+		samples[i] = metric.Sample{Name: "process.cpu", Labels: metric.NewLabels("pid", strconv.Itoa(i)), Value: float64(i)}
+		if i%2 == 0 {
+			samples[i].Kind = metric.Counter
+		}
+	}
+	b.ReportAllocs()
+	for i := 0; i < b.N; i++ {
+		for j := range samples {
+			samples[j].Value++
+		}
+		if err := e.Send(samples); err != nil {
+			b.Fatal(err)
+		}
+	}
+}